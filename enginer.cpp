@@ -2,305 +2,7301 @@
 #include <cmath>
 #include <iomanip>
 #include <limits>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <mutex>
+#include <queue>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ==========================================================
+// GLOBAL VARIABLES
+// ==========================================================
+
+// Engine inputs are per thread: sweep workers load each point with
+// applyGlobalInputs() before running the Turbojet/Turbofan classes.
+
+// Gas properties
+thread_local double g_gamma_air, g_gamma_gas;
+thread_local double g_cp_air, g_cp_gas;
+thread_local double g_R_air, g_Q_HV;
+
+// Flight conditions
+thread_local double g_M0, g_T0, g_P0;
+
+// Efficiencies
+thread_local double g_eta_inlet, g_eta_c, g_eta_f, g_eta_b, g_eta_t, g_eta_ab, g_eta_n;
+
+// Pressure ratios & limits
+thread_local double g_pi_b, g_pi_ab, g_pi_m, g_T_t4, g_T_t7;
+
+// Engine-specific
+thread_local double g_pi_c_jet;
+thread_local double g_BPR, g_pi_f, g_pi_c_fan;
+
+// Two-spool turbofan: HP/LP turbine efficiencies (default to eta_t when inputs
+// are loaded), cooling and customer bleed as fractions of core air, and HP
+// shaft power offtake in J per kg of core air.
+thread_local double g_eta_t_hp, g_eta_t_lp;
+thread_local double g_bleed_cool = 0.0, g_bleed_cust = 0.0, g_W_offtake = 0.0;
+
+// Turboprop/turboshaft: power turbine efficiency (defaults to eta_t when
+// inputs are loaded), propeller and gearbox efficiencies, and the power
+// turbine's share of the expansion (turboshaft only; turboprops optimize it).
+thread_local double g_eta_pt;
+thread_local double g_eta_prop = 0.85, g_eta_gear = 0.98, g_pt_split = 1.0;
+
+// Intercooler and recuperator effectiveness and pressure ratios (IcrTurbofan).
+thread_local double g_eps_ic = 0.0, g_pi_ic = 1.0, g_eps_rec = 0.0, g_pi_rec = 1.0;
+
+// Variable-cycle engine: mode (0 jet, 1 fan, 2 three-stream, rounded), third
+// stream bypass ratio per unit core air, and third-stream fan pressure ratio.
+thread_local double g_vc_mode = 1.0, g_BPR3 = 0.0, g_pi_f3 = 1.5;
+
+// Fuel library index (rounded); 0 uses the Q_HV and cp_gas inputs.
+thread_local double g_fuel_type = 0.0;
+
+// Flags
+bool g_inputs_are_set = false;
+bool g_debug_mode = false;
+
+// ==========================================================
+// Utility Functions
+// ==========================================================
+inline double safe_pow(double base, double exp) {
+    if (base <= 0.0) return 0.0;
+    return std::pow(base, exp);
+}
+
+// Branch-free safe_pow: identical result for base > 0, 0 otherwise.
+template<typename T>
+inline T select_pow(T base, T exp) {
+    T r = std::pow(std::max(base, std::numeric_limits<T>::min()), exp);
+    return base > 0 ? r : T(0);
+}
+
+template<typename T>
+inline T guardDenominator(T denom) {
+    return denom <= 0 ? std::numeric_limits<T>::epsilon() : denom;
+}
+
+template<typename T>
+inline T select_sqrt(T x) { return std::sqrt(x); }
+
+template<typename T>
+inline T select_max(T a, T b) { return std::max(a, b); }
+
+template<typename T>
+inline T select_min(T a, T b) { return std::min(a, b); }
+
+// x > y ? a : b, for loops that step every lane through the same instructions.
+template<typename T>
+inline T select_greater(T x, T y, T a, T b) { return x > y ? a : b; }
+
+template<typename T>
+inline T clamp(T val, T minVal, T maxVal) {
+    return std::max(minVal, std::min(val, maxVal));
+}
+
+inline uint64_t fnv1a(uint64_t h, const void* data, size_t len) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) { h ^= p[i]; h *= 0x100000001B3ull; }
+    return h;
+}
+
+// Quotes and control characters escaped for a JSON string body.
+std::string jsonEscape(const std::string& text) {
+    std::ostringstream os;
+    for (unsigned char ch : text) {
+        if (ch == '"' || ch == '\\') os << '\\' << ch;
+        else if (ch < 0x20) os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(ch) << std::dec;
+        else os << ch;
+    }
+    return os.str();
+}
+
+// ==========================================================
+// Result Columns
+// ==========================================================
+enum OutputColumn {
+    OUT_SPECIFIC_THRUST, OUT_TSFC, OUT_F_COMB, OUT_F_AB, OUT_F_TOTAL,
+    OUT_V0, OUT_V9,
+    OUT_T_T3, OUT_P_T3, OUT_T_T5, OUT_P_T5, OUT_T_T9, OUT_P_T9,
+    OUT_SHAFT_POWER, OUT_PSFC, OUT_PT_SPLIT,     // shaft engines only, NaN otherwise
+    OUT_EI_NOX, OUT_EI_CO,                       // --emissions only, NaN otherwise
+    OUT_COUNT
+};
+
+const char* const kOutputNames[OUT_COUNT] = {
+    "specificThrust", "TSFC", "f_comb", "f_ab", "f_total",
+    "V0", "V9",
+    "T_t3", "P_t3", "T_t5", "P_t5", "T_t9", "P_t9",
+    "shaftPower", "PSFC", "ptSplit",
+    "EI_NOx", "EI_CO"
+};
+
+// Output projection (--outputs): bit c selects column c. The batch kernels
+// write, and sweep results hold, only the selected columns; the others are
+// never materialized.
+using OutputMask = uint32_t;
+static_assert(OUT_COUNT <= 32, "OutputMask has one bit per column");
+
+constexpr OutputMask outputBit(int c) { return OutputMask(1) << c; }
+
+const OutputMask kAllOutputs = (OutputMask(1) << OUT_COUNT) - 1;
+const OutputMask kEmissionOutputs = outputBit(OUT_EI_NOX) | outputBit(OUT_EI_CO);
+
+int findOutputColumn(const std::string& name) {
+    for (int c = 0; c < OUT_COUNT; ++c)
+        if (name == kOutputNames[c]) return c;
+    return -1;
+}
+
+int outputCount(OutputMask mask) {
+    int n = 0;
+    for (int c = 0; c < OUT_COUNT; ++c) n += (mask & outputBit(c)) != 0;
+    return n;
+}
+
+// ==========================================================
+// Per-Stage Hardware Counters
+// ==========================================================
+// Opt-in (--profile-stages). Each stage call in runFullAnalysis() is wrapped
+// in a StageScope that reads a per-thread perf_event_open group (cycles,
+// instructions, branch-misses, cache-misses, user space only) before and
+// after the stage. The fixed cost of an empty scope is measured once per
+// thread and subtracted. When the kernel multiplexes the group, counts are
+// scaled by time_enabled / time_running. Where the PMU is not available (VMs, containers,
+// perf_event_paranoid) only wall time is recorded.
+enum ProfileStage {
+    STAGE_INLET, STAGE_FAN, STAGE_COMPRESSOR, STAGE_COMBUSTOR, STAGE_TURBINE,
+    STAGE_MIXER, STAGE_AFTERBURNER, STAGE_NOZZLE, STAGE_PERFORMANCE,
+    STAGE_THIRD_STREAM, STAGE_INTERCOOLER, STAGE_BLEED, STAGE_RECUPERATOR, STAGE_OFFTAKE,
+    STAGE_COUNT
+};
+
+const char* const kStageNames[STAGE_COUNT] = {
+    "analyzeInlet", "analyzeFan", "analyzeCompressor", "analyzeCombustor", "analyzeTurbine",
+    "analyzeMixer", "analyzeAfterburner", "analyzeNozzle", "calculatePerformance",
+    "analyzeThirdStream", "analyzeIntercooler", "analyzeBleed", "analyzeRecuperator", "analyzeOfftake"
+};
+
+enum CounterKind { CTR_NS, CTR_CYCLES, CTR_INSTRUCTIONS, CTR_BRANCH_MISSES, CTR_CACHE_MISSES, CTR_COUNT };
+
+const char* const kCounterNames[CTR_COUNT] = {
+    "ns", "cycles", "instructions", "branch_misses", "cache_misses"
+};
+
+bool g_profile_stages = false;
+
+struct StageCounters {
+    int thread = 0;
+    int leaderFd = -1;
+    int fds[CTR_COUNT - 1] = {-1, -1, -1, -1};    // leader first, then the members
+    int hwCounters = 0;                       // events opened in the group
+    uint64_t calls[STAGE_COUNT] = {};
+    double totals[STAGE_COUNT][CTR_COUNT] = {};
+    double overhead[CTR_COUNT] = {};          // cost of an empty scope
+
+    // values[0] is wall time in ns, the rest follow CounterKind.
+    void sample(uint64_t values[CTR_COUNT]) const {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        values[CTR_NS] = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+        if (leaderFd < 0) return;
+        uint64_t buf[3 + CTR_COUNT] = {};     // nr, time_enabled, time_running, then values
+        if (read(leaderFd, buf, sizeof(buf)) <= 0) return;
+        double scale = buf[2] ? static_cast<double>(buf[1]) / static_cast<double>(buf[2]) : 0.0;
+        for (uint64_t k = 0; k < buf[0] && k + 1 < CTR_COUNT; ++k)
+            values[k + 1] = static_cast<uint64_t>(static_cast<double>(buf[k + 3]) * scale);
+    }
+
+    // The totals outlive the thread; the counters do not.
+    void closeCounters() {
+        for (int& fd : fds)
+            if (fd >= 0) close(fd), fd = -1;
+        leaderFd = -1;
+    }
+};
+
+std::mutex g_stage_counters_lock;
+std::vector<StageCounters*> g_stage_counters;   // one per profiled thread, never freed
+thread_local StageCounters* t_stage_counters = nullptr;
+
+struct StageCounterCloser {
+    ~StageCounterCloser() {
+        if (t_stage_counters) t_stage_counters->closeCounters();
+    }
+};
+thread_local StageCounterCloser t_stage_counter_closer;
+
+int openPerfCounter(uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = groupFd < 0 ? 1 : 0;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+StageCounters& threadStageCounters() {
+    if (t_stage_counters) return *t_stage_counters;
+    StageCounters* sc = new StageCounters;
+    const uint64_t configs[] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+    };
+    sc->leaderFd = sc->fds[0] = openPerfCounter(configs[0], -1);
+    if (sc->leaderFd >= 0) {
+        sc->hwCounters = 1;
+        // Members must open in order: a gap would shift the group read layout.
+        for (int k = 1; k < 4 && (sc->fds[k] = openPerfCounter(configs[k], sc->leaderFd)) >= 0; ++k)
+            ++sc->hwCounters;
+        ioctl(sc->leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(sc->leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    // Smallest of several rounds, so a cold first round (page faults, vDSO
+    // setup) does not inflate the overhead and push short stages negative.
+    const int kRounds = 8, kCalibration = 256;
+    for (int k = 0; k < CTR_COUNT; ++k) sc->overhead[k] = std::numeric_limits<double>::max();
+    for (int r = 0; r < kRounds; ++r) {
+        uint64_t a[CTR_COUNT] = {}, b[CTR_COUNT] = {};
+        sc->sample(a);
+        for (int i = 0; i < kCalibration; ++i) sc->sample(b);
+        for (int k = 0; k < CTR_COUNT; ++k)
+            sc->overhead[k] = std::min(sc->overhead[k], static_cast<double>(b[k] - a[k]) / kCalibration);
+    }
+
+    std::lock_guard<std::mutex> guard(g_stage_counters_lock);
+    sc->thread = static_cast<int>(g_stage_counters.size());
+    g_stage_counters.push_back(sc);
+    t_stage_counters = sc;
+    (void)&t_stage_counter_closer;            // odr-use, so the closer is constructed
+    return *sc;
+}
+
+// `countCall` false adds the time to the stage without counting another call,
+// for a stage made of several consecutive components.
+class StageScope {
+public:
+    explicit StageScope(ProfileStage stage, bool countCall = true)
+        : stage_(stage), countCall_(countCall), counters_(nullptr) {
+        if (!g_profile_stages) return;
+        counters_ = &threadStageCounters();
+        counters_->sample(begin_);
+    }
+
+    ~StageScope() {
+        if (!counters_) return;
+        uint64_t end[CTR_COUNT] = {};
+        counters_->sample(end);
+        if (countCall_) ++counters_->calls[stage_];
+        for (int k = 0; k < CTR_COUNT; ++k)
+            counters_->totals[stage_][k] += static_cast<double>(end[k] - begin_[k]) - counters_->overhead[k];
+    }
+
+private:
+    ProfileStage stage_;
+    bool countCall_;
+    StageCounters* counters_;
+    uint64_t begin_[CTR_COUNT] = {};
+};
+
+// ==========================================================
+// Trace Events
+// ==========================================================
+// Opt-in (--trace FILE). Scoped events go into a per-thread buffer with no
+// locking on the hot path and are written once at exit in Chrome trace JSON,
+// which chrome://tracing and ui.perfetto.dev both open. Forked shard workers
+// write their events to FILE.<pid> before exiting; the launcher folds those
+// fragments into the final file. Each thread keeps at most
+// kTraceEventsPerThread events; past that its buffer becomes a ring holding
+// the newest ones.
+bool g_trace_enabled = false;
+std::string g_trace_path;
+
+struct TraceEvent {
+    const char* name;
+    const char* argName;      // nullptr: no args
+    uint64_t startNs, durNs;
+    uint64_t arg;
+    char phase;               // 'X' complete, 'i' instant
+};
+
+const size_t kTraceEventsPerThread = size_t(1) << 20;
+
+struct TraceBuffer {
+    int tid = 0;
+    std::string threadName;
+    std::vector<TraceEvent> events;
+    uint64_t recorded = 0;    // events[recorded % size] is the oldest once the ring is full
+
+    void push(const TraceEvent& e) {
+        if (events.size() < kTraceEventsPerThread) events.push_back(e);
+        else events[recorded % kTraceEventsPerThread] = e;
+        ++recorded;
+    }
+
+    uint64_t dropped() const { return recorded - events.size(); }
+
+    const TraceEvent& at(size_t k) const {
+        return events[(dropped() ? recorded + k : k) % events.size()];
+    }
+};
+
+std::mutex g_trace_lock;
+std::vector<TraceBuffer*> g_trace_buffers;     // never freed
+std::vector<pid_t> g_trace_children;
+thread_local TraceBuffer* t_trace_buffer = nullptr;
+
+inline uint64_t traceNow() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+TraceBuffer& threadTraceBuffer() {
+    if (t_trace_buffer) return *t_trace_buffer;
+    TraceBuffer* tb = new TraceBuffer;
+    tb->events.reserve(4096);
+    std::lock_guard<std::mutex> guard(g_trace_lock);
+    tb->tid = static_cast<int>(g_trace_buffers.size());
+    g_trace_buffers.push_back(tb);
+    t_trace_buffer = tb;
+    return *tb;
+}
+
+void traceThreadName(const std::string& name) {
+    if (g_trace_enabled) threadTraceBuffer().threadName = name;
+}
+
+void traceInstant(const char* name, const char* argName = nullptr, uint64_t arg = 0) {
+    if (!g_trace_enabled) return;
+    threadTraceBuffer().push({name, argName, traceNow(), 0, arg, 'i'});
+}
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, const char* argName = nullptr, uint64_t arg = 0)
+        : name_(name), argName_(argName), arg_(arg), start_(0) {
+        if (g_trace_enabled) start_ = traceNow();
+    }
+
+    ~TraceScope() {
+        if (!start_) return;
+        threadTraceBuffer().push({name_, argName_, start_, traceNow() - start_, arg_, 'X'});
+    }
+
+private:
+    const char* name_;
+    const char* argName_;
+    uint64_t arg_;
+    uint64_t start_;
+};
+
+// In a freshly forked worker only the forking thread survives; drop the
+// launcher's events so they are not written twice.
+void resetTraceAfterFork() {
+    std::lock_guard<std::mutex> guard(g_trace_lock);
+    for (TraceBuffer* tb : g_trace_buffers) {
+        tb->events.clear();
+        tb->recorded = 0;
+    }
+    g_trace_children.clear();
+}
+
+// Comma-separated event objects, without the surrounding array.
+void writeTraceEvents(std::ostream& os, bool& first) {
+    std::lock_guard<std::mutex> guard(g_trace_lock);
+    const long pid = static_cast<long>(getpid());
+    os << std::fixed << std::setprecision(3);
+    for (const TraceBuffer* tb : g_trace_buffers) {
+        if (tb->dropped())
+            std::cerr << "Warning: trace thread " << tb->tid << " kept its newest " << tb->events.size()
+                      << " events; " << tb->dropped() << " older events were dropped.\n";
+        if (!tb->threadName.empty()) {
+            os << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+               << ",\"tid\":" << tb->tid << ",\"args\":{\"name\":\"" << jsonEscape(tb->threadName) << "\"}}";
+            first = false;
+        }
+        for (size_t k = 0; k < tb->events.size(); ++k) {
+            const TraceEvent& e = tb->at(k);
+            os << (first ? "" : ",\n") << "{\"name\":\"" << jsonEscape(e.name) << "\",\"ph\":\"" << e.phase
+               << "\",\"pid\":" << pid << ",\"tid\":" << tb->tid << ",\"ts\":" << e.startNs / 1000.0;
+            if (e.phase == 'X') os << ",\"dur\":" << e.durNs / 1000.0;
+            else os << ",\"s\":\"t\"";
+            if (e.argName) os << ",\"args\":{\"" << jsonEscape(e.argName) << "\":" << e.arg << "}";
+            os << "}";
+            first = false;
+        }
+    }
+}
+
+void writeTraceFragment() {
+    if (!g_trace_enabled) return;
+    std::ofstream os(g_trace_path + "." + std::to_string(getpid()));
+    bool first = true;
+    writeTraceEvents(os, first);
+}
+
+void writeChromeTrace() {
+    if (!g_trace_enabled) return;
+    std::ofstream os(g_trace_path);
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    writeTraceEvents(os, first);
+    for (pid_t child : g_trace_children) {
+        std::string fragment = g_trace_path + "." + std::to_string(child);
+        std::ifstream in(fragment);
+        std::stringstream body;
+        body << in.rdbuf();
+        std::string text = body.str();
+        if (text.empty()) continue;
+        os << (first ? "" : ",\n") << text;
+        first = false;
+        std::remove(fragment.c_str());
+    }
+    os << "\n]}\n";
+    if (!os) std::cerr << "Warning: could not write trace " << g_trace_path << "\n";
+}
+
+// ==========================================================
+// Fuel Library
+// ==========================================================
+// Fuel 0 ("input") is the two-gas model: Q_HV and cp_gas come from the
+// inputs. Library fuels carry a lower heating value, a stoichiometric
+// fuel-air ratio and tables of burned-gas properties against temperature and
+// fuel-air ratio. The tables are built once at startup from NASA
+// polynomials for N2, O2, CO2 and H2O, assuming lean complete combustion in
+// dry air. The burner stages read Q_HV from the fuel and the products cp
+// from its table; compressors, turbines and the nozzle read gamma from it
+// (the zero fuel-air row is air). A fuel axis in a sweep costs a few
+// interpolations per point. The inlet and the other stages keep the
+// cp/gamma inputs.
+// Loaded equilibrium tables (Equilibrium Tables) replace the frozen ones.
+//
+// Table cp is the model's mean cp: cp(T) * T is the sensible enthalpy above
+// 0 K (constant cp below 298.15 K), so it drops into the cp * T balances.
+// Table gamma is the local cp / cv.
+const int kFuelTemps = 29;                  // 200 K to 3000 K
+const int kFuelRatios = 11;                 // 0 to stoichiometric in tenths
+const double kFuelTempLo = 200.0, kFuelTempStep = 100.0;
+const int kFuelIterations = 3;              // fixed-point steps on the burner fuel-air ratio
+
+struct FuelSpec {
+    const char* name;
+    double wC, wH;      // carbon and hydrogen mass fractions
+    double Q_HV;        // lower heating value, J/kg
+};
+
+const FuelSpec kFuelSpecs[] = {
+    {"input", 0.0, 0.0, 0.0},
+    {"jet-a", 0.8615, 0.1385, 43.2e6},      // C12H23
+    {"saf", 0.8461, 0.1539, 44.1e6},        // HEFA-SPK, C12H26 surrogate
+    {"saf50", 0.8538, 0.1462, 43.65e6},     // 50/50 Jet-A/SAF by mass
+    {"methane", 0.7487, 0.2513, 50.0e6},
+    {"hydrogen", 0.0, 1.0, 120.0e6},
+};
+const int kFuelCount = sizeof(kFuelSpecs) / sizeof(kFuelSpecs[0]);
+
+struct EquilibriumTable;
+
+// Clamps a fractional table index to [0, hi]; NaN maps to 0, so a guarded
+// corner upstream cannot index outside the table.
+inline double tableIndex(double x, double hi) { return std::min(hi, std::max(0.0, x)); }
+
+struct Fuel {
+    const char* name;
+    double Q_HV, far_stoich;
+    double cp[kFuelRatios][kFuelTemps];
+    double gamma[kFuelRatios][kFuelTemps];
+    const EquilibriumTable* eq = nullptr;   // set by --equilibrium
+
+    // Bilinear, clamped to the table.
+    double lookup(const double (&table)[kFuelRatios][kFuelTemps], double Tt, double far) const {
+        double x = tableIndex((Tt - kFuelTempLo) / kFuelTempStep, kFuelTemps - 1.0);
+        double y = tableIndex(far / far_stoich * (kFuelRatios - 1), kFuelRatios - 1.0);
+        int i = std::min(static_cast<int>(x), kFuelTemps - 2);
+        int j = std::min(static_cast<int>(y), kFuelRatios - 2);
+        double dx = x - i, dy = y - j;
+        double lo = table[j][i] + dx * (table[j][i + 1] - table[j][i]);
+        double hi = table[j + 1][i] + dx * (table[j + 1][i + 1] - table[j + 1][i]);
+        return lo + dy * (hi - lo);
+    }
+    double cpAt(double Tt, double far) const { return lookup(cp, Tt, far); }
+    double gammaAt(double Tt, double far) const { return lookup(gamma, Tt, far); }
+    // Mean cp of the products: equilibrium when loaded, otherwise frozen.
+    double meanCp(double Tt, double Pt, double far) const;
+    // gamma of the products, likewise.
+    double gammaOf(double Tt, double Pt, double far) const;
+
+    // Fuel per unit of entering stream (enthalpy h_in, fuel-air ratio far_in)
+    // to reach Tt_out at Pt_out: the cp * T balance with the products cp at
+    // the exit composition, which depends on the answer.
+    double burnerRatio(double h_in, double far_in, double Tt_out, double Pt_out, double eta) const {
+        double f = 0.0;
+        for (int it = 0; it < kFuelIterations; ++it) {
+            double h_out = meanCp(Tt_out, Pt_out, far_in + f * (1.0 + far_in)) * Tt_out;
+            double denom = eta * Q_HV - h_out;
+            if (denom <= 0) denom = std::numeric_limits<double>::epsilon();
+            f = (h_out - h_in) / denom;
+        }
+        return f;
+    }
+
+    // Afterburner: the entering gas is products at far_in.
+    double afterburnerRatio(double Tt_in, double Pt_in, double far_in, double Tt_out, double Pt_out,
+                            double eta) const {
+        return burnerRatio(meanCp(Tt_in, Pt_in, far_in) * Tt_in, far_in, Tt_out, Pt_out, eta);
+    }
+};
+
+// NASA 7-coefficient fits (GRI-Mech 3.0): 200-1000 K and 1000-3500 K;
+// a[5] and a[6] are the enthalpy and entropy constants.
+struct SpeciesFit { double lo[7], hi[7]; };
+
+const SpeciesFit kSpeciesN2 = {
+    {3.29867700E+00, 1.40824040E-03, -3.96322200E-06, 5.64151500E-09, -2.44485400E-12, -1.02089990E+03,
+     3.95037200E+00},
+    {2.92664000E+00, 1.48797680E-03, -5.68476000E-07, 1.00970380E-10, -6.75335100E-15, -9.22797700E+02,
+     5.98052800E+00}};
+const SpeciesFit kSpeciesO2 = {
+    {3.78245636E+00, -2.99673416E-03, 9.84730201E-06, -9.68129509E-09, 3.24372837E-12, -1.06394356E+03,
+     3.65767573E+00},
+    {3.28253784E+00, 1.48308754E-03, -7.57966669E-07, 2.09470555E-10, -2.16717794E-14, -1.08845772E+03,
+     5.45323129E+00}};
+const SpeciesFit kSpeciesCO2 = {
+    {2.35677352E+00, 8.98459677E-03, -7.12356269E-06, 2.45919022E-09, -1.43699548E-13, -4.83719697E+04,
+     9.90105222E+00},
+    {3.85746029E+00, 4.41437026E-03, -2.21481404E-06, 5.23490188E-10, -4.72084164E-14, -4.87591660E+04,
+     2.27163806E+00}};
+const SpeciesFit kSpeciesH2O = {
+    {4.19864056E+00, -2.03643410E-03, 6.52040211E-06, -5.48797062E-09, 1.77197817E-12, -3.02937267E+04,
+     -8.49032208E-01},
+    {3.03399249E+00, 2.17691804E-03, -1.64072518E-07, -9.70419870E-11, 1.68200992E-14, -3.00042971E+04,
+     4.96677010E+00}};
+
+const double kGasConstant = 8314.46;        // J/(kmol K)
+
+inline double speciesCp(const SpeciesFit& s, double T) {    // J/(kmol K)
+    const double* a = T < 1000.0 ? s.lo : s.hi;
+    return kGasConstant * (a[0] + T * (a[1] + T * (a[2] + T * (a[3] + T * a[4]))));
+}
+
+inline double speciesH(const SpeciesFit& s, double T) {     // J/kmol
+    const double* a = T < 1000.0 ? s.lo : s.hi;
+    return kGasConstant * (T * (a[0] + T * (a[1] / 2 + T * (a[2] / 3 + T * (a[3] / 4 + T * a[4] / 5)))) + a[5]);
+}
+
+Fuel buildFuel(const FuelSpec& spec) {
+    Fuel fuel{};
+    fuel.name = spec.name;
+    fuel.Q_HV = spec.Q_HV;
+    if (spec.wC + spec.wH <= 0) return fuel;
+    const double M_air = 28.965, x_O2 = 0.2095;
+    const double nC = spec.wC / 12.011, nH = spec.wH / 1.008;     // kmol per kg fuel
+    const double nO2_air = x_O2 / M_air, nN2_air = (1.0 - x_O2) / M_air;
+    fuel.far_stoich = nO2_air / (nC + nH / 4.0);
+    const double T_ref = 298.15;
+    for (int j = 0; j < kFuelRatios; ++j) {
+        double f = fuel.far_stoich * j / (kFuelRatios - 1);
+        // Products of 1 kg air and f kg fuel, kmol.
+        const SpeciesFit* sp[4] = {&kSpeciesN2, &kSpeciesO2, &kSpeciesCO2, &kSpeciesH2O};
+        double n[4] = {nN2_air, nO2_air - f * (nC + nH / 4.0), f * nC, f * nH / 2.0};
+        double moles = n[0] + n[1] + n[2] + n[3];
+        double cp_ref = 0.0, h_ref = 0.0;
+        for (int k = 0; k < 4; ++k) {
+            cp_ref += n[k] * speciesCp(*sp[k], T_ref);
+            h_ref += n[k] * speciesH(*sp[k], T_ref);
+        }
+        for (int i = 0; i < kFuelTemps; ++i) {
+            double T = kFuelTempLo + kFuelTempStep * i;
+            double cp_T = 0.0, h_T = 0.0;
+            for (int k = 0; k < 4; ++k) {
+                cp_T += n[k] * speciesCp(*sp[k], T);
+                h_T += n[k] * speciesH(*sp[k], T);
+            }
+            fuel.cp[j][i] = (h_T - h_ref + cp_ref * T_ref) / T / (1.0 + f);
+            fuel.gamma[j][i] = cp_T / (cp_T - kGasConstant * moles);
+        }
+    }
+    return fuel;
+}
+
+std::vector<Fuel> buildFuelLibrary() {
+    std::vector<Fuel> fuels;
+    for (const FuelSpec& spec : kFuelSpecs) fuels.push_back(buildFuel(spec));
+    return fuels;
+}
+
+// Built at startup; loadEquilibriumTables() attaches tables before any work starts.
+std::vector<Fuel> g_fuels = buildFuelLibrary();
+
+// Fuel inputs are library indices, rounded; 0 selects the input gas model.
+inline int fuelIndex(double fuel) {
+    return fuel < 0.5 ? 0 : std::min(static_cast<int>(fuel + 0.5), kFuelCount - 1);
+}
+
+inline const Fuel& fuelFor(double fuel) { return g_fuels[fuelIndex(fuel)]; }
+
+void printFuelLibrary(std::ostream& os) {
+    using namespace std;
+    os << "\n--- FUEL LIBRARY (products cp in J/(kg K), at half stoichiometric) ---\n";
+    os << setw(6) << "Index" << setw(10) << "Fuel" << setw(12) << "Q_HV MJ/kg" << setw(10) << "FAR st"
+       << setw(11) << "cp 1000K" << setw(11) << "cp 2000K" << setw(13) << "gamma 2000K" << "\n";
+    for (int k = 0; k < kFuelCount; ++k) {
+        const Fuel& f = g_fuels[k];
+        os << setw(6) << k << setw(10) << f.name;
+        if (k == 0) { os << "   (Q_HV, cp_gas and gamma_gas inputs)\n"; continue; }
+        double far = 0.5 * f.far_stoich;
+        os << fixed << setprecision(2) << setw(12) << f.Q_HV / 1e6 << setprecision(4) << setw(10) << f.far_stoich
+           << setprecision(1) << setw(11) << f.cpAt(1000.0, far) << setw(11) << f.cpAt(2000.0, far)
+           << setprecision(4) << setw(13) << f.gammaAt(2000.0, far) << "\n";
+    }
+    os << "-----------------------------------\n";
+}
+
+// ==========================================================
+// Equilibrium Tables
+// ==========================================================
+// Above about 1800 K the burned gas dissociates: CO2 and H2O partly split
+// into CO, H2, OH, H and O, and air forms NO. That absorbs heat, so the
+// afterburner needs more fuel for the same T_t7, and some of it comes back
+// as the gas recombines in the nozzle. Solving the equilibrium per point is
+// too slow for sweeps, so --gen-equilibrium FILE minimizes the Gibbs energy
+// offline, in parallel over --threads, on a (T, P, fuel-air ratio) grid for
+// every library fuel. --equilibrium FILE loads the result. The burner stages
+// then balance energy against the equilibrium enthalpy, and the nozzle
+// expands along it. Each lookup is a trilinear interpolation. Without a
+// loaded file, library fuels use the frozen tables above.
+//
+// Grid: 200-3000 K every 50 K; 5 kPa to 10.24 MPa in factors of two,
+// interpolated in log P; fuel-air ratio lean to stoichiometric as in the
+// frozen tables. Outside the grid, lookups clamp.
+const int kEqTemps = 57;
+const double kEqTempLo = 200.0, kEqTempStep = 50.0;
+const int kEqPressures = 12;
+const double kEqPressureLo = 5000.0;        // Pa; each row doubles
+const double kEqPressureRef = 1.0e5;        // standard state of the fits
+const int kEqMaxIterations = 200;
+
+// GRI-Mech 3.0 fits for the minor species.
+const SpeciesFit kSpeciesCO = {
+    {3.57953347E+00, -6.10353680E-04, 1.01681433E-06, 9.07005884E-10, -9.04424499E-13, -1.43440860E+04,
+     3.50840928E+00},
+    {2.71518561E+00, 2.06252743E-03, -9.98825771E-07, 2.30053008E-10, -2.03647716E-14, -1.41518724E+04,
+     7.81868772E+00}};
+const SpeciesFit kSpeciesH2 = {
+    {2.34433112E+00, 7.98052075E-03, -1.94781510E-05, 2.01572094E-08, -7.37611761E-12, -9.17935173E+02,
+     6.83010238E-01},
+    {3.33727920E+00, -4.94024731E-05, 4.99456778E-07, -1.79566394E-10, 2.00255376E-14, -9.50158922E+02,
+     -3.20502331E+00}};
+const SpeciesFit kSpeciesOH = {
+    {3.99201543E+00, -2.40131752E-03, 4.61793841E-06, -3.88113333E-09, 1.36411470E-12, 3.61508056E+03,
+     -1.03925458E-01},
+    {3.09288767E+00, 5.48429716E-04, 1.26505228E-07, -8.79461556E-11, 1.17412376E-14, 3.85865700E+03,
+     4.47669610E+00}};
+const SpeciesFit kSpeciesH = {
+    {2.50000000E+00, 7.05332819E-13, -1.99591964E-15, 2.30081632E-18, -9.27732332E-22, 2.54736599E+04,
+     -4.46682853E-01},
+    {2.50000001E+00, -2.30842973E-11, 1.61561948E-14, -4.73515235E-18, 4.98197357E-22, 2.54736599E+04,
+     -4.46682914E-01}};
+const SpeciesFit kSpeciesO = {
+    {3.16826710E+00, -3.27931884E-03, 6.64306396E-06, -6.12806624E-09, 2.11265971E-12, 2.91222592E+04,
+     2.05193346E+00},
+    {2.56942078E+00, -8.59741137E-05, 4.19484589E-08, -1.00177799E-11, 1.22833691E-15, 2.92175791E+04,
+     4.78433864E+00}};
+const SpeciesFit kSpeciesNO = {
+    {4.21847630E+00, -4.63897600E-03, 1.10410220E-05, -9.33613540E-09, 2.80357700E-12, 9.84462300E+03,
+     2.28084640E+00},
+    {3.26060560E+00, 1.19110430E-03, -4.29170480E-07, 6.94576690E-11, -4.03360990E-15, 9.92097460E+03,
+     6.36930270E+00}};
+const SpeciesFit kSpeciesN = {
+    {2.50000000E+00, 0.0, 0.0, 0.0, 0.0, 5.61046370E+04, 4.19390870E+00},
+    {2.41594290E+00, 1.74890650E-04, -1.19023690E-07, 3.02262450E-11, -2.03609820E-15, 5.61337730E+04,
+     4.64960960E+00}};
+
+enum EqElement { EL_C, EL_H, EL_O, EL_N, kEqElements };
+
+struct EqSpecies {
+    const char* name;
+    const SpeciesFit* fit;
+    int atoms[kEqElements];     // C, H, O, N
+};
+
+const EqSpecies kEqSpecies[] = {
+    {"N2", &kSpeciesN2, {0, 0, 0, 2}}, {"O2", &kSpeciesO2, {0, 0, 2, 0}},
+    {"CO2", &kSpeciesCO2, {1, 0, 2, 0}}, {"H2O", &kSpeciesH2O, {0, 2, 1, 0}},
+    {"CO", &kSpeciesCO, {1, 0, 1, 0}}, {"H2", &kSpeciesH2, {0, 2, 0, 0}},
+    {"OH", &kSpeciesOH, {0, 1, 1, 0}}, {"H", &kSpeciesH, {0, 1, 0, 0}},
+    {"O", &kSpeciesO, {0, 0, 1, 0}}, {"NO", &kSpeciesNO, {0, 0, 1, 1}},
+    {"N", &kSpeciesN, {0, 0, 0, 1}},
+};
+const int kEqSpeciesCount = sizeof(kEqSpecies) / sizeof(kEqSpecies[0]);
+
+inline double speciesGibbsRT(const SpeciesFit& s, double T) {   // g / (R T) at the reference pressure
+    const double* a = T < 1000.0 ? s.lo : s.hi;
+    double hRT = a[0] + T * (a[1] / 2 + T * (a[2] / 3 + T * (a[3] / 4 + T * a[4] / 5))) + a[5] / T;
+    double sR = a[0] * std::log(T) + T * (a[1] + T * (a[2] / 2 + T * (a[3] / 3 + T * a[4] / 4))) + a[6];
+    return hRT - sR;
+}
+
+// Gibbs minimization at fixed T and P by the element-potential Newton method
+// of NASA CEA (Gordon & McBride, RP-1311). b holds kmol of C, H, O and N
+// atoms; lnn holds ln(kmol) of each species and lnN ln(total kmol), on entry
+// the starting guess. Elements that are absent drop out with their species.
+bool solveEquilibrium(double T, double P, const double b[kEqElements], double lnn[kEqSpeciesCount],
+                      double& lnN) {
+    const int kMax = kEqElements + 1;
+    bool present[kEqElements];
+    int elems[kEqElements], m = 0;
+    for (int e = 0; e < kEqElements; ++e) {
+        present[e] = b[e] > 0;
+        if (present[e]) elems[m++] = e;
+    }
+    bool active[kEqSpeciesCount];
+    double g[kEqSpeciesCount];
+    for (int j = 0; j < kEqSpeciesCount; ++j) {
+        active[j] = true;
+        for (int e = 0; e < kEqElements; ++e)
+            if (kEqSpecies[j].atoms[e] && !present[e]) active[j] = false;
+        g[j] = speciesGibbsRT(*kEqSpecies[j].fit, T) + std::log(P / kEqPressureRef);
+    }
+    const double kTrace = -18.420681;           // ln 1e-8
+    for (int it = 0; it < kEqMaxIterations; ++it) {
+        double n[kEqSpeciesCount], mu[kEqSpeciesCount];
+        double N = std::exp(lnN), sum_n = 0.0;
+        for (int j = 0; j < kEqSpeciesCount; ++j) {
+            n[j] = active[j] ? std::exp(lnn[j]) : 0.0;
+            mu[j] = active[j] ? g[j] + lnn[j] - lnN : 0.0;
+            sum_n += n[j];
+        }
+        double A[kMax][kMax + 1] = {};
+        for (int r = 0; r < m; ++r) {
+            int k = elems[r];
+            for (int c = 0; c < m; ++c) {
+                int i = elems[c];
+                for (int j = 0; j < kEqSpeciesCount; ++j)
+                    A[r][c] += kEqSpecies[j].atoms[k] * kEqSpecies[j].atoms[i] * n[j];
+            }
+            double bk = 0.0, amu = 0.0;
+            for (int j = 0; j < kEqSpeciesCount; ++j) {
+                bk += kEqSpecies[j].atoms[k] * n[j];
+                amu += kEqSpecies[j].atoms[k] * n[j] * mu[j];
+            }
+            A[r][m] = bk;
+            A[r][m + 1] = b[k] - bk + amu;
+        }
+        double nmu = 0.0;
+        for (int c = 0; c < m; ++c) A[m][c] = A[c][m];
+        for (int j = 0; j < kEqSpeciesCount; ++j) nmu += n[j] * mu[j];
+        A[m][m] = sum_n - N;
+        A[m][m + 1] = N - sum_n + nmu;
+        // Gaussian elimination with partial pivoting.
+        const int size = m + 1;
+        for (int c = 0; c < size; ++c) {
+            int pivot = c;
+            for (int r = c + 1; r < size; ++r)
+                if (std::fabs(A[r][c]) > std::fabs(A[pivot][c])) pivot = r;
+            if (A[pivot][c] == 0.0) return false;
+            for (int k = 0; k <= size; ++k) std::swap(A[c][k], A[pivot][k]);
+            for (int r = c + 1; r < size; ++r) {
+                double factor = A[r][c] / A[c][c];
+                for (int k = c; k <= size; ++k) A[r][k] -= factor * A[c][k];
+            }
+        }
+        double x[kMax];
+        for (int r = size - 1; r >= 0; --r) {
+            double v = A[r][size];
+            for (int k = r + 1; k < size; ++k) v -= A[r][k] * x[k];
+            x[r] = v / A[r][r];
+        }
+        // Corrections, damped as in CEA: major species move at most by a
+        // factor e^2, trace species may not jump above 1e-4 in one step.
+        double dlnN = x[m], dln[kEqSpeciesCount];
+        double largest = 5.0 * std::fabs(dlnN), lambda2 = 1.0;
+        for (int j = 0; j < kEqSpeciesCount; ++j) {
+            if (!active[j]) continue;
+            double pi = 0.0;
+            for (int c = 0; c < m; ++c) pi += kEqSpecies[j].atoms[elems[c]] * x[c];
+            dln[j] = -mu[j] + pi + dlnN;
+            if (lnn[j] - lnN > kTrace) largest = std::max(largest, std::fabs(dln[j]));
+            else if (dln[j] >= 0 && dln[j] != dlnN)
+                lambda2 = std::min(lambda2, std::fabs((lnN - lnn[j] - 9.2103404) / (dln[j] - dlnN)));
+        }
+        double lambda = std::min(lambda2, largest > 2.0 ? 2.0 / largest : 1.0);
+        bool converged = N * std::fabs(dlnN) <= 0.5e-5 * sum_n;
+        for (int j = 0; j < kEqSpeciesCount; ++j) {
+            if (!active[j]) continue;
+            if (n[j] * std::fabs(dln[j]) > 0.5e-5 * sum_n) converged = false;
+            lnn[j] = std::max(lnn[j] + lambda * dln[j], lnN - 700.0);
+        }
+        lnN += lambda * dlnN;
+        if (converged) {
+            for (int j = 0; j < kEqSpeciesCount; ++j)
+                if (!active[j]) lnn[j] = -std::numeric_limits<double>::infinity();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Equilibrium properties on the grid, per fuel. Enthalpy is stored like the
+// frozen tables, as a mean cp: (h - h_complete(298.15 K)) / T plus the
+// constant-cp extension below 298.15 K, so the burner balance keeps its form
+// and the two models agree where nothing dissociates. cp is dh/dT at
+// shifting composition; gamma is the isentropic exponent (d ln P / d ln rho)_s.
+struct EquilibriumTable {
+    double far_stoich = 0.0;
+    std::vector<double> meanCp, cp, gamma;   // [ratio][pressure][temperature]
+    std::vector<double> moles;               // mole fractions, [species][ratio][pressure][temperature]
+
+    static size_t cells() { return static_cast<size_t>(kFuelRatios) * kEqPressures * kEqTemps; }
+    static size_t index(int j, int p, int i) { return (static_cast<size_t>(j) * kEqPressures + p) * kEqTemps + i; }
+
+    void allocate() {
+        meanCp.assign(cells(), 0.0);
+        cp.assign(cells(), 0.0);
+        gamma.assign(cells(), 0.0);
+        moles.assign(cells() * kEqSpeciesCount, 0.0);
+    }
+
+    // Trilinear in (T, log2 P, far), clamped to the grid.
+    double lookup(const double* table, double Tt, double Pt, double far) const {
+        double x = tableIndex((Tt - kEqTempLo) / kEqTempStep, kEqTemps - 1.0);
+        double y = tableIndex(std::log2(std::max(kEqPressureLo, Pt) / kEqPressureLo), kEqPressures - 1.0);
+        double z = tableIndex(far / far_stoich * (kFuelRatios - 1), kFuelRatios - 1.0);
+        int i = std::min(static_cast<int>(x), kEqTemps - 2);
+        int p = std::min(static_cast<int>(y), kEqPressures - 2);
+        int j = std::min(static_cast<int>(z), kFuelRatios - 2);
+        double dx = x - i, dy = y - p, dz = z - j;
+        double v[2];
+        for (int k = 0; k < 2; ++k) {
+            const double* lo = table + index(j + k, p, i);
+            const double* hi = table + index(j + k, p + 1, i);
+            double a = lo[0] + dx * (lo[1] - lo[0]);
+            double b = hi[0] + dx * (hi[1] - hi[0]);
+            v[k] = a + dy * (b - a);
+        }
+        return v[0] + dz * (v[1] - v[0]);
+    }
+    double meanCpAt(double Tt, double Pt, double far) const { return lookup(meanCp.data(), Tt, Pt, far); }
+    double cpAt(double Tt, double Pt, double far) const { return lookup(cp.data(), Tt, Pt, far); }
+    double gammaAt(double Tt, double Pt, double far) const { return lookup(gamma.data(), Tt, Pt, far); }
+    double moleFraction(int species, double Tt, double Pt, double far) const {
+        return lookup(moles.data() + species * cells(), Tt, Pt, far);
+    }
+
+    // Exit velocity of a nozzle expanding to P9 in shifting equilibrium: the
+    // isentropic exponent is averaged over the expansion and the velocity
+    // comes from the enthalpy drop, so recombination heat is recovered.
+    double nozzleVelocity(double Tt9, double Pt9, double P9, double far, double eta_n) const {
+        P9 = std::min(P9, Pt9);                 // no expansion when Pt9 is below ambient
+        double r = P9 / Pt9;
+        double g0 = gammaAt(Tt9, Pt9, far);
+        double T9_isen = Tt9 * std::pow(r, (g0 - 1.0) / g0);
+        double g = 0.5 * (g0 + gammaAt(T9_isen, P9, far));
+        T9_isen = Tt9 * std::pow(r, (g - 1.0) / g);
+        double T9 = Tt9 - eta_n * (Tt9 - T9_isen);
+        double dh = meanCpAt(Tt9, Pt9, far) * Tt9 - meanCpAt(T9, P9, far) * T9;
+        return std::sqrt(std::max(0.0, 2.0 * dh));
+    }
+};
+
+// Products of 1 kg of air and f kg of fuel: element abundances in kmol.
+void mixtureElements(const FuelSpec& spec, double f, double b[kEqElements]) {
+    const double M_air = 28.965, x_O2 = 0.2095;
+    b[EL_C] = f * spec.wC / 12.011;
+    b[EL_H] = f * spec.wH / 1.008;
+    b[EL_O] = 2.0 * x_O2 / M_air;
+    b[EL_N] = 2.0 * (1.0 - x_O2) / M_air;
+}
+
+// One (fuel-air ratio, pressure) row of a table. Each point is solved at T
+// and at T +- 1 K and P * (1 +- 1%) for the derivatives, warm-started from
+// the previous temperature.
+bool fillEquilibriumRow(const FuelSpec& spec, EquilibriumTable& t, int j, int p) {
+    const double T_ref = 298.15;
+    double f = t.far_stoich * j / (kFuelRatios - 1);
+    double P = kEqPressureLo * std::ldexp(1.0, p);
+    double b[kEqElements];
+    mixtureElements(spec, f, b);
+    // Complete-combustion reference, as in the frozen tables.
+    const SpeciesFit* sp[4] = {&kSpeciesN2, &kSpeciesO2, &kSpeciesCO2, &kSpeciesH2O};
+    double nc[4] = {b[EL_N] / 2, b[EL_O] / 2 - b[EL_C] - b[EL_H] / 4, b[EL_C], b[EL_H] / 2};
+    double cp_ref = 0.0, h_ref = 0.0;
+    for (int k = 0; k < 4; ++k) {
+        cp_ref += nc[k] * speciesCp(*sp[k], T_ref);
+        h_ref += nc[k] * speciesH(*sp[k], T_ref);
+    }
+    double lnn[kEqSpeciesCount], lnN = std::log(0.1);
+    for (int k = 0; k < kEqSpeciesCount; ++k) lnn[k] = std::log(0.1 / kEqSpeciesCount);
+    auto solve = [&](double T, double Pk, double* ln_out, double& lnN_out, double& H) {
+        std::copy(lnn, lnn + kEqSpeciesCount, ln_out);
+        lnN_out = lnN;
+        if (!solveEquilibrium(T, Pk, b, ln_out, lnN_out)) return false;
+        H = 0.0;
+        for (int k = 0; k < kEqSpeciesCount; ++k) H += std::exp(ln_out[k]) * speciesH(*kEqSpecies[k].fit, T);
+        return true;
+    };
+    const double dT = 1.0, dP = 1.01;
+    for (int i = 0; i < kEqTemps; ++i) {
+        double T = kEqTempLo + kEqTempStep * i;
+        double ln0[kEqSpeciesCount], lnA[kEqSpeciesCount], lnB[kEqSpeciesCount];
+        double N0, NTp, NTm, NPp, NPm, H0, Hp, Hm, unused;
+        bool ok = solve(T, P, ln0, N0, H0) && solve(T + dT, P, lnA, NTp, Hp) && solve(T - dT, P, lnB, NTm, Hm) &&
+                  solve(T, P * dP, lnA, NPp, unused) && solve(T, P / dP, lnB, NPm, unused);
+        if (!ok) return false;
+        std::copy(ln0, ln0 + kEqSpeciesCount, lnn);
+        lnN = N0;
+        size_t c = EquilibriumTable::index(j, p, i);
+        double mass = 1.0 + f;
+        double cp_eq = (Hp - Hm) / (2.0 * dT) / mass;
+        double dlnV_dlnT = 1.0 + (NTp - NTm) / (std::log(T + dT) - std::log(T - dT));
+        double dlnV_dlnP = -1.0 + (NPp - NPm) / (2.0 * std::log(dP));
+        double cv = cp_eq + std::exp(N0) / mass * kGasConstant * dlnV_dlnT * dlnV_dlnT / dlnV_dlnP;
+        t.meanCp[c] = (H0 - h_ref + cp_ref * T_ref) / T / mass;
+        t.cp[c] = cp_eq;
+        t.gamma[c] = -(cp_eq / cv) / dlnV_dlnP;
+        for (int k = 0; k < kEqSpeciesCount; ++k)
+            t.moles[k * EquilibriumTable::cells() + c] = std::exp(ln0[k] - N0);
+    }
+    return true;
+}
+
+// Fills the tables of every library fuel; rows are shared out to the threads.
+bool generateEquilibriumTables(std::vector<EquilibriumTable>& tables, int threads) {
+    tables.assign(kFuelCount, EquilibriumTable());
+    std::vector<int> rows;
+    for (int k = 1; k < kFuelCount; ++k) {
+        tables[k].far_stoich = g_fuels[k].far_stoich;
+        tables[k].allocate();
+        for (int r = 0; r < kFuelRatios * kEqPressures; ++r) rows.push_back(k * kFuelRatios * kEqPressures + r);
+    }
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    auto body = [&]() {
+        for (size_t r; (r = next.fetch_add(1)) < rows.size();) {
+            int k = rows[r] / (kFuelRatios * kEqPressures), rest = rows[r] % (kFuelRatios * kEqPressures);
+            if (!fillEquilibriumRow(kFuelSpecs[k], tables[k], rest / kEqPressures, rest % kEqPressures))
+                failed = true;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int w = 0; w < std::max(1, threads); ++w) pool.emplace_back(body);
+    for (std::thread& t : pool) t.join();
+    return !failed;
+}
+
+// File: magic, grid sizes, then per library fuel its name, stoichiometric
+// fuel-air ratio and arrays. A file only loads into the grid and library it
+// was generated for.
+const char kEquilibriumMagic[8] = {'E', 'N', 'G', 'E', 'Q', 'U', '0', '1'};
+const size_t kEqNameLength = 16;
+
+bool writeEquilibriumTables(const std::string& path, const std::vector<EquilibriumTable>& tables) {
+    std::ofstream out(path, std::ios::binary);
+    uint64_t dims[5] = {kEqTemps, kEqPressures, kFuelRatios, kEqSpeciesCount, kFuelCount - 1};
+    out.write(kEquilibriumMagic, 8);
+    out.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+    auto put = [&](const std::vector<double>& v) {
+        out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(double)));
+    };
+    for (int k = 1; k < kFuelCount; ++k) {
+        char name[kEqNameLength] = {};
+        std::strncpy(name, kFuelSpecs[k].name, kEqNameLength - 1);
+        out.write(name, kEqNameLength);
+        out.write(reinterpret_cast<const char*>(&tables[k].far_stoich), sizeof(double));
+        put(tables[k].meanCp);
+        put(tables[k].cp);
+        put(tables[k].gamma);
+        put(tables[k].moles);
+    }
+    return static_cast<bool>(out);
+}
+
+// Loaded tables; library fuels point into this once --equilibrium succeeds.
+std::vector<EquilibriumTable> g_equilibrium;
+uint64_t g_equilibrium_signature = 0;      // hash of the loaded arrays, 0 when none (SweepSpec::signature)
+
+bool loadEquilibriumTables(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: cannot open equilibrium tables " << path << "\n";
+        return false;
+    }
+    char magic[8];
+    uint64_t dims[5];
+    in.read(magic, 8);
+    in.read(reinterpret_cast<char*>(dims), sizeof(dims));
+    uint64_t expected[5] = {kEqTemps, kEqPressures, kFuelRatios, kEqSpeciesCount, kFuelCount - 1};
+    if (!in || std::memcmp(magic, kEquilibriumMagic, 8) != 0 || std::memcmp(dims, expected, sizeof(dims)) != 0) {
+        std::cerr << "Error: " << path << " is not an equilibrium table file for this build.\n";
+        return false;
+    }
+    std::vector<EquilibriumTable> tables(kFuelCount);
+    auto get = [&](std::vector<double>& v) {
+        in.read(reinterpret_cast<char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(double)));
+    };
+    for (int k = 1; k < kFuelCount; ++k) {
+        char name[kEqNameLength];
+        in.read(name, kEqNameLength);
+        in.read(reinterpret_cast<char*>(&tables[k].far_stoich), sizeof(double));
+        tables[k].allocate();
+        get(tables[k].meanCp);
+        get(tables[k].cp);
+        get(tables[k].gamma);
+        get(tables[k].moles);
+        if (!in || std::strncmp(name, kFuelSpecs[k].name, kEqNameLength) != 0 ||
+            tables[k].far_stoich != g_fuels[k].far_stoich) {
+            std::cerr << "Error: " << path << " was generated for a different fuel library.\n";
+            return false;
+        }
+    }
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (int k = 1; k < kFuelCount; ++k)
+        for (const std::vector<double>* v : {&tables[k].meanCp, &tables[k].cp, &tables[k].gamma, &tables[k].moles})
+            h = fnv1a(h, v->data(), v->size() * sizeof(double));
+    g_equilibrium.swap(tables);
+    g_equilibrium_signature = h;
+    for (int k = 1; k < kFuelCount; ++k) g_fuels[k].eq = &g_equilibrium[k];
+    return true;
+}
+
+inline double Fuel::meanCp(double Tt, double Pt, double far) const {
+    return eq ? eq->meanCpAt(Tt, Pt, far) : cpAt(Tt, far);
+}
+
+inline double Fuel::gammaOf(double Tt, double Pt, double far) const {
+    return eq ? eq->gammaAt(Tt, Pt, far) : gammaAt(Tt, far);
+}
+
+// Equilibrium tables for a fuel input, or nullptr (input gas model, or none loaded).
+inline const EquilibriumTable* equilibriumFor(double fuel) {
+    return fuelIndex(fuel) != 0 ? g_fuels[fuelIndex(fuel)].eq : nullptr;
+}
+
+void printEquilibriumSummary(std::ostream& os) {
+    using namespace std;
+    os << "\n--- EQUILIBRIUM PRODUCTS (stoichiometric, 101.3 kPa; cpm is the mean cp h/T) ---\n";
+    os << setw(10) << "Fuel" << setw(8) << "T K" << setw(11) << "cpm frozen" << setw(9) << "cpm eq"
+       << setw(8) << "gamma" << setw(9) << "CO %" << setw(9) << "OH %" << setw(9) << "NO %" << setw(9) << "H2 %"
+       << "\n";
+    const int kCO = 4, kH2 = 5, kOH = 6, kNO = 9;
+    for (int k = 1; k < kFuelCount; ++k) {
+        const Fuel& fuel = g_fuels[k];
+        if (!fuel.eq) continue;
+        for (double T : {1500.0, 2000.0, 2500.0}) {
+            double far = fuel.far_stoich, P = 101325.0;
+            const EquilibriumTable& t = *fuel.eq;
+            os << setw(10) << fuel.name << fixed << setprecision(0) << setw(8) << T << setprecision(1)
+               << setw(11) << fuel.cpAt(T, far) << setw(9) << t.meanCpAt(T, P, far) << setprecision(4)
+               << setw(8) << t.gammaAt(T, P, far) << setprecision(3)
+               << setw(9) << 100 * t.moleFraction(kCO, T, P, far) << setw(9) << 100 * t.moleFraction(kOH, T, P, far)
+               << setw(9) << 100 * t.moleFraction(kNO, T, P, far) << setw(9) << 100 * t.moleFraction(kH2, T, P, far)
+               << "\n";
+        }
+    }
+    os << "-----------------------------------\n";
+}
+
+// ==========================================================
+// Power Split Search
+// ==========================================================
+// A turboprop divides the gas power left after the gas generator between the
+// power turbine and the jet. `split` is the share of the ideal expansion to
+// ambient taken by the power turbine; the optimum maximizes equivalent shaft
+// power (shaft plus jet thrust power over eta_prop). The objective needs no
+// pow: the nozzle's expansion ratio follows from the turbine's, so lanes of a
+// batch step through a fixed number of golden-section iterations together.
+const int kSplitIterations = 20;
+
+// The objective with its loop invariants folded in, so an evaluation costs
+// one division and one square root.
+template<typename T>
+struct SplitProblem {
+    T Tt45;             // gas generator exit temperature
+    T T9_isen;          // Tt45 after the ideal expansion to ambient
+    T drop_isen;        // Tt45 - T9_isen: ideal temperature drop per unit split
+    T drop;             // actual power turbine temperature drop per unit split
+    T shaft;            // shaft power per unit split
+    T nozzle;           // 2 cp_gas eta_n
+    T m_exit;           // jet mass flow: 1 + fuel - customer bleed
+    T V0;
+    T jet;              // V0 / eta_prop: equivalent power per unit thrust
+};
+
+// r = (P0/Pt45)^((gamma-1)/gamma) with gamma of the gas at 4.5; dh is the
+// ideal enthalpy drop from 4.5 to ambient, m_core the gas flow through the
+// power turbine.
+template<typename T>
+inline SplitProblem<T> powerSplitProblem(T Tt45, T r, T dh, T cp_gas, T eta_pt, T eta_n, T eta_gear, T eta_prop,
+                                         T m_core, T m_exit, T V0) {
+    T drop_isen = dh / cp_gas;
+    T drop = eta_pt * drop_isen;
+    return {Tt45, Tt45 * r, drop_isen, drop, eta_gear * m_core * (eta_pt * dh), 2.0 * cp_gas * eta_n,
+            m_exit, V0, V0 / eta_prop};
+}
+
+// Equivalent shaft power at a split: shaft power plus jet thrust power over
+// eta_prop.
+template<typename T>
+inline T splitObjective(const SplitProblem<T>& p, T split) {
+    T Tt5 = p.Tt45 - split * p.drop;
+    T Tt5_isen = p.Tt45 - split * p.drop_isen;
+    T ratio = select_min<T>(1.0, p.T9_isen / Tt5_isen);
+    T V9 = select_sqrt<T>(p.nozzle * (Tt5 - Tt5 * ratio));
+    return split * p.shaft + (p.m_exit * V9 - p.V0) * p.jet;
+}
+
+// Golden-section bracket on [0, 1]: a < c < d < b, with the objective at c
+// and d. fc > fd: the maximum lies in [a, d].
+template<typename T>
+struct SplitBracket {
+    T a, b, c, d;
+    T fc, fd;
+};
+
+const double kInvPhi = 0.6180339887498949;
+
+// The point the next step probes. Both candidates are computed, so lanes
+// pick one without branching.
+template<typename T>
+inline T splitProbe(const SplitBracket<T>& s) {
+    T left = s.d - kInvPhi * (s.d - s.a);
+    T right = s.c + kInvPhi * (s.b - s.c);
+    return s.fc > s.fd ? left : right;
+}
+
+// The bracket after probing x, where the objective is fx.
+template<typename T>
+inline SplitBracket<T> splitStep(const SplitBracket<T>& s, T x, T fx) {
+    const bool left = s.fc > s.fd;
+    return {left ? s.a : s.c, left ? s.d : s.b, left ? x : s.d, left ? s.c : x,
+            left ? fx : s.fd, left ? s.fc : fx};
+}
+
+// Golden-section maximization over [0, 1], a fixed number of steps.
+template<typename T>
+inline T searchPowerSplit(const SplitProblem<T>& p) {
+    T a = 0.0, b = 1.0;
+    T c = b - kInvPhi * (b - a);
+    T d = a + kInvPhi * (b - a);
+    SplitBracket<T> s{a, b, c, d, splitObjective(p, c), splitObjective(p, d)};
+    for (int it = 0; it < kSplitIterations; ++it) {
+        T x = splitProbe(s);
+        s = splitStep(s, x, splitObjective(p, x));
+    }
+    return select_greater<T>(s.fc, s.fd, s.c, s.d);
+}
+
+// ==========================================================
+// Recuperator Loop
+// ==========================================================
+// A recuperator heats compressor delivery air with turbine exhaust ahead of
+// the burner. Hotter burner air needs less fuel, which changes the turbine
+// gas flow and so the turbine exit temperature the recuperator started from.
+// The loop solves x = g(x) for that temperature by Newton with an analytic
+// derivative and a fixed number of steps, so lanes of a batch share one
+// instruction stream. The first step, from x = T_t3 (recuperator idle), is
+// the plain cycle; g depends on x only through the fuel mass, so the slope
+// is small and the remaining steps reach rounding.
+const int kRecuperatorIterations = 4;
+
+template<typename T>
+struct RecuperatorProblem {
+    T Tt3;              // compressor delivery, also the cooling air temperature
+    T Tt4, cp_air, cp_gas;
+    T denom;            // guarded burner energy balance denominator
+    T m_burner;         // air through the burner
+    T m_cool;           // cooling air rejoining at 4.1
+    T work;             // shaft work paid by the turbine, offtake included
+    T eps;              // recuperator effectiveness
+    const Fuel* fuel;   // library fuel, or nullptr for the input gas model
+    T eta_b;
+    T Pt4;              // burner exit pressure, for equilibrium tables
+};
+
+// Burner inlet temperature for a given turbine exit temperature.
+template<typename T>
+inline T recuperatorOutlet(const RecuperatorProblem<T>& p, T Tt5) {
+    return p.Tt3 + p.eps * select_max<T>(0.0, Tt5 - p.Tt3);
+}
+
+// The burner denominator and fuel ratio, from the library fuel when there is
+// one; SIMD Lanes adds the lane overloads, which never see one.
+inline double recuperatorDenominator(const RecuperatorProblem<double>& p) {
+    if (!p.fuel) return p.denom;
+    return guardDenominator<double>(p.eta_b * p.fuel->Q_HV - p.fuel->cpAt(p.Tt4, 0.0) * p.Tt4);
+}
+
+inline double recuperatorFuelRatio(const RecuperatorProblem<double>& p, double Tt35, double f_gas) {
+    return p.fuel ? p.fuel->burnerRatio(p.cp_air * Tt35, 0.0, p.Tt4, p.Pt4, p.eta_b) : f_gas;
+}
+
+template<typename T>
+inline T recuperatedTurbineExit(const RecuperatorProblem<T>& p) {
+    // -df/dTt35; with a library fuel only the Newton slope, at the lean limit.
+    const T k = p.cp_air / recuperatorDenominator(p);
+    const T f0 = p.cp_gas * p.Tt4 / p.denom;
+    const T B = p.work - p.m_cool * (p.cp_air * p.Tt3 - p.cp_gas * p.Tt4);
+    const T dm = p.m_burner * k * p.eps;                  // -dm_turbine/dx while recuperating
+    T x = p.Tt3;
+    for (int it = 0; it < kRecuperatorIterations; ++it) {
+        T Tt35 = recuperatorOutlet(p, x);
+        T f = recuperatorFuelRatio(p, Tt35, f0 - k * Tt35);
+        T m_turbine = p.m_burner + p.m_burner * f + p.m_cool;
+        T inv = 1.0 / (m_turbine * p.cp_gas);
+        T g = p.Tt4 - B * inv;
+        T dg = select_greater<T>(x, p.Tt3, B * inv * inv * p.cp_gas * dm, 0.0);   // -dg/dx
+        x = x - (x - g) / (1.0 + dg);
+    }
+    return x;
+}
+
+// ==========================================================
+// Emissions
+// ==========================================================
+// Opt-in (--emissions) emission indices, g per kg of fuel, from the burner
+// inlet state (T3, P3) and T_t4. NOx (as NO2) uses the P3-T3 correlation of
+// a reference engine at ISA humidity:
+//
+//     EI_NOx = 32 (P3 / 2965 kPa)^0.4 exp((T3 - 826 K) / 194 K)
+//
+// CO follows Lefebvre's trend EI_CO ~ T_pz exp(-0.00345 T_pz) / P3^1.5. The
+// primary-zone temperature is taken as T_t4. The combustor geometry is folded
+// into a constant that gives 0.5 g/kg at 2965 kPa and 1700 K.
+//
+// Batch kernels are instantiated with and without the group. Without it the
+// stage is compiled out and both columns hold NaN.
+bool g_emissions = false;
+const double kEmissionP3Ref = 2.965e6;      // Pa
+const double kNoxT3Ref = 826.0, kNoxT3Scale = 194.0, kNoxRef = 32.0;
+const double kCoTpzRef = 1700.0, kCoRef = 0.5;
+
+inline void emissionIndices(double Tt3, double Pt3, double Tt4, double& ei_nox, double& ei_co) {
+    ei_nox = kNoxRef * std::pow(Pt3 / kEmissionP3Ref, 0.4) * std::exp((Tt3 - kNoxT3Ref) / kNoxT3Scale);
+    ei_co = kCoRef * std::pow(kEmissionP3Ref / Pt3, 1.5) * (Tt4 / kCoTpzRef)
+          * std::exp(-0.00345 * (Tt4 - kCoTpzRef));
+}
+
+// ==========================================================
+// Input Setup Function
+// ==========================================================
+void setAllGlobalInputs() {
+    using namespace std;
+    cout << "\n--- SET GLOBAL INPUTS ---\n";
+    cout << "gamma_air: "; cin >> g_gamma_air;
+    cout << "gamma_gas: "; cin >> g_gamma_gas;
+    cout << "cp_air (J/kg*K): "; cin >> g_cp_air;
+    cout << "cp_gas (J/kg*K): "; cin >> g_cp_gas;
+    cout << "R_air (J/kg*K): "; cin >> g_R_air;
+    cout << "Fuel Heating Value Q_HV (J/kg): "; cin >> g_Q_HV;
+
+    cout << "\nFlight Mach (M0): "; cin >> g_M0;
+    cout << "Ambient Temp (K): "; cin >> g_T0;
+    cout << "Ambient Pressure (Pa): "; cin >> g_P0;
+
+    cout << "\nEfficiencies (eta_inlet eta_c eta_f eta_b eta_t eta_ab eta_n):\n";
+    cin >> g_eta_inlet >> g_eta_c >> g_eta_f >> g_eta_b >> g_eta_t >> g_eta_ab >> g_eta_n;
+
+    cout << "\nPressure Ratios & Temps (pi_b pi_ab pi_m T_t4 T_t7):\n";
+    cin >> g_pi_b >> g_pi_ab >> g_pi_m >> g_T_t4 >> g_T_t7;
+
+    cout << "\nEngine Specific (pi_c_jet BPR pi_f pi_c_fan):\n";
+    cin >> g_pi_c_jet >> g_BPR >> g_pi_f >> g_pi_c_fan;
+    g_eta_t_hp = g_eta_t_lp = g_eta_pt = g_eta_t;
+
+    g_inputs_are_set = true;
+    cout << "\nInputs successfully set!\n";
+}
+
+void setExtendedInputs() {
+    using namespace std;
+    cout << "\n--- SET EXTENDED INPUTS ---\n";
+    cout << "eta_t_hp eta_t_lp: "; cin >> g_eta_t_hp >> g_eta_t_lp;
+    cout << "Cooling bleed, customer bleed (fractions of core air): "; cin >> g_bleed_cool >> g_bleed_cust;
+    cout << "Shaft power offtake (J/kg core air): "; cin >> g_W_offtake;
+    cout << "eta_pt eta_prop eta_gear: "; cin >> g_eta_pt >> g_eta_prop >> g_eta_gear;
+    cout << "Turboshaft power split (0..1): "; cin >> g_pt_split;
+    cout << "eps_ic pi_ic eps_rec pi_rec: "; cin >> g_eps_ic >> g_pi_ic >> g_eps_rec >> g_pi_rec;
+    cout << "Variable-cycle mode (0 jet, 1 fan, 2 three-stream), BPR3 pi_f3: "; cin >> g_vc_mode >> g_BPR3 >> g_pi_f3;
+    printFuelLibrary(cout);
+    cout << "Fuel index: "; cin >> g_fuel_type;
+}
+
+// Reads the same values as setAllGlobalInputs(), in the same order, without prompts.
+bool loadGlobalInputs(std::istream& in) {
+    in >> g_gamma_air >> g_gamma_gas >> g_cp_air >> g_cp_gas >> g_R_air >> g_Q_HV;
+    in >> g_M0 >> g_T0 >> g_P0;
+    in >> g_eta_inlet >> g_eta_c >> g_eta_f >> g_eta_b >> g_eta_t >> g_eta_ab >> g_eta_n;
+    in >> g_pi_b >> g_pi_ab >> g_pi_m >> g_T_t4 >> g_T_t7;
+    in >> g_pi_c_jet >> g_BPR >> g_pi_f >> g_pi_c_fan;
+    if (!in) return false;
+    g_eta_t_hp = g_eta_t_lp = g_eta_pt = g_eta_t;
+    g_inputs_are_set = true;
+    return true;
+}
+
+// ==========================================================
+// Input Snapshot
+// ==========================================================
+// Plain copy of the g_* inputs, so sweeps can describe one point per value.
+// The scalar is a parameter so Interval Bounds can hold a box of inputs.
+template<typename S>
+struct BasicEngineInputs {
+    S gamma_air, gamma_gas, cp_air, cp_gas, R_air, Q_HV;
+    S M0, T0, P0;
+    S eta_inlet, eta_c, eta_f, eta_b, eta_t, eta_ab, eta_n;
+    S pi_b, pi_ab, pi_m, T_t4, T_t7;
+    S pi_c_jet, BPR, pi_f, pi_c_fan;
+    S eta_t_hp, eta_t_lp, bleed_cool, bleed_cust, W_offtake;
+    S eta_pt, eta_prop, eta_gear, pt_split;
+    S eps_ic, pi_ic, eps_rec, pi_rec;
+    S vc_mode, BPR3, pi_f3;
+    S fuel_type;
+};
+
+using EngineInputs = BasicEngineInputs<double>;
+
+EngineInputs captureGlobalInputs() {
+    EngineInputs in;
+    in.gamma_air = g_gamma_air; in.gamma_gas = g_gamma_gas;
+    in.cp_air = g_cp_air; in.cp_gas = g_cp_gas;
+    in.R_air = g_R_air; in.Q_HV = g_Q_HV;
+    in.M0 = g_M0; in.T0 = g_T0; in.P0 = g_P0;
+    in.eta_inlet = g_eta_inlet; in.eta_c = g_eta_c; in.eta_f = g_eta_f; in.eta_b = g_eta_b;
+    in.eta_t = g_eta_t; in.eta_ab = g_eta_ab; in.eta_n = g_eta_n;
+    in.pi_b = g_pi_b; in.pi_ab = g_pi_ab; in.pi_m = g_pi_m; in.T_t4 = g_T_t4; in.T_t7 = g_T_t7;
+    in.pi_c_jet = g_pi_c_jet; in.BPR = g_BPR; in.pi_f = g_pi_f; in.pi_c_fan = g_pi_c_fan;
+    in.eta_t_hp = g_eta_t_hp; in.eta_t_lp = g_eta_t_lp;
+    in.bleed_cool = g_bleed_cool; in.bleed_cust = g_bleed_cust; in.W_offtake = g_W_offtake;
+    in.eta_pt = g_eta_pt; in.eta_prop = g_eta_prop; in.eta_gear = g_eta_gear; in.pt_split = g_pt_split;
+    in.eps_ic = g_eps_ic; in.pi_ic = g_pi_ic; in.eps_rec = g_eps_rec; in.pi_rec = g_pi_rec;
+    in.vc_mode = g_vc_mode; in.BPR3 = g_BPR3; in.pi_f3 = g_pi_f3;
+    in.fuel_type = g_fuel_type;
+    return in;
+}
+
+void applyGlobalInputs(const EngineInputs& in) {
+    g_gamma_air = in.gamma_air; g_gamma_gas = in.gamma_gas;
+    g_cp_air = in.cp_air; g_cp_gas = in.cp_gas;
+    g_R_air = in.R_air; g_Q_HV = in.Q_HV;
+    g_M0 = in.M0; g_T0 = in.T0; g_P0 = in.P0;
+    g_eta_inlet = in.eta_inlet; g_eta_c = in.eta_c; g_eta_f = in.eta_f; g_eta_b = in.eta_b;
+    g_eta_t = in.eta_t; g_eta_ab = in.eta_ab; g_eta_n = in.eta_n;
+    g_pi_b = in.pi_b; g_pi_ab = in.pi_ab; g_pi_m = in.pi_m; g_T_t4 = in.T_t4; g_T_t7 = in.T_t7;
+    g_pi_c_jet = in.pi_c_jet; g_BPR = in.BPR; g_pi_f = in.pi_f; g_pi_c_fan = in.pi_c_fan;
+    g_eta_t_hp = in.eta_t_hp; g_eta_t_lp = in.eta_t_lp;
+    g_bleed_cool = in.bleed_cool; g_bleed_cust = in.bleed_cust; g_W_offtake = in.W_offtake;
+    g_eta_pt = in.eta_pt; g_eta_prop = in.eta_prop; g_eta_gear = in.eta_gear; g_pt_split = in.pt_split;
+    g_eps_ic = in.eps_ic; g_pi_ic = in.pi_ic; g_eps_rec = in.eps_rec; g_pi_rec = in.pi_rec;
+    g_vc_mode = in.vc_mode; g_BPR3 = in.BPR3; g_pi_f3 = in.pi_f3;
+    g_fuel_type = in.fuel_type;
+}
+
+// The first kClassEngineCount engines have a scalar class. ENGINE_PROGRAM runs
+// the cycle description loaded with --cycle, ENGINE_PLUGIN the generated
+// kernel loaded with --kernel.
+enum EngineType {
+    ENGINE_TURBOJET, ENGINE_TURBOFAN, ENGINE_TWO_SPOOL, ENGINE_TURBOPROP, ENGINE_TURBOSHAFT,
+    ENGINE_ICR, ENGINE_VARIABLE, ENGINE_PROGRAM, ENGINE_PLUGIN
+};
+
+const int kClassEngineCount = ENGINE_VARIABLE + 1;
+const char* const kClassNames[kClassEngineCount] = {
+    "Turbojet", "Turbofan", "TwoSpoolTurbofan", "Turboprop", "Turboshaft", "IcrTurbofan",
+    "VariableCycleEngine"
+};
+
+inline bool hasClassPath(EngineType e) { return e < kClassEngineCount; }
+
+struct InputField {
+    const char* name;
+    double EngineInputs::* member;
+};
+
+const InputField kInputFields[] = {
+    {"gamma_air", &EngineInputs::gamma_air}, {"gamma_gas", &EngineInputs::gamma_gas},
+    {"cp_air", &EngineInputs::cp_air}, {"cp_gas", &EngineInputs::cp_gas},
+    {"R_air", &EngineInputs::R_air}, {"Q_HV", &EngineInputs::Q_HV},
+    {"M0", &EngineInputs::M0}, {"T0", &EngineInputs::T0}, {"P0", &EngineInputs::P0},
+    {"eta_inlet", &EngineInputs::eta_inlet}, {"eta_c", &EngineInputs::eta_c},
+    {"eta_f", &EngineInputs::eta_f}, {"eta_b", &EngineInputs::eta_b},
+    {"eta_t", &EngineInputs::eta_t}, {"eta_ab", &EngineInputs::eta_ab},
+    {"eta_n", &EngineInputs::eta_n},
+    {"pi_b", &EngineInputs::pi_b}, {"pi_ab", &EngineInputs::pi_ab}, {"pi_m", &EngineInputs::pi_m},
+    {"T_t4", &EngineInputs::T_t4}, {"T_t7", &EngineInputs::T_t7},
+    {"pi_c_jet", &EngineInputs::pi_c_jet}, {"BPR", &EngineInputs::BPR},
+    {"pi_f", &EngineInputs::pi_f}, {"pi_c_fan", &EngineInputs::pi_c_fan},
+    {"eta_t_hp", &EngineInputs::eta_t_hp}, {"eta_t_lp", &EngineInputs::eta_t_lp},
+    {"bleed_cool", &EngineInputs::bleed_cool}, {"bleed_cust", &EngineInputs::bleed_cust},
+    {"W_offtake", &EngineInputs::W_offtake},
+    {"eta_pt", &EngineInputs::eta_pt}, {"eta_prop", &EngineInputs::eta_prop},
+    {"eta_gear", &EngineInputs::eta_gear}, {"pt_split", &EngineInputs::pt_split},
+    {"eps_ic", &EngineInputs::eps_ic}, {"pi_ic", &EngineInputs::pi_ic},
+    {"eps_rec", &EngineInputs::eps_rec}, {"pi_rec", &EngineInputs::pi_rec},
+    {"vc_mode", &EngineInputs::vc_mode}, {"BPR3", &EngineInputs::BPR3}, {"pi_f3", &EngineInputs::pi_f3},
+    {"fuel_type", &EngineInputs::fuel_type},
+};
+
+const InputField* findInputField(const std::string& name) {
+    for (const InputField& f : kInputFields)
+        if (name == f.name) return &f;
+    return nullptr;
+}
+
+const InputField* findInputField(double EngineInputs::* member) {
+    for (const InputField& f : kInputFields)
+        if (f.member == member) return &f;
+    return nullptr;
+}
+
+// ==========================================================
+// Component Library
+// ==========================================================
+// Cycle stages as stateless components over a FlowState, composed at compile
+// time by StageGraph. Each component is written once with the Turbojet
+// guards (epsilon denominators, clamped powers), so every cycle built from
+// them gets the same branch-free kernel. Components are templated on the
+// scalar type and take their inputs as EngineInputs member pointers, so one
+// Compressor serves the jet core, the fan core or an added spool. The input
+// pack is a parameter too: EngineInputs, or a box of them (Interval Bounds).
+//
+//     using TurbojetCycle = StageGraph<Inlet, Compressor<&EngineInputs::pi_c_jet>,
+//                                      Combustor, Turbine, Afterburner, Nozzle, Performance<false>>;
+template<typename T>
+struct FlowState {
+    T V0;
+    T Tt_ram;                 // inlet total temperature (intercooler sink)
+    T Tt, Pt;                 // core stream at the current station
+    T Tt_bypass, Pt_bypass;   // bypass stream, per unit core air: BPR
+    T shaftWork;              // compressor work per unit core air, paid by the (HP) turbine
+    T lpWork;                 // fan work on a two-spool engine, paid by the LP turbine
+    T m_core;                 // core mass flow per unit core inlet air
+    T fuel;                   // burner fuel per unit core inlet air
+    T m_cool, Tt_cool;        // cooling bleed waiting to rejoin the core
+    T m_mixed;                // bypass air mixed into the hot stream (BPR after a Mixer)
+    T q_rec;                  // recuperator heat per unit core inlet air
+    T f_comb, f_ab;
+    T T_t3, P_t3, T_t5, P_t5, T_t9, P_t9, V9;
+    T V9s;                    // third-stream nozzle exit velocity
+    T specificThrust, TSFC, f_total;
+    T split, shaftPower, PSFC;   // shaft engines
+    T Tt_burner, Pt_burner;      // burner inlet, for Emissions
+    T EI_NOx, EI_CO;
+
+    // The result columns in OutputColumn order.
+    void columns(T value[OUT_COUNT]) const {
+        const T v[OUT_COUNT] = {
+            specificThrust, TSFC, f_comb, f_ab, f_total, V0, V9,
+            T_t3, P_t3, T_t5, P_t5, T_t9, P_t9,
+            shaftPower, PSFC, split, EI_NOx, EI_CO
+        };
+        std::copy(v, v + OUT_COUNT, value);
+    }
+
+    // Unselected columns may be null and are not touched.
+    void store(double* const out[OUT_COUNT], size_t i, OutputMask mask) const {
+        T value[OUT_COUNT];
+        columns(value);
+        if (mask == kAllOutputs) {
+            for (int c = 0; c < OUT_COUNT; ++c) out[c][i] = value[c];
+            return;
+        }
+        for (int c = 0; c < OUT_COUNT; ++c)
+            if (mask & outputBit(c)) out[c][i] = value[c];
+    }
+};
+
+// Stage parameters named by member pointer; Interval Bounds adds the box overload.
+template<double EngineInputs::*M>
+inline double inputOf(const EngineInputs& p) { return p.*M; }
+
+// Library fuel and equilibrium stages; Interval Bounds adds the box overloads.
+inline bool usesFuelLibrary(const EngineInputs& p) { return fuelIndex(p.fuel_type) != 0; }
+inline bool usesEquilibrium(const EngineInputs& p) { return equilibriumFor(p.fuel_type) != nullptr; }
+inline const Fuel* libraryFuel(const EngineInputs& p) { return usesFuelLibrary(p) ? &fuelFor(p.fuel_type) : nullptr; }
+
+inline double libraryBurnerRatio(const EngineInputs& p, double h_in, double Pt_out) {
+    return fuelFor(p.fuel_type).burnerRatio(h_in, 0.0, p.T_t4, Pt_out, p.eta_b);
+}
+
+inline double libraryAfterburnerRatio(const EngineInputs& p, double Tt_in, double Pt_in, double far_in) {
+    return fuelFor(p.fuel_type).afterburnerRatio(Tt_in, Pt_in, far_in, p.T_t7, Pt_in * p.pi_ab, p.eta_ab);
+}
+
+inline double equilibriumNozzleVelocity(const EngineInputs& p, double Tt9, double Pt9, double far) {
+    return equilibriumFor(p.fuel_type)->nozzleVelocity(Tt9, Pt9, p.P0, far, p.eta_n);
+}
+
+// gamma for a compression or expansion: the library fuel's gas at (Tt, Pt,
+// far), where far 0 is air, or the given input on the input gas model.
+inline double stageGamma(const EngineInputs& p, double input, double Tt, double Pt, double far) {
+    return usesFuelLibrary(p) ? fuelFor(p.fuel_type).gammaOf(Tt, Pt, far) : input;
+}
+
+// Where a component's time goes in --profile-stages, and its --debug name.
+struct StageTag {
+    ProfileStage stage;
+    const char* name;
+};
+
+// debug() writes the stations a component sets for its --debug line;
+// components without named stations write nothing and print no line.
+template<class Derived>
+struct Component {
+    template<typename T, class In>
+    static void run(FlowState<T>& s, const In& p) { Derived::apply(s, p); }
+
+    static void debug(std::ostream&, const FlowState<double>&, const EngineInputs&) {}
+};
+
+struct Inlet : Component<Inlet> {
+    static constexpr StageTag tag = {STAGE_INLET, "Inlet"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        s.V0 = p.M0 * select_sqrt<T>(p.gamma_air * p.R_air * p.T0);
+        s.Tt = p.T0 * (1.0 + (p.gamma_air - 1.0) / 2.0 * p.M0 * p.M0);
+        s.Pt = p.P0 * select_pow<T>(s.Tt / p.T0, p.gamma_air / (p.gamma_air - 1.0)) * p.eta_inlet;
+        s.Tt_ram = s.Tt;
+        s.shaftWork = 0;
+        s.lpWork = 0;
+        s.m_core = 1.0;
+        s.m_cool = 0;
+        s.m_mixed = 0;
+        s.f_ab = 0;
+        s.split = s.shaftPower = s.PSFC = T(std::numeric_limits<double>::quiet_NaN());
+        s.EI_NOx = s.EI_CO = T(std::numeric_limits<double>::quiet_NaN());
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " T_t2=" << s.Tt << " P_t2=" << s.Pt;
+    }
+};
+
+enum Spool { SPOOL_HP, SPOOL_LP };
+
+template<Spool S, typename T>
+inline T& spoolWork(FlowState<T>& s) { return S == SPOOL_HP ? s.shaftWork : s.lpWork; }
+
+// Compresses the whole inlet flow; the bypass share (BPR) leaves at fan exit.
+template<double EngineInputs::*Pi = &EngineInputs::pi_f, double EngineInputs::*Eta = &EngineInputs::eta_f,
+         Spool S = SPOOL_HP>
+struct Fan : Component<Fan<Pi, Eta, S>> {
+    static constexpr StageTag tag = {STAGE_FAN, "Fan"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T Tt_in = s.Tt;
+        T g = stageGamma(p, p.gamma_air, Tt_in, s.Pt, T(0.0));
+        s.Pt = s.Pt * inputOf<Pi>(p);
+        T Tt_isen = Tt_in * select_pow<T>(inputOf<Pi>(p), (g - 1.0) / g);
+        s.Tt = Tt_in + (Tt_isen - Tt_in) / inputOf<Eta>(p);
+        s.Tt_bypass = s.Tt;
+        s.Pt_bypass = s.Pt;
+        spoolWork<S>(s) = spoolWork<S>(s) + (1.0 + p.BPR) * (p.cp_air * (s.Tt - Tt_in));
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " T_t13=" << s.Tt_bypass << " P_t13=" << s.Pt_bypass;
+    }
+};
+
+template<double EngineInputs::*Pi, double EngineInputs::*Eta = &EngineInputs::eta_c>
+struct Compressor : Component<Compressor<Pi, Eta>> {
+    static constexpr StageTag tag = {STAGE_COMPRESSOR, "Compressor"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T Tt_in = s.Tt;
+        T g = stageGamma(p, p.gamma_air, Tt_in, s.Pt, T(0.0));
+        s.Pt = s.Pt * inputOf<Pi>(p);
+        T Tt_isen = Tt_in * select_pow<T>(inputOf<Pi>(p), (g - 1.0) / g);
+        s.Tt = Tt_in + (Tt_isen - Tt_in) / inputOf<Eta>(p);
+        s.shaftWork = s.shaftWork + p.cp_air * (s.Tt - Tt_in);
+        s.T_t3 = s.Tt;
+        s.P_t3 = s.Pt;
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " T_t3=" << s.T_t3 << " P_t3=" << s.P_t3;
+    }
+};
+
+struct Combustor : Component<Combustor> {
+    static constexpr StageTag tag = {STAGE_COMBUSTOR, "Combustor"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        s.Tt_burner = s.Tt;
+        s.Pt_burner = s.Pt;
+        if (usesFuelLibrary(p)) {
+            s.f_comb = libraryBurnerRatio(p, p.cp_air * s.Tt, s.Pt * p.pi_b);
+        } else {
+            T denom = guardDenominator<T>(p.eta_b * p.Q_HV - p.cp_gas * p.T_t4);
+            s.f_comb = (p.cp_gas * p.T_t4 - p.cp_air * s.Tt) / denom;
+        }
+        s.fuel = s.m_core * s.f_comb;
+        s.m_core = s.m_core + s.fuel;
+        s.Tt = p.T_t4;
+        s.Pt = s.Pt * p.pi_b;
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " f_comb=" << s.f_comb << " P_t4=" << s.Pt;
+    }
+};
+
+// Single turbine driving every compressor upstream of it.
+struct Turbine : Component<Turbine> {
+    static constexpr StageTag tag = {STAGE_TURBINE, "Turbine"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T Tt_in = s.Tt;
+        s.Tt = Tt_in - (s.shaftWork / (s.m_core * p.cp_gas));
+        T Tt_isen = Tt_in - (Tt_in - s.Tt) / p.eta_t;
+        T g = stageGamma(p, p.gamma_gas, 0.5 * (Tt_in + s.Tt), s.Pt, s.fuel / (s.m_core - s.fuel));
+        s.Pt = s.Pt * select_pow<T>(Tt_isen / Tt_in, g / (g - 1.0));
+        s.T_t5 = s.Tt;
+        s.P_t5 = s.Pt;
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " T_t5=" << s.T_t5 << " P_t5=" << s.P_t5;
+    }
+};
+
+// Constant-area mixing of the bypass stream into the core; total pressure
+// follows the bypass side, scaled by pi_m.
+struct Mixer : Component<Mixer> {
+    static constexpr StageTag tag = {STAGE_MIXER, "Mixer"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T m_core_exit = s.m_core;
+        s.Tt = (p.BPR * p.cp_air * s.Tt_bypass + m_core_exit * p.cp_gas * s.Tt)
+             / ((p.BPR + m_core_exit) * p.cp_gas);
+        s.Pt = s.Pt_bypass * p.pi_m;
+        s.m_mixed = p.BPR;
+    }
+};
+
+// Cooling and customer bleed taken at compressor exit.
+struct Bleed : Component<Bleed> {
+    static constexpr StageTag tag = {STAGE_BLEED, "Bleed"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        s.m_cool = p.bleed_cool;
+        s.Tt_cool = s.Tt;
+        s.m_core = s.m_core - p.bleed_cool - p.bleed_cust;
+    }
+};
+
+// Third stream of a variable-cycle engine, taken off at the inlet: fan tip
+// compression to pi_f3 on the shaft, then a separate cold nozzle.
+struct ThirdStream : Component<ThirdStream> {
+    static constexpr StageTag tag = {STAGE_THIRD_STREAM, "Third Stream"};
+    // Fan tip exit temperature; the core stream is left at the inlet state.
+    template<typename T, class In>
+    static T tipTemperature(const FlowState<T>& s, const In& p) {
+        return s.Tt + (s.Tt * select_pow<T>(p.pi_f3, (p.gamma_air - 1.0) / p.gamma_air) - s.Tt) / p.eta_f;
+    }
+
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T Pt3 = s.Pt * p.pi_f3;
+        T Tt3 = tipTemperature(s, p);
+        s.shaftWork = s.shaftWork + p.BPR3 * (p.cp_air * (Tt3 - s.Tt));
+        T P9 = select_max<T>(Pt3, p.P0);
+        T T9_isen = Tt3 * select_pow<T>(p.P0 / P9, (p.gamma_air - 1.0) / p.gamma_air);
+        T T9 = Tt3 - p.eta_n * (Tt3 - T9_isen);
+        s.V9s = select_sqrt<T>(2.0 * p.cp_air * (Tt3 - T9));
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs& p) {
+        os << " T_t3s=" << tipTemperature(s, p) << " P_t3s=" << s.Pt * p.pi_f3 << " V9s=" << s.V9s;
+    }
+};
+
+// Ram-air intercooler on the core stream ahead of the compressor.
+struct Intercooler : Component<Intercooler> {
+    static constexpr StageTag tag = {STAGE_INTERCOOLER, "Intercooler"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        s.Tt = s.Tt - p.eps_ic * (s.Tt - s.Tt_ram);
+        s.Pt = s.Pt * p.pi_ic;
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " T_t25=" << s.Tt << " P_t25=" << s.Pt;
+    }
+};
+
+// Cold side of the recuperator, between bleed and burner. Solves the turbine
+// exit temperature (Recuperator Loop) from the stages downstream and heats
+// the burner air with it; RecuperatorExhaust takes the heat back out of the
+// gas after the turbine.
+struct Recuperator : Component<Recuperator> {
+    static constexpr StageTag tag = {STAGE_RECUPERATOR, "Recuperator"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        RecuperatorProblem<T> prob = {s.Tt, p.T_t4, p.cp_air, p.cp_gas,
+                                      guardDenominator<T>(p.eta_b * p.Q_HV - p.cp_gas * p.T_t4),
+                                      s.m_core, s.m_cool, s.shaftWork + p.W_offtake, p.eps_rec,
+                                      libraryFuel(p), p.eta_b, s.Pt * p.pi_rec * p.pi_b};
+        T Tt35 = recuperatorOutlet(prob, recuperatedTurbineExit(prob));
+        s.q_rec = s.m_core * (p.cp_air * (Tt35 - s.Tt));
+        s.Tt = Tt35;
+        s.Pt = s.Pt * p.pi_rec;
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " T_t35=" << s.Tt << " P_t35=" << s.Pt;
+    }
+};
+
+struct RecuperatorExhaust : Component<RecuperatorExhaust> {
+    static constexpr StageTag tag = {STAGE_RECUPERATOR, "Recuperator Exhaust"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        s.Tt = s.Tt - s.q_rec / (s.m_core * p.cp_gas);
+        s.Pt = s.Pt * p.pi_rec;
+    }
+};
+
+struct PowerOfftake : Component<PowerOfftake> {
+    static constexpr StageTag tag = {STAGE_OFFTAKE, "Offtake"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) { s.shaftWork = s.shaftWork + p.W_offtake; }
+};
+
+// Turbine on one spool of a multi-spool engine, expanding the current core mass flow.
+template<Spool S, double EngineInputs::*Eta>
+struct SpoolTurbine : Component<SpoolTurbine<S, Eta>> {
+    static constexpr StageTag tag = {STAGE_TURBINE, S == SPOOL_HP ? "HP Turbine" : "LP Turbine"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T Tt_in = s.Tt;
+        s.Tt = Tt_in - (spoolWork<S>(s) / (s.m_core * p.cp_gas));
+        T Tt_isen = Tt_in - (Tt_in - s.Tt) / inputOf<Eta>(p);
+        T g = stageGamma(p, p.gamma_gas, 0.5 * (Tt_in + s.Tt), s.Pt, s.fuel / (s.m_core - s.fuel));
+        s.Pt = s.Pt * select_pow<T>(Tt_isen / Tt_in, g / (g - 1.0));
+        if (S == SPOOL_LP) {
+            s.T_t5 = s.Tt;
+            s.P_t5 = s.Pt;
+        }
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        if (S == SPOOL_HP) os << " T_t45=" << s.Tt << " P_t45=" << s.Pt;
+        else os << " T_t5=" << s.T_t5 << " P_t5=" << s.P_t5;
+    }
+};
+
+// Returns the cooling bleed to the core at constant pressure, written as a
+// correction to Tt so zero bleed leaves the temperature bit for bit.
+struct CoolingMixer : Component<CoolingMixer> {
+    static constexpr StageTag tag = {STAGE_TURBINE, "Cooling"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T m_out = s.m_core + s.m_cool;
+        s.Tt = s.Tt + s.m_cool * (p.cp_air * s.Tt_cool - p.cp_gas * s.Tt) / (m_out * p.cp_gas);
+        s.m_core = m_out;
+        s.m_cool = 0;
+    }
+};
+
+// Chooses s.split between the gas generator and the power turbine: the
+// Power Split Search optimum with Search, otherwise pt_split as given.
+template<bool Search>
+struct PowerSplit : Component<PowerSplit<Search>> {
+    static constexpr StageTag tag = {STAGE_TURBINE, "Power Split"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        if (!Search) {
+            s.split = p.pt_split;
+            return;
+        }
+        T g = stageGamma(p, p.gamma_gas, s.Tt, s.Pt, s.fuel / (s.m_core - s.fuel));
+        T r = select_pow<T>(p.P0 / s.Pt, (g - 1.0) / g);
+        T dh = select_max<T>(0.0, p.cp_gas * (s.Tt - s.Tt * r));
+        s.split = searchPowerSplit(powerSplitProblem<T>(s.Tt, r, dh, p.cp_gas, p.eta_pt, p.eta_n, p.eta_gear,
+                                                        p.eta_prop, s.m_core, 1.0 + s.fuel - p.bleed_cust, s.V0));
+    }
+};
+
+// Free power turbine taking s.split of the ideal expansion to ambient.
+struct PowerTurbine : Component<PowerTurbine> {
+    static constexpr StageTag tag = {STAGE_TURBINE, "Power Turbine"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T g = stageGamma(p, p.gamma_gas, s.Tt, s.Pt, s.fuel / (s.m_core - s.fuel));
+        T r = select_pow<T>(p.P0 / s.Pt, (g - 1.0) / g);
+        T dh = select_max<T>(0.0, p.cp_gas * (s.Tt - s.Tt * r));
+        T Tt_in = s.Tt;
+        T w_pt = s.split * p.eta_pt * dh;
+        s.Tt = Tt_in - w_pt / p.cp_gas;
+        T Tt_isen = Tt_in - s.split * dh / p.cp_gas;
+        s.Pt = s.Pt * select_pow<T>(Tt_isen / Tt_in, g / (g - 1.0));
+        s.shaftPower = p.eta_gear * s.m_core * w_pt;
+        s.T_t5 = s.Tt;
+        s.P_t5 = s.Pt;
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " split=" << s.split << " T_t5=" << s.T_t5 << " P_t5=" << s.P_t5;
+    }
+};
+
+template<double EngineInputs::*Pi>
+struct Duct : Component<Duct<Pi>> {
+    static constexpr StageTag tag = {STAGE_NOZZLE, "Duct"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) { s.Pt = s.Pt * inputOf<Pi>(p); }
+};
+
+struct Afterburner : Component<Afterburner> {
+    static constexpr StageTag tag = {STAGE_AFTERBURNER, "Afterburner"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        if (usesFuelLibrary(p)) {
+            T far_in = s.fuel / (s.m_core + s.m_mixed - s.fuel);
+            s.f_ab = libraryAfterburnerRatio(p, s.Tt, s.Pt, far_in);
+        } else {
+            T denom = guardDenominator<T>(p.eta_ab * p.Q_HV - p.cp_gas * p.T_t7);
+            s.f_ab = (p.cp_gas * (p.T_t7 - s.Tt)) / denom;
+        }
+        s.Tt = p.T_t7;
+        s.Pt = s.Pt * p.pi_ab;
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " f_ab=" << s.f_ab << " P_t7=" << s.Pt;
+    }
+};
+
+struct Nozzle : Component<Nozzle> {
+    static constexpr StageTag tag = {STAGE_NOZZLE, "Nozzle"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        s.P_t9 = select_max<T>(s.Pt, p.P0);
+        s.T_t9 = s.Tt;
+        // Hot-stream fuel-air ratio after any afterburner.
+        T far_in = s.fuel / (s.m_core + s.m_mixed - s.fuel);
+        T far = far_in + s.f_ab * (1.0 + far_in);
+        if (usesEquilibrium(p)) {
+            s.V9 = equilibriumNozzleVelocity(p, s.T_t9, s.P_t9, far);
+        } else {
+            T g = stageGamma(p, p.gamma_gas, s.T_t9, s.P_t9, far);
+            T T9_isen = s.T_t9 * select_pow<T>(p.P0 / s.P_t9, (g - 1.0) / g);
+            T T9_actual = s.T_t9 - p.eta_n * (s.T_t9 - T9_isen);
+            s.V9 = select_sqrt<T>(2.0 * p.cp_gas * (s.T_t9 - T9_actual));
+        }
+    }
+
+    static void debug(std::ostream& os, const FlowState<double>& s, const EngineInputs&) {
+        os << " V9=" << s.V9;
+    }
+};
+
+// Mixed: one exhaust stream carrying core plus bypass air (Turbofan);
+// otherwise core air only (Turbojet). Customer bleed has left the cycle and
+// fuel is whatever the burner air received.
+template<bool Mixed>
+struct Performance : Component<Performance<Mixed>> {
+    static constexpr StageTag tag = {STAGE_PERFORMANCE, "Performance"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        if (Mixed) {
+            T m_inlet_total = 1.0 + p.BPR;
+            T m_mixed = 1.0 + p.BPR + s.fuel - p.bleed_cust;
+            T m_f_ab = m_mixed * s.f_ab;
+            T F_net = ((m_mixed + m_f_ab) * s.V9) - (m_inlet_total * s.V0);
+            s.specificThrust = F_net / m_inlet_total;
+            s.f_total = (s.fuel + m_f_ab) / m_inlet_total;
+        } else {
+            s.f_total = s.fuel + s.m_core * s.f_ab;
+            s.specificThrust = ((1.0 + s.f_total - p.bleed_cust) * s.V9) - s.V0;
+        }
+        s.TSFC = s.f_total / select_max<T>(1e-9, s.specificThrust);
+    }
+};
+
+// Follows Performance<true>: rescales to total inlet air and adds the third
+// stream's thrust.
+struct ThirdStreamPerformance : Component<ThirdStreamPerformance> {
+    static constexpr StageTag tag = {STAGE_PERFORMANCE, "Third Stream Performance"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T m_core_streams = 1.0 + p.BPR;
+        T m_inlet_total = m_core_streams + p.BPR3;
+        T F_net = s.specificThrust * m_core_streams + p.BPR3 * (s.V9s - s.V0);
+        s.specificThrust = F_net / m_inlet_total;
+        s.f_total = s.f_total * m_core_streams / m_inlet_total;
+        s.TSFC = s.f_total / select_max<T>(1e-9, s.specificThrust);
+    }
+};
+
+// Optional output group, appended by the batch kernels' Emit parameter.
+struct Emissions : Component<Emissions> {
+    static constexpr StageTag tag = {STAGE_PERFORMANCE, "Emissions"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        emissionIndices(s.Tt_burner, s.Pt_burner, p.T_t4, s.EI_NOx, s.EI_CO);
+    }
+};
+
+// PSFC on equivalent power: shaft plus jet thrust power over eta_prop.
+struct ShaftPerformance : Component<ShaftPerformance> {
+    static constexpr StageTag tag = {STAGE_PERFORMANCE, "Shaft Performance"};
+    template<typename T, class In>
+    static void apply(FlowState<T>& s, const In& p) {
+        T equivalentPower = s.shaftPower + s.specificThrust * s.V0 / p.eta_prop;
+        s.PSFC = s.f_total / select_max<T>(1e-9, equivalentPower);
+    }
+};
+
+template<class... Stages>
+struct StageGraph {
+    template<typename T, class In>
+    static void run(FlowState<T>& s, const In& p) { (Stages::run(s, p), ...); }
+};
+
+// Cooling air rejoins ahead of the turbine that drives the compressor (4.1
+// on one spool, 4.5 ahead of the LP turbine on two).
+using TurbojetCycle = StageGraph<Inlet, Compressor<&EngineInputs::pi_c_jet>, Bleed, Combustor,
+                                 PowerOfftake, CoolingMixer, Turbine, Afterburner, Nozzle,
+                                 Performance<false>>;
+using TurbofanCycle = StageGraph<Inlet, Fan<>, Compressor<&EngineInputs::pi_c_fan>, Bleed, Combustor,
+                                 PowerOfftake, CoolingMixer, Turbine, Mixer, Afterburner, Nozzle,
+                                 Performance<true>>;
+using TwoSpoolCycle = StageGraph<Inlet, Fan<&EngineInputs::pi_f, &EngineInputs::eta_f, SPOOL_LP>,
+                                 Compressor<&EngineInputs::pi_c_fan>, Bleed, Combustor, PowerOfftake,
+                                 SpoolTurbine<SPOOL_HP, &EngineInputs::eta_t_hp>, CoolingMixer,
+                                 SpoolTurbine<SPOOL_LP, &EngineInputs::eta_t_lp>,
+                                 Mixer, Afterburner, Nozzle, Performance<true>>;
+using IcrTurbofanCycle = StageGraph<Inlet, Fan<>, Intercooler, Compressor<&EngineInputs::pi_c_fan>, Bleed,
+                                    Recuperator, Combustor, PowerOfftake, CoolingMixer, Turbine,
+                                    RecuperatorExhaust, Mixer, Afterburner, Nozzle, Performance<true>>;
+// Variable-cycle modes; VC_FAN is TurbofanCycle. In turbojet mode the bypass
+// is closed and the fan is a core booster.
+using VcJetCycle = StageGraph<Inlet, Compressor<&EngineInputs::pi_f, &EngineInputs::eta_f>,
+                              Compressor<&EngineInputs::pi_c_fan>, Bleed, Combustor, PowerOfftake,
+                              CoolingMixer, Turbine, Afterburner, Nozzle, Performance<false>>;
+using VcThreeStreamCycle = StageGraph<Inlet, ThirdStream, Fan<>, Compressor<&EngineInputs::pi_c_fan>, Bleed,
+                                      Combustor, PowerOfftake, CoolingMixer, Turbine, Mixer, Afterburner,
+                                      Nozzle, Performance<true>, ThirdStreamPerformance>;
+// Shaft engines choose the power split between the gas generator and the
+// power turbine.
+using TurbopropCycle = StageGraph<Inlet, Compressor<&EngineInputs::pi_c_jet>, Bleed, Combustor, PowerOfftake,
+                                  CoolingMixer, SpoolTurbine<SPOOL_HP, &EngineInputs::eta_t>, PowerSplit<true>,
+                                  PowerTurbine, Nozzle, Performance<false>, ShaftPerformance>;
+using TurboshaftCycle = StageGraph<Inlet, Compressor<&EngineInputs::pi_c_jet>, Bleed, Combustor, PowerOfftake,
+                                   CoolingMixer, SpoolTurbine<SPOOL_HP, &EngineInputs::eta_t>, PowerSplit<false>,
+                                   PowerTurbine, Nozzle, Performance<false>, ShaftPerformance>;
+
+// ==========================================================
+// Engine Classes
+// ==========================================================
+// The menu, --scalar sweeps and --profile-stages run an engine through these
+// classes on the g_* inputs. A class runs its StageGraph one component at a
+// time on captureGlobalInputs(): each component is timed as its tag's profile
+// stage, prints its stations in debug mode, and leaves a station record
+// for displayResults(). There is no second copy of the physics, so a class
+// and the scalar batch kernel of the same cycle agree to the bit.
+struct CycleStation {
+    const char* name;
+    double Tt, Pt;            // core stream after the component
+};
+
+const size_t kMaxStations = 16;
+
+struct ClassRun {
+    EngineInputs in;
+    FlowState<double> s{};
+    CycleStation stations[kMaxStations];
+    size_t stationCount = 0;
+    ProfileStage lastStage = STAGE_COUNT;
+
+    // The core stream after the occurrence-th component with this tag name.
+    CycleStation station(const char* name, int occurrence = 0) const {
+        for (size_t k = 0; k < stationCount; ++k)
+            if (std::strcmp(stations[k].name, name) == 0 && occurrence-- == 0) return stations[k];
+        return {name, std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()};
+    }
+};
+
+// Consecutive components with the same stage count as one call of it.
+template<class Stage>
+void runClassStage(ClassRun& r) {
+    const bool newStage = r.lastStage != Stage::tag.stage;
+    { StageScope scope(Stage::tag.stage, newStage); Stage::run(r.s, r.in); }
+    r.lastStage = Stage::tag.stage;
+    if (r.stationCount < kMaxStations) r.stations[r.stationCount++] = {Stage::tag.name, r.s.Tt, r.s.Pt};
+    if (g_debug_mode) {
+        std::ostringstream line;
+        line.copyfmt(std::cout);
+        Stage::debug(line, r.s, r.in);
+        if (!line.str().empty()) std::cout << "[" << Stage::tag.name << "]" << line.str() << "\n";
+    }
+}
+
+template<class Cycle>
+struct ClassCycle;
+
+template<class... Stages>
+struct ClassCycle<StageGraph<Stages...>> {
+    static void run(ClassRun& r) { (runClassStage<Stages>(r), ...); }
+};
+
+class CycleEngine {
+public:
+    void collectOutputs(double out[OUT_COUNT]) const { run_.s.columns(out); }
+
+protected:
+    CycleEngine() { run_.in = captureGlobalInputs(); }
+
+    template<class Cycle>
+    void runCycle() { ClassCycle<Cycle>::run(run_); }
+
+    // Class outputs follow g_emissions, like the batch kernel batchKernelFor() picks.
+    void runEmissions() {
+        if (g_emissions) Emissions::run(run_.s, run_.in);
+    }
+
+    // `extra` prints engine-specific lines after V9.
+    template<class Extra>
+    void displayThrust(const std::string& title, Extra extra) const {
+        using namespace std;
+        const FlowState<double>& s = run_.s;
+        cout << "\n--- " << title << " ---\n";
+        cout << fixed << setprecision(4);
+        cout << "V0: " << s.V0 << " m/s\n";
+        cout << "V9: " << s.V9 << " m/s\n";
+        extra();
+        cout << "f_comb: " << s.f_comb << "  f_ab: " << s.f_ab << "  f_total: " << s.f_total << "\n";
+        cout << "Specific Thrust: " << s.specificThrust << " N/(kg/s)\n";
+        cout << "TSFC: " << s.TSFC * 1e6 << " mg/s/N\n";
+        cout << "-----------------------------------\n";
+    }
+
+    void displayThrust(const std::string& title) const { displayThrust(title, [] {}); }
+
+    ClassRun run_;
+};
+
+class Turbojet : public CycleEngine {
+public:
+    void runFullAnalysis() { runCycle<TurbojetCycle>(); runEmissions(); }
+    void displayResults() const { displayThrust("TURBOJET PERFORMANCE"); }
+};
+
+class Turbofan : public CycleEngine {
+public:
+    void runFullAnalysis() { runCycle<TurbofanCycle>(); runEmissions(); }
+    void displayResults() const { displayThrust("TURBOFAN PERFORMANCE"); }
+};
+
+// Mixed-flow afterburning turbofan with an HP spool (compressor plus shaft
+// offtake, HP turbine) and an LP spool (fan, LP turbine). Cooling air is bled
+// at compressor exit and rejoins ahead of the LP turbine; customer bleed
+// leaves overboard. Mass flows are per unit of core inlet air.
+class TwoSpoolTurbofan : public CycleEngine {
+public:
+    void runFullAnalysis() { runCycle<TwoSpoolCycle>(); runEmissions(); }
+
+    void displayResults() const {
+        displayThrust("TWO-SPOOL TURBOFAN PERFORMANCE", [this] {
+            CycleStation t45 = run_.station("Cooling");
+            std::cout << "HP work: " << run_.s.shaftWork << " J/kg  LP work: " << run_.s.lpWork << " J/kg\n";
+            std::cout << "T_t45: " << t45.Tt << " K  P_t45: " << t45.Pt << " Pa\n";
+        });
+    }
+};
+
+// Single-spool gas generator (compressor on pi_c_jet) followed by a free
+// power turbine and a core nozzle. With searchSplit the power split is
+// optimized per point; otherwise pt_split is used as given (turboshaft).
+class Turboprop : public CycleEngine {
+public:
+    explicit Turboprop(bool searchSplit = true) : searchSplit(searchSplit) {}
+
+    void runFullAnalysis() {
+        if (searchSplit) runCycle<TurbopropCycle>();
+        else runCycle<TurboshaftCycle>();
+        runEmissions();
+    }
+
+    void displayResults() const {
+        using namespace std;
+        const FlowState<double>& s = run_.s;
+        double equivalentPower = s.shaftPower + s.specificThrust * s.V0 / run_.in.eta_prop;
+        cout << "\n--- " << (searchSplit ? "TURBOPROP" : "TURBOSHAFT") << " PERFORMANCE ---\n";
+        cout << fixed << setprecision(4);
+        cout << "Power split: " << s.split << (searchSplit ? " (optimal)" : "") << "\n";
+        cout << "Shaft specific power: " << s.shaftPower / 1000.0 << " kW/(kg/s)\n";
+        cout << "Equivalent specific power: " << equivalentPower / 1000.0 << " kW/(kg/s)\n";
+        cout << "PSFC (equivalent): " << s.PSFC * 3.6e9 << " g/(kW*h)\n";
+        cout << "Residual jet thrust: " << s.specificThrust << " N/(kg/s)  V9: " << s.V9 << " m/s\n";
+        cout << "f_comb: " << s.f_comb << "  f_total: " << s.f_total << "\n";
+        cout << "-----------------------------------\n";
+    }
+
+private:
+    bool searchSplit;
+};
+
+// Mixed-flow afterburning turbofan with an intercooler between fan and
+// compressor and a recuperator between compressor and burner. The
+// intercooler rejects heat to ram air (sink at T_t2); the recuperator takes
+// it from the turbine exhaust ahead of the mixer. The same pressure ratio
+// pi_rec is lost on both recuperator sides. With zero effectiveness and no
+// losses it is the Turbofan cycle.
+class IcrTurbofan : public CycleEngine {
+public:
+    void runFullAnalysis() { runCycle<IcrTurbofanCycle>(); runEmissions(); }
+
+    void displayResults() const {
+        displayThrust("INTERCOOLED RECUPERATED TURBOFAN PERFORMANCE", [this] {
+            std::cout << "T_t25: " << run_.station("Intercooler").Tt << " K  T_t35: "
+                      << run_.station("Recuperator").Tt << " K  T_t55: "
+                      << run_.station("Recuperator Exhaust").Tt << " K\n";
+        });
+    }
+};
+
+// Adaptive engine whose mode is a per-point input (vc_mode, rounded):
+//   0  turbojet-like: bypass closed, the fan works as a core booster
+//   1  turbofan-like: mixed-flow turbofan at the point's BPR
+//   2  three-stream: as 1, plus a third stream (BPR3 per unit core air)
+//      compressed by the fan tip to pi_f3 and exhausted through its own nozzle
+enum VariableCycleMode { VC_JET, VC_FAN, VC_THREE_STREAM, VC_MODE_COUNT };
+
+const char* const kVariableCycleModeNames[VC_MODE_COUNT] = {"turbojet", "turbofan", "three-stream"};
+
+inline VariableCycleMode variableCycleMode(double vc_mode) {
+    return vc_mode < 0.5 ? VC_JET : vc_mode < 1.5 ? VC_FAN : VC_THREE_STREAM;
+}
+
+class VariableCycleEngine : public CycleEngine {
+public:
+    VariableCycleEngine() : mode(variableCycleMode(run_.in.vc_mode)) {}
+
+    void runFullAnalysis() {
+        if (mode == VC_JET) runCycle<VcJetCycle>();
+        else if (mode == VC_FAN) runCycle<TurbofanCycle>();
+        else runCycle<VcThreeStreamCycle>();
+        runEmissions();
+    }
+
+    void displayResults() const {
+        std::string title = std::string("VARIABLE-CYCLE ENGINE PERFORMANCE (") + kVariableCycleModeNames[mode];
+        displayThrust(title + " mode)", [this] {
+            if (mode == VC_THREE_STREAM) std::cout << "Third stream V9: " << run_.s.V9s << " m/s\n";
+        });
+    }
+
+private:
+    VariableCycleMode mode;
+};
+
+// ==========================================================
+// Interval Bounds
+// ==========================================================
+// The component library evaluated on Interval scalars over a box of inputs
+// (IntervalInputs): every result column comes back as guaranteed bounds on
+// what the double kernels return anywhere in the box. Endpoints are rounded
+// outward a unit in the last place per operation, and pow by its worst
+// kernel error besides (kPowUlps), so the bounds hold under rounding too.
+// A NaN point value is not a number to bound: `nan` records that some point
+// of the box may produce one, and lo > hi that every point does. Bounds
+// widen with the box (the same input enters a stage more than once), so
+// drivers bisect boxes rather than trust one evaluation; boundCycle()
+// tightens them with a mean-value form.
+//
+// Covers the jet, fan and fan2 cycles on the input gas model. Library fuels
+// and equilibrium tables are not bounded: a box that may select one gets the
+// whole real line from the stages that read them.
+const double kInf = std::numeric_limits<double>::infinity();
+
+struct Interval {
+    double lo, hi;
+    bool nan;
+
+    Interval() = default;
+    Interval(double v)
+        : lo(std::isnan(v) ? kInf : v), hi(std::isnan(v) ? -kInf : v), nan(std::isnan(v)) {}
+    Interval(double l, double h, bool n = false) : lo(l), hi(h), nan(n) {}
+
+    static Interval entire() { return {-kInf, kInf, true}; }
+    static Interval undefined() { return {kInf, -kInf, true}; }
+    bool empty() const { return !(lo <= hi); }
+    bool contains(double v) const { return std::isnan(v) ? nan : lo <= v && v <= hi; }
+};
+
+// nextafter toward +-infinity on the bit pattern; infinities stay put.
+inline double roundUp(double x) {
+    if (!std::isfinite(x)) return x;
+    if (x == 0.0) return std::numeric_limits<double>::denorm_min();
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(x));
+    bits = x > 0.0 ? bits + 1 : bits - 1;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+inline double roundDown(double x) { return -roundUp(-x); }
+
+// Rounds [lo, hi] outward; a NaN endpoint (inf - inf, 0 * inf) opens that side.
+inline Interval outward(double lo, double hi, bool nan) {
+    if (std::isnan(lo)) { lo = -kInf; nan = true; }
+    if (std::isnan(hi)) { hi = kInf; nan = true; }
+    return {roundDown(lo), roundUp(hi), nan};
+}
+
+inline Interval operator+(const Interval& a, const Interval& b) {
+    if (a.empty() || b.empty()) return Interval::undefined();
+    return outward(a.lo + b.lo, a.hi + b.hi, a.nan || b.nan);
+}
+
+inline Interval operator-(const Interval& a, const Interval& b) {
+    if (a.empty() || b.empty()) return Interval::undefined();
+    return outward(a.lo - b.hi, a.hi - b.lo, a.nan || b.nan);
+}
+
+// Hull of the four endpoint products or quotients; a NaN one (0 * inf,
+// inf / inf) counts as 0 and marks the result.
+template<class Op>
+inline Interval cornerHull(const Interval& a, const Interval& b, Op op) {
+    const double c[4] = {op(a.lo, b.lo), op(a.lo, b.hi), op(a.hi, b.lo), op(a.hi, b.hi)};
+    double lo = kInf, hi = -kInf;
+    bool nan = a.nan || b.nan;
+    for (double v : c) {
+        if (std::isnan(v)) { v = 0.0; nan = true; }
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    }
+    return outward(lo, hi, nan);
+}
+
+inline Interval operator*(const Interval& a, const Interval& b) {
+    if (a.empty() || b.empty()) return Interval::undefined();
+    return cornerHull(a, b, [](double x, double y) { return x * y; });
+}
+
+inline Interval operator/(const Interval& a, const Interval& b) {
+    if (a.empty() || b.empty()) return Interval::undefined();
+    if (b.lo <= 0.0 && b.hi >= 0.0) return Interval::entire();
+    return cornerHull(a, b, [](double x, double y) { return x / y; });
+}
+
+// Largest distance of the pow a point path calls, libm or lanePow, from the
+// exact power, in ulps of the result. lanePow is within 1.4 ULP of the
+// correctly rounded value, so within 1.9 of the exact one.
+const double kPowUlps = 2.0;
+
+// x moved outward by n of its own ulps (an ulp is at most eps |x|), plus one
+// step for the rounding of the move.
+inline double widenDown(double x, double n) {
+    if (!std::isfinite(x)) return x;
+    return roundDown(x - n * std::numeric_limits<double>::epsilon() * std::fabs(x));
+}
+
+inline double widenUp(double x, double n) { return -widenDown(-x, n); }
+
+// base > 0 ? pow(max(base, DBL_MIN), exp) : 0 per point: a NaN base gives 0,
+// and over base > 0 the exact extremes sit at corners (exp * log base is
+// bilinear). The libm corners are within an ulp of those, and a point in the
+// box may come out kPowUlps from its exact power, so the hull is widened by
+// both.
+template<>
+inline Interval select_pow<Interval>(Interval base, Interval exp) {
+    double lo = kInf, hi = -kInf;
+    bool nan = false;
+    if (base.nan || (!base.empty() && base.lo <= 0.0)) lo = hi = 0.0;
+    if (!base.empty() && base.hi > 0.0) {
+        if (exp.nan) {
+            nan = true;
+            lo = std::min(lo, 1.0);         // pow(1, NaN)
+            hi = std::max(hi, 1.0);
+        }
+        if (!exp.empty()) {
+            const double bl = std::max(base.lo, std::numeric_limits<double>::min());
+            const double c[4] = {std::pow(bl, exp.lo), std::pow(bl, exp.hi),
+                                 std::pow(base.hi, exp.lo), std::pow(base.hi, exp.hi)};
+            for (double v : c) {
+                lo = std::min(lo, widenDown(v, 1.0 + kPowUlps));
+                hi = std::max(hi, widenUp(v, 1.0 + kPowUlps));
+            }
+        }
+    }
+    if (lo > hi) return Interval::undefined();
+    return outward(lo, hi, nan);
+}
+
+// denom <= 0 ? epsilon : denom per point; positive doubles are at least the
+// smallest subnormal.
+template<>
+inline Interval guardDenominator<Interval>(Interval denom) {
+    if (denom.empty()) return denom;
+    const double eps = std::numeric_limits<double>::epsilon();
+    if (denom.hi <= 0.0) return {eps, eps, denom.nan};
+    if (denom.lo > 0.0) return denom;
+    return {std::numeric_limits<double>::denorm_min(), std::max(eps, denom.hi), denom.nan};
+}
+
+template<>
+inline Interval select_sqrt<Interval>(Interval x) {
+    if (x.empty() || x.hi < 0.0) return Interval::undefined();
+    return {x.lo <= 0.0 ? 0.0 : roundDown(std::sqrt(x.lo)), roundUp(std::sqrt(x.hi)), x.nan || x.lo < 0.0};
+}
+
+// std::max(a, b) is (a < b) ? b : a: NaN in a passes through, NaN in b yields a.
+template<>
+inline Interval select_max<Interval>(Interval a, Interval b) {
+    if (a.empty()) return a;
+    if (b.empty()) return a;
+    return {b.nan ? a.lo : std::max(a.lo, b.lo), std::max(a.hi, b.hi), a.nan};
+}
+
+// A box of inputs; lo and hi are its corners, read by the stages that take a
+// member pointer.
+struct IntervalInputs : BasicEngineInputs<Interval> {
+    EngineInputs lo, hi;
+
+    IntervalInputs(const EngineInputs& l, const EngineInputs& h) : lo(l), hi(h) {
+        auto box = [](double a, double b) { return Interval(std::min(a, b), std::max(a, b)); };
+        gamma_air = box(l.gamma_air, h.gamma_air); gamma_gas = box(l.gamma_gas, h.gamma_gas);
+        cp_air = box(l.cp_air, h.cp_air); cp_gas = box(l.cp_gas, h.cp_gas);
+        R_air = box(l.R_air, h.R_air); Q_HV = box(l.Q_HV, h.Q_HV);
+        M0 = box(l.M0, h.M0); T0 = box(l.T0, h.T0); P0 = box(l.P0, h.P0);
+        eta_inlet = box(l.eta_inlet, h.eta_inlet); eta_c = box(l.eta_c, h.eta_c);
+        eta_f = box(l.eta_f, h.eta_f); eta_b = box(l.eta_b, h.eta_b);
+        eta_t = box(l.eta_t, h.eta_t); eta_ab = box(l.eta_ab, h.eta_ab); eta_n = box(l.eta_n, h.eta_n);
+        pi_b = box(l.pi_b, h.pi_b); pi_ab = box(l.pi_ab, h.pi_ab); pi_m = box(l.pi_m, h.pi_m);
+        T_t4 = box(l.T_t4, h.T_t4); T_t7 = box(l.T_t7, h.T_t7);
+        pi_c_jet = box(l.pi_c_jet, h.pi_c_jet); BPR = box(l.BPR, h.BPR);
+        pi_f = box(l.pi_f, h.pi_f); pi_c_fan = box(l.pi_c_fan, h.pi_c_fan);
+        eta_t_hp = box(l.eta_t_hp, h.eta_t_hp); eta_t_lp = box(l.eta_t_lp, h.eta_t_lp);
+        bleed_cool = box(l.bleed_cool, h.bleed_cool); bleed_cust = box(l.bleed_cust, h.bleed_cust);
+        W_offtake = box(l.W_offtake, h.W_offtake);
+        eta_pt = box(l.eta_pt, h.eta_pt); eta_prop = box(l.eta_prop, h.eta_prop);
+        eta_gear = box(l.eta_gear, h.eta_gear); pt_split = box(l.pt_split, h.pt_split);
+        eps_ic = box(l.eps_ic, h.eps_ic); pi_ic = box(l.pi_ic, h.pi_ic);
+        eps_rec = box(l.eps_rec, h.eps_rec); pi_rec = box(l.pi_rec, h.pi_rec);
+        vc_mode = box(l.vc_mode, h.vc_mode); BPR3 = box(l.BPR3, h.BPR3); pi_f3 = box(l.pi_f3, h.pi_f3);
+        fuel_type = box(l.fuel_type, h.fuel_type);
+    }
+};
+
+template<double EngineInputs::*M>
+inline Interval inputOf(const IntervalInputs& p) { return Interval(p.lo.*M, p.hi.*M); }
+
+// Fuel inputs round to the nearest library index, so any value from 0.5 up selects one.
+inline bool usesFuelLibrary(const IntervalInputs& p) { return p.fuel_type.hi >= 0.5 || p.fuel_type.nan; }
+
+inline bool usesEquilibrium(const IntervalInputs& p) {
+    if (!usesFuelLibrary(p)) return false;
+    for (const Fuel& f : g_fuels)
+        if (f.eq) return true;
+    return false;
+}
+
+inline Interval libraryBurnerRatio(const IntervalInputs&, Interval, Interval) { return Interval::entire(); }
+inline Interval libraryAfterburnerRatio(const IntervalInputs&, Interval, Interval, Interval) {
+    return Interval::entire();
+}
+inline Interval equilibriumNozzleVelocity(const IntervalInputs&, Interval, Interval, Interval) {
+    return Interval::entire();
+}
+inline Interval stageGamma(const IntervalInputs& p, Interval input, Interval, Interval, Interval) {
+    return usesFuelLibrary(p) ? Interval::entire() : input;
+}
+
+inline bool hasIntervalBounds(EngineType engine) {
+    return engine == ENGINE_TURBOJET || engine == ENGINE_TURBOFAN || engine == ENGINE_TWO_SPOOL;
+}
+
+// Mean-value form. The plain bounds above overshoot by an amount that
+// shrinks only linearly with the box, so bisecting near an optimum gains
+// little. IntervalSlope carries, next to the value, bounds on its partial
+// derivatives with respect to the varied inputs over the whole box; then
+// each column of the exact cycle lies in
+//
+//     f(c) + sum_a df/dx_a(X) * (X_a - c_a)
+//
+// about the box centre c, which overshoots with the square of the width.
+// A stage whose value may be NaN, or whose derivative does not exist
+// somewhere in the box (a guard or max switching branch, sqrt or pow at 0),
+// gives up its derivatives, and so does every column downstream of it.
+//
+// The point paths round, so it also carries err, a bound on how far the
+// computed value is from the exact one anywhere in the box: each operation
+// passes on its operands' errors scaled by the largest derivative, and adds
+// its own rounding, half an ulp (kPowUlps for pow). The value bounds contain
+// both the exact and the computed values, so they supply those scales.
+const size_t kSlopeAxes = 4;                // varied inputs the form covers
+
+struct IntervalSlope {
+    Interval v;
+    Interval d[kSlopeAxes];
+    double err;
+
+    IntervalSlope() = default;
+    IntervalSlope(double x) : v(x), err(0.0) {
+        for (Interval& e : d) e = Interval(0.0);
+    }
+
+    static IntervalSlope entire() {
+        IntervalSlope r;
+        r.v = Interval::entire();
+        for (Interval& e : r.d) e = Interval::entire();
+        r.err = kInf;
+        return r;
+    }
+    // A value whose derivatives are unknown, or NaN somewhere, loses them.
+    IntervalSlope& settle() {
+        if (v.nan || v.empty()) {
+            for (Interval& e : d) e = Interval::entire();
+            err = kInf;
+        }
+        return *this;
+    }
+};
+
+// Largest and smallest |x| over an interval.
+inline double magnitude(const Interval& x) { return std::max(std::fabs(x.lo), std::fabs(x.hi)); }
+inline double mignitude(const Interval& x) { return x.lo > 0.0 ? x.lo : x.hi < 0.0 ? -x.hi : 0.0; }
+
+// Error arithmetic on non-negative bounds, rounded up; 0 * inf is 0, since
+// the unbounded error it would scale is multiplied by an exact zero.
+inline double addUp(double a, double b) { return roundUp(a + b); }
+inline double mulUp(double a, double b) { return a == 0.0 || b == 0.0 ? 0.0 : roundUp(a * b); }
+inline double divUp(double a, double b) { return a == 0.0 ? 0.0 : b == 0.0 ? kInf : roundUp(a / b); }
+
+// Rounding one result in r to nearest: half an ulp, at most eps/2 of |r|.
+inline double roundingError(const Interval& r, double ulps = 0.5) {
+    return roundUp(ulps * std::numeric_limits<double>::epsilon() * magnitude(r));
+}
+
+inline IntervalSlope operator+(const IntervalSlope& a, const IntervalSlope& b) {
+    IntervalSlope r;
+    r.v = a.v + b.v;
+    for (size_t k = 0; k < kSlopeAxes; ++k) r.d[k] = a.d[k] + b.d[k];
+    r.err = addUp(addUp(a.err, b.err), roundingError(r.v));
+    return r.settle();
+}
+
+inline IntervalSlope operator-(const IntervalSlope& a, const IntervalSlope& b) {
+    IntervalSlope r;
+    r.v = a.v - b.v;
+    for (size_t k = 0; k < kSlopeAxes; ++k) r.d[k] = a.d[k] - b.d[k];
+    r.err = addUp(addUp(a.err, b.err), roundingError(r.v));
+    return r.settle();
+}
+
+// a'b' - ab = a'(b' - b) + b(a' - a).
+inline IntervalSlope operator*(const IntervalSlope& a, const IntervalSlope& b) {
+    IntervalSlope r;
+    r.v = a.v * b.v;
+    for (size_t k = 0; k < kSlopeAxes; ++k) r.d[k] = a.d[k] * b.v + a.v * b.d[k];
+    r.err = addUp(addUp(mulUp(magnitude(a.v), b.err), mulUp(magnitude(b.v), a.err)), roundingError(r.v));
+    return r.settle();
+}
+
+// (a/b)' = (a' - (a/b) b') / b, with the quotient's own bounds for a/b;
+// a'/b' - a/b = (a' - a)/b' + a (b - b')/(b b').
+inline IntervalSlope operator/(const IntervalSlope& a, const IntervalSlope& b) {
+    IntervalSlope r;
+    r.v = a.v / b.v;
+    for (size_t k = 0; k < kSlopeAxes; ++k) r.d[k] = (a.d[k] - r.v * b.d[k]) / b.v;
+    const double m = mignitude(b.v);
+    r.err = addUp(addUp(divUp(a.err, m), divUp(mulUp(magnitude(a.v), b.err), mulUp(m, m))),
+                  roundingError(r.v));
+    return r.settle();
+}
+
+// log rounded outward two units; libm log is within one.
+inline Interval intervalLog(const Interval& x) {
+    return {roundDown(roundDown(std::log(x.lo))), roundUp(roundUp(std::log(x.hi))), false};
+}
+
+// d(b^e) = b^e (e b'/b + log(b) e'); smooth where every base exceeds DBL_MIN,
+// constant 0 where none is positive. The operand errors scale by the same
+// two partials, and pow itself is off by up to kPowUlps.
+template<>
+inline IntervalSlope select_pow<IntervalSlope>(IntervalSlope base, IntervalSlope exp) {
+    IntervalSlope r;
+    r.v = select_pow<Interval>(base.v, exp.v);
+    const bool smooth = !base.v.nan && !base.v.empty() && base.v.lo > std::numeric_limits<double>::min();
+    const bool zero = !base.v.nan && !base.v.empty() && base.v.hi <= 0.0;
+    if (!smooth && !zero) return IntervalSlope::entire();
+    if (zero) {
+        for (Interval& e : r.d) e = Interval(0.0);
+        r.err = 0.0;
+        return r.settle();
+    }
+    bool constantExp = exp.err == 0.0;
+    for (const Interval& e : exp.d) constantExp = constantExp && e.lo == 0.0 && e.hi == 0.0 && !e.nan;
+    const Interval ratio = exp.v / base.v, lnBase = constantExp ? Interval(0.0) : intervalLog(base.v);
+    const Interval dBase = r.v * ratio, dExp = r.v * lnBase;
+    for (size_t k = 0; k < kSlopeAxes; ++k) {
+        if (constantExp) r.d[k] = dBase * base.d[k];
+        else r.d[k] = dBase * base.d[k] + dExp * exp.d[k];
+    }
+    r.err = addUp(addUp(mulUp(magnitude(dBase), base.err), mulUp(magnitude(dExp), exp.err)),
+                  roundingError(r.v, kPowUlps));
+    return r.settle();
+}
+
+template<>
+inline IntervalSlope guardDenominator<IntervalSlope>(IntervalSlope denom) {
+    IntervalSlope r = denom;
+    r.v = guardDenominator<Interval>(denom.v);
+    if (denom.v.nan || denom.v.empty() || denom.v.lo <= 0.0) {
+        const bool constant = !denom.v.nan && !denom.v.empty() && denom.v.hi <= 0.0;
+        for (Interval& e : r.d) e = constant ? Interval(0.0) : Interval::entire();
+        r.err = constant ? 0.0 : kInf;
+    }
+    return r.settle();
+}
+
+// |sqrt(x') - sqrt(x)| = |x' - x| / (sqrt(x') + sqrt(x)).
+template<>
+inline IntervalSlope select_sqrt<IntervalSlope>(IntervalSlope x) {
+    IntervalSlope r;
+    r.v = select_sqrt<Interval>(x.v);
+    if (x.v.nan || x.v.empty() || x.v.lo <= 0.0) return IntervalSlope::entire();
+    for (size_t k = 0; k < kSlopeAxes; ++k) r.d[k] = x.d[k] / (Interval(2.0) * r.v);
+    r.err = addUp(divUp(x.err, 2.0 * roundDown(std::sqrt(x.v.lo))), roundingError(r.v));
+    return r.settle();
+}
+
+// max is Lipschitz: where the branch may switch inside the box the
+// derivative lies in the hull of both sides' derivatives. It is exact, and
+// moves no further than the larger operand error.
+template<>
+inline IntervalSlope select_max<IntervalSlope>(IntervalSlope a, IntervalSlope b) {
+    IntervalSlope r;
+    r.v = select_max<Interval>(a.v, b.v);
+    if (a.v.nan || b.v.nan || a.v.empty() || b.v.empty()) return IntervalSlope::entire();
+    for (size_t k = 0; k < kSlopeAxes; ++k) {
+        if (a.v.lo > b.v.hi) r.d[k] = a.d[k];
+        else if (b.v.lo > a.v.hi) r.d[k] = b.d[k];
+        else r.d[k] = {std::min(a.d[k].lo, b.d[k].lo), std::max(a.d[k].hi, b.d[k].hi), a.d[k].nan || b.d[k].nan};
+    }
+    r.err = std::max(a.err, b.err);
+    return r.settle();
+}
+
+// The box of IntervalInputs with derivative seeds: axis a of `axes` has
+// derivative 1 along a, every other input 0.
+struct SlopeInputs : BasicEngineInputs<IntervalSlope> {
+    EngineInputs lo, hi;
+    double EngineInputs::* axes[kSlopeAxes] = {};
+
+    IntervalSlope make(double EngineInputs::* m) const {
+        IntervalSlope r(0.0);
+        r.v = Interval(std::min(lo.*m, hi.*m), std::max(lo.*m, hi.*m));
+        for (size_t k = 0; k < kSlopeAxes; ++k)
+            if (axes[k] == m) r.d[k] = Interval(1.0);
+        return r;
+    }
+
+    SlopeInputs(const EngineInputs& l, const EngineInputs& h, double EngineInputs::* const a[kSlopeAxes])
+        : lo(l), hi(h) {
+        std::copy(a, a + kSlopeAxes, axes);
+        gamma_air = make(&EngineInputs::gamma_air); gamma_gas = make(&EngineInputs::gamma_gas);
+        cp_air = make(&EngineInputs::cp_air); cp_gas = make(&EngineInputs::cp_gas);
+        R_air = make(&EngineInputs::R_air); Q_HV = make(&EngineInputs::Q_HV);
+        M0 = make(&EngineInputs::M0); T0 = make(&EngineInputs::T0); P0 = make(&EngineInputs::P0);
+        eta_inlet = make(&EngineInputs::eta_inlet); eta_c = make(&EngineInputs::eta_c);
+        eta_f = make(&EngineInputs::eta_f); eta_b = make(&EngineInputs::eta_b);
+        eta_t = make(&EngineInputs::eta_t); eta_ab = make(&EngineInputs::eta_ab);
+        eta_n = make(&EngineInputs::eta_n);
+        pi_b = make(&EngineInputs::pi_b); pi_ab = make(&EngineInputs::pi_ab); pi_m = make(&EngineInputs::pi_m);
+        T_t4 = make(&EngineInputs::T_t4); T_t7 = make(&EngineInputs::T_t7);
+        pi_c_jet = make(&EngineInputs::pi_c_jet); BPR = make(&EngineInputs::BPR);
+        pi_f = make(&EngineInputs::pi_f); pi_c_fan = make(&EngineInputs::pi_c_fan);
+        eta_t_hp = make(&EngineInputs::eta_t_hp); eta_t_lp = make(&EngineInputs::eta_t_lp);
+        bleed_cool = make(&EngineInputs::bleed_cool); bleed_cust = make(&EngineInputs::bleed_cust);
+        W_offtake = make(&EngineInputs::W_offtake);
+        eta_pt = make(&EngineInputs::eta_pt); eta_prop = make(&EngineInputs::eta_prop);
+        eta_gear = make(&EngineInputs::eta_gear); pt_split = make(&EngineInputs::pt_split);
+        eps_ic = make(&EngineInputs::eps_ic); pi_ic = make(&EngineInputs::pi_ic);
+        eps_rec = make(&EngineInputs::eps_rec); pi_rec = make(&EngineInputs::pi_rec);
+        vc_mode = make(&EngineInputs::vc_mode); BPR3 = make(&EngineInputs::BPR3);
+        pi_f3 = make(&EngineInputs::pi_f3); fuel_type = make(&EngineInputs::fuel_type);
+    }
+};
+
+template<double EngineInputs::*M>
+inline IntervalSlope inputOf(const SlopeInputs& p) { return p.make(M); }
+
+// boundCycle() only takes slopes on the input gas model.
+inline bool usesFuelLibrary(const SlopeInputs&) { return false; }
+inline bool usesEquilibrium(const SlopeInputs&) { return false; }
+inline IntervalSlope libraryBurnerRatio(const SlopeInputs&, IntervalSlope, IntervalSlope) {
+    return IntervalSlope::entire();
+}
+inline IntervalSlope libraryAfterburnerRatio(const SlopeInputs&, IntervalSlope, IntervalSlope, IntervalSlope) {
+    return IntervalSlope::entire();
+}
+inline IntervalSlope equilibriumNozzleVelocity(const SlopeInputs&, IntervalSlope, IntervalSlope, IntervalSlope) {
+    return IntervalSlope::entire();
+}
+inline IntervalSlope stageGamma(const SlopeInputs&, IntervalSlope input, IntervalSlope, IntervalSlope,
+                                IntervalSlope) {
+    return input;
+}
+
+template<class In, typename T>
+inline void runBoundCycle(EngineType engine, const In& box, FlowState<T>& s) {
+    switch (engine) {
+    case ENGINE_TURBOJET: TurbojetCycle::run(s, box); break;
+    case ENGINE_TURBOFAN: TurbofanCycle::run(s, box); break;
+    default: TwoSpoolCycle::run(s, box); break;
+    }
+}
+
+// Plain bounds over [lo, hi].
+inline void plainCycleBounds(EngineType engine, const EngineInputs& lo, const EngineInputs& hi,
+                             Interval out[OUT_COUNT]) {
+    FlowState<Interval> s{};
+    runBoundCycle(engine, IntervalInputs(lo, hi), s);
+    s.columns(out);
+}
+
+// Intersects out[] with the mean-value form over [lo, hi]. f(c) is the
+// centre evaluated as a box of its own, which contains the exact value there;
+// the form then contains the exact cycle over the box, and widening it by
+// the column's err contains what the point paths compute.
+void meanValueBounds(EngineType engine, const EngineInputs& lo, const EngineInputs& hi, Interval out[OUT_COUNT]) {
+    double EngineInputs::* axes[kSlopeAxes] = {};
+    size_t na = 0;
+    for (const InputField& f : kInputFields) {
+        if (lo.*(f.member) == hi.*(f.member)) continue;
+        if (na == kSlopeAxes) return;
+        axes[na++] = f.member;
+    }
+    if (na == 0 || usesFuelLibrary(IntervalInputs(lo, hi))) return;
+    FlowState<IntervalSlope> s{};
+    runBoundCycle(engine, SlopeInputs(lo, hi, axes), s);
+    IntervalSlope slope[OUT_COUNT];
+    s.columns(slope);
+    EngineInputs c = lo;
+    for (size_t a = 0; a < na; ++a) c.*axes[a] = 0.5 * (lo.*axes[a] + hi.*axes[a]);
+    Interval centre[OUT_COUNT];
+    plainCycleBounds(engine, c, c, centre);
+    for (int k = 0; k < OUT_COUNT; ++k) {
+        if (centre[k].nan || centre[k].empty() || out[k].empty()) continue;
+        Interval mv = centre[k];
+        bool known = true;
+        for (size_t a = 0; a < na && known; ++a) {
+            const Interval& d = slope[k].d[a];
+            known = !d.nan && !d.empty() && std::isfinite(d.lo) && std::isfinite(d.hi);
+            double lo_a = std::min(lo.*axes[a], hi.*axes[a]), hi_a = std::max(lo.*axes[a], hi.*axes[a]);
+            double c_a = c.*axes[a];
+            mv = mv + d * Interval(roundDown(lo_a - c_a), roundUp(hi_a - c_a));
+        }
+        const double err = slope[k].err;
+        if (!known || mv.nan || mv.empty() || !std::isfinite(err)) continue;
+        double l = std::max(out[k].lo, roundDown(mv.lo - err)), h = std::min(out[k].hi, roundUp(mv.hi + err));
+        if (l <= h) out[k] = Interval(l, h, out[k].nan);
+    }
+}
+
+// Bounds of every result column over the box [lo, hi]; inputs that are not
+// varied have lo == hi. False for engines without interval bounds.
+bool boundCycle(EngineType engine, const EngineInputs& lo, const EngineInputs& hi, Interval out[OUT_COUNT]) {
+    if (!hasIntervalBounds(engine)) return false;
+    plainCycleBounds(engine, lo, hi, out);
+    meanValueBounds(engine, lo, hi, out);
+    return true;
+}
+
+// Every point of the bound satisfies a test, none does, or it cannot tell.
+inline const char* boundVerdict(bool all, bool none) { return all ? "always" : none ? "never" : "undecided"; }
+
+// Prints the bounds of every column over [lo, hi] and the feasibility of the
+// box: a turbine exit above 0 K, and the burner and the total fuel with the
+// afterburner below stoichiometric. The input gas model has no stoichiometry
+// of its own, so it is held to Jet-A's.
+void printCycleBounds(EngineType engine, const EngineInputs& lo, const EngineInputs& hi, std::ostream& os) {
+    using namespace std;
+    Interval b[OUT_COUNT];
+    boundCycle(engine, lo, hi, b);
+    os << "\n--- INTERVAL BOUNDS: " << kClassNames[engine] << " ---\n";
+    os << left << setw(16) << "Output" << right << setw(18) << "lower" << setw(18) << "upper" << "  NaN\n";
+    os << setprecision(10);
+    for (int c = 0; c < OUT_COUNT; ++c) {
+        os << left << setw(16) << kOutputNames[c] << right;
+        if (b[c].empty()) os << setw(18) << "-" << setw(18) << "-";
+        else os << setw(18) << b[c].lo << setw(18) << b[c].hi;
+        os << "  " << (b[c].nan ? "maybe" : "no") << "\n";
+    }
+    const Interval& t5 = b[OUT_T_T5];
+    const Fuel& fuel = g_fuels[std::max(1, fuelIndex(hi.fuel_type))];
+    os << "T_t5 > 0: " << boundVerdict(!t5.nan && t5.lo > 0.0, t5.empty() || t5.hi <= 0.0) << "\n";
+    for (int c : {OUT_F_COMB, OUT_F_TOTAL}) {
+        const Interval& f = b[c];
+        os << kOutputNames[c] << " <= " << fuel.far_stoich << " (" << fuel.name << " stoichiometric): "
+           << boundVerdict(!f.nan && f.hi <= fuel.far_stoich, f.empty() || f.lo > fuel.far_stoich) << "\n";
+    }
+    os << "-----------------------------------\n";
+}
+
+// ==========================================================
+// SIMD Lanes
+// ==========================================================
+// The component library evaluated on Lanes scalars: kLanes points at once,
+// each operator a loop over the lanes, so the jet, fan and fan2 kernels and
+// the variable-cycle mode groups are one source compiled per ISA level and
+// vectorized there. detectIsa() picks
+// the widest level the CPU runs at startup; --isa overrides it.
+//
+// Every lane level returns the same bits on every CPU: the kernels are built
+// without contraction into FMA, and pow is lanePow(), which uses only + - * /
+// and bit operations. It differs from libm pow by a unit in the last place
+// or so, so the lane levels agree with the classes to a few ULP; the scalar
+// level is the per-point kernel on libm and matches them exactly.
+enum IsaLevel { ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_AVX512, kIsaCount };
+
+const char* const kIsaNames[kIsaCount] = {"scalar", "sse2", "avx2", "avx512"};
+
+inline int isaIndex(const std::string& name) {
+    for (int i = 0; i < kIsaCount; ++i)
+        if (name == kIsaNames[i]) return i;
+    return -1;
+}
+
+// sse2 is the x86-64 baseline; other targets have the scalar level only.
+inline bool isaSupported(IsaLevel isa) {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    switch (isa) {
+    case ISA_AVX512: return __builtin_cpu_supports("avx512f");
+    case ISA_AVX2: return __builtin_cpu_supports("avx2");
+    default: return true;
+    }
+#else
+    return isa == ISA_SCALAR;
+#endif
+}
+
+inline IsaLevel detectIsa() {
+    for (int i = kIsaCount - 1; i > ISA_SCALAR; --i)
+        if (isaSupported(static_cast<IsaLevel>(i))) return static_cast<IsaLevel>(i);
+    return ISA_SCALAR;
+}
+
+IsaLevel g_isa = detectIsa();
+
+// --reproducible: the scalar level also runs the lane kernel (compiled for
+// the baseline), so results are the same bits at every --isa.
+bool g_reproducible = false;
+
+const size_t kLanes = 8;
+
+struct Lanes {
+    double v[kLanes];
+
+    Lanes() = default;
+    Lanes(double x) { std::fill(v, v + kLanes, x); }
+};
+
+inline Lanes operator+(const Lanes& a, const Lanes& b) {
+    Lanes r;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = a.v[j] + b.v[j];
+    return r;
+}
+
+inline Lanes operator-(const Lanes& a, const Lanes& b) {
+    Lanes r;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = a.v[j] - b.v[j];
+    return r;
+}
+
+inline Lanes operator*(const Lanes& a, const Lanes& b) {
+    Lanes r;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = a.v[j] * b.v[j];
+    return r;
+}
+
+inline Lanes operator/(const Lanes& a, const Lanes& b) {
+    Lanes r;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = a.v[j] / b.v[j];
+    return r;
+}
+
+inline uint64_t bitsOf(double x) {
+    uint64_t u;
+    std::memcpy(&u, &x, sizeof(x));
+    return u;
+}
+
+inline double fromBits(uint64_t u) {
+    double x;
+    std::memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+// Exact a * b = p + e (Dekker), for |a|, |b| below 2^996.
+inline void twoProduct(double a, double b, double& p, double& e) {
+    const double split = 134217729.0;       // 2^27 + 1
+    const double ca = split * a, ah = ca - (ca - a), al = a - ah;
+    const double cb = split * b, bh = cb - (cb - b), bl = b - bh;
+    p = a * b;
+    e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+}
+
+// pow(x, y) within 1.4 ULP of the correctly rounded value for normal x > 0
+// and |y ln x| < 708; z returns y ln x for lanePowInRange(). ln x is carried
+// in double-double: x = 2^k m with m in [sqrt(1/2), sqrt(2)), ln m =
+// 2 atanh(s), s = (m - 1) / (m + 1). Then exp(y ln x) = 2^n exp(r) with
+// |r| <= ln(2) / 2 by Taylor to r^13. Branch free, so a lane loop over it
+// vectorizes; outside the range the result is garbage.
+inline double lanePow(double x, double y, double& z) {
+    const double ln2Hi = 6.93147180369123816490e-01, ln2Lo = 1.90821492927058770002e-10;
+    const uint64_t u = bitsOf(x);
+    const uint64_t ku = (u - 0x0006a09e667f3bcdull) >> 52;     // biased exponent of x / m
+    const double m = fromBits(u - ((ku - 0x3fe) << 52));
+    const double k = fromBits(0x4330000000000000ull | ku) - (0x1p52 + 1022.0);
+    const double f = m - 1.0;
+    const double d = 2.0 + f, dLo = (2.0 - d) + f;
+    const double rd = 1.0 / d;
+    const double sHi = f * rd;
+    double p, pe;
+    twoProduct(sHi, d, p, pe);
+    const double sLo = (((f - p) - pe) - sHi * dLo) * rd;
+    const double s2 = sHi * sHi;
+    const double tail = sHi * s2 * (2.0 / 3 + s2 * (2.0 / 5 + s2 * (2.0 / 7 + s2 * (2.0 / 9 + s2 * (2.0 / 11
+                      + s2 * (2.0 / 13 + s2 * (2.0 / 15 + s2 * (2.0 / 17 + s2 * (2.0 / 19 + s2 * (2.0 / 21))))))))));
+    const double a = k * ln2Hi, b = 2.0 * sHi;
+    const double h = a + b, bb = h - a, l = (a - (h - bb)) + (b - bb);
+    const double lo = l + (2.0 * sLo + tail + k * ln2Lo);
+    const double lnHi = h + lo, lnLo = lo - (lnHi - h);
+
+    double zh, ze;
+    twoProduct(y, lnHi, zh, ze);
+    z = zh;
+    const double zl = ze + y * lnLo;
+    const double t = zh * 1.44269504088896338700e+00 + 0x1.8p52;     // n in the low bits
+    const double n = t - 0x1.8p52;
+    const double r = ((zh - n * ln2Hi) - n * ln2Lo) + zl;
+    const double q = r * r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720
+                   + r * (1.0 / 5040 + r * (1.0 / 40320 + r * (1.0 / 362880 + r * (1.0 / 3628800
+                   + r * (1.0 / 39916800 + r * (1.0 / 479001600 + r * (1.0 / 6227020800.0))))))))))));
+    return (1.0 + (r + q)) * fromBits((bitsOf(t) - bitsOf(0x1.8p52) + 1023) << 52);
+}
+
+inline bool lanePowInRange(double x, double y, double z) {
+    return (x >= std::numeric_limits<double>::min()) & (x <= std::numeric_limits<double>::max())
+         & (std::fabs(y) < 0x1p900) & (std::fabs(z) < 708.0);
+}
+
+// Every lane through lanePow, then the lanes outside its range (base <= 0 or
+// NaN, results that overflow or leave the normal range) through select_pow.
+template<>
+inline Lanes select_pow<Lanes>(Lanes base, Lanes exp) {
+    Lanes r, z;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = lanePow(base.v[j], exp.v[j], z.v[j]);
+    for (size_t j = 0; j < kLanes; ++j)
+        if (!lanePowInRange(base.v[j], exp.v[j], z.v[j])) r.v[j] = select_pow<double>(base.v[j], exp.v[j]);
+    return r;
+}
+
+template<>
+inline Lanes guardDenominator<Lanes>(Lanes denom) {
+    Lanes r;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = guardDenominator<double>(denom.v[j]);
+    return r;
+}
+
+template<>
+inline Lanes splitProbe<Lanes>(const SplitBracket<Lanes>& s) {
+    Lanes x;
+    for (size_t j = 0; j < kLanes; ++j)
+        x.v[j] = splitProbe<double>({s.a.v[j], s.b.v[j], s.c.v[j], s.d.v[j], s.fc.v[j], s.fd.v[j]});
+    return x;
+}
+
+template<>
+inline SplitBracket<Lanes> splitStep<Lanes>(const SplitBracket<Lanes>& s, Lanes x, Lanes fx) {
+    SplitBracket<Lanes> n;
+    for (size_t j = 0; j < kLanes; ++j) {
+        SplitBracket<double> l = splitStep<double>(
+            {s.a.v[j], s.b.v[j], s.c.v[j], s.d.v[j], s.fc.v[j], s.fd.v[j]}, x.v[j], fx.v[j]);
+        n.a.v[j] = l.a;
+        n.b.v[j] = l.b;
+        n.c.v[j] = l.c;
+        n.d.v[j] = l.d;
+        n.fc.v[j] = l.fc;
+        n.fd.v[j] = l.fd;
+    }
+    return n;
+}
+
+// sqrtpd rather than std::sqrt: the libm call may set errno on a negative
+// lane, and that branch keeps the loop scalar. Both round exactly.
+template<>
+inline Lanes select_sqrt<Lanes>(Lanes x) {
+    Lanes r;
+#if defined(__x86_64__)
+    static_assert(kLanes == 8, "one sqrtpd per lane pair");
+    _mm_storeu_pd(r.v + 0, _mm_sqrt_pd(_mm_loadu_pd(x.v + 0)));
+    _mm_storeu_pd(r.v + 2, _mm_sqrt_pd(_mm_loadu_pd(x.v + 2)));
+    _mm_storeu_pd(r.v + 4, _mm_sqrt_pd(_mm_loadu_pd(x.v + 4)));
+    _mm_storeu_pd(r.v + 6, _mm_sqrt_pd(_mm_loadu_pd(x.v + 6)));
+#else
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = std::sqrt(x.v[j]);
+#endif
+    return r;
+}
+
+template<>
+inline Lanes select_max<Lanes>(Lanes a, Lanes b) {
+    Lanes r;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = a.v[j] < b.v[j] ? b.v[j] : a.v[j];
+    return r;
+}
+
+template<>
+inline Lanes select_min<Lanes>(Lanes a, Lanes b) {
+    Lanes r;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = b.v[j] < a.v[j] ? b.v[j] : a.v[j];
+    return r;
+}
+
+template<>
+inline Lanes select_greater<Lanes>(Lanes x, Lanes y, Lanes a, Lanes b) {
+    Lanes r;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = x.v[j] > y.v[j] ? a.v[j] : b.v[j];
+    return r;
+}
+
+// kLanes consecutive points, transposed; in is kept for the stages that take
+// a member pointer.
+struct LaneInputs : BasicEngineInputs<Lanes> {
+    const EngineInputs* in;
+
+    explicit LaneInputs(const EngineInputs* p) : in(p) {
+        auto lanes = [p](double EngineInputs::* m) {
+            Lanes r;
+            for (size_t j = 0; j < kLanes; ++j) r.v[j] = p[j].*m;
+            return r;
+        };
+        gamma_air = lanes(&EngineInputs::gamma_air); gamma_gas = lanes(&EngineInputs::gamma_gas);
+        cp_air = lanes(&EngineInputs::cp_air); cp_gas = lanes(&EngineInputs::cp_gas);
+        R_air = lanes(&EngineInputs::R_air); Q_HV = lanes(&EngineInputs::Q_HV);
+        M0 = lanes(&EngineInputs::M0); T0 = lanes(&EngineInputs::T0); P0 = lanes(&EngineInputs::P0);
+        eta_inlet = lanes(&EngineInputs::eta_inlet); eta_c = lanes(&EngineInputs::eta_c);
+        eta_f = lanes(&EngineInputs::eta_f); eta_b = lanes(&EngineInputs::eta_b);
+        eta_t = lanes(&EngineInputs::eta_t); eta_ab = lanes(&EngineInputs::eta_ab);
+        eta_n = lanes(&EngineInputs::eta_n);
+        pi_b = lanes(&EngineInputs::pi_b); pi_ab = lanes(&EngineInputs::pi_ab); pi_m = lanes(&EngineInputs::pi_m);
+        T_t4 = lanes(&EngineInputs::T_t4); T_t7 = lanes(&EngineInputs::T_t7);
+        pi_c_jet = lanes(&EngineInputs::pi_c_jet); BPR = lanes(&EngineInputs::BPR);
+        pi_f = lanes(&EngineInputs::pi_f); pi_c_fan = lanes(&EngineInputs::pi_c_fan);
+        eta_t_hp = lanes(&EngineInputs::eta_t_hp); eta_t_lp = lanes(&EngineInputs::eta_t_lp);
+        bleed_cool = lanes(&EngineInputs::bleed_cool); bleed_cust = lanes(&EngineInputs::bleed_cust);
+        W_offtake = lanes(&EngineInputs::W_offtake);
+        eta_pt = lanes(&EngineInputs::eta_pt); eta_prop = lanes(&EngineInputs::eta_prop);
+        eta_gear = lanes(&EngineInputs::eta_gear); pt_split = lanes(&EngineInputs::pt_split);
+        eps_ic = lanes(&EngineInputs::eps_ic); pi_ic = lanes(&EngineInputs::pi_ic);
+        eps_rec = lanes(&EngineInputs::eps_rec); pi_rec = lanes(&EngineInputs::pi_rec);
+        vc_mode = lanes(&EngineInputs::vc_mode); BPR3 = lanes(&EngineInputs::BPR3);
+        pi_f3 = lanes(&EngineInputs::pi_f3); fuel_type = lanes(&EngineInputs::fuel_type);
+    }
+};
+
+template<double EngineInputs::*M>
+inline Lanes inputOf(const LaneInputs& p) {
+    Lanes r;
+    for (size_t j = 0; j < kLanes; ++j) r.v[j] = p.in[j].*M;
+    return r;
+}
+
+// Points on a library fuel are rerun through the per-point kernel (see
+// cycleBatchAt()), so the lane stages never read the fuel tables.
+inline bool usesFuelLibrary(const LaneInputs&) { return false; }
+inline bool usesEquilibrium(const LaneInputs&) { return false; }
+inline const Fuel* libraryFuel(const LaneInputs&) { return nullptr; }
+inline Lanes libraryBurnerRatio(const LaneInputs&, Lanes, Lanes) {
+    return std::numeric_limits<double>::quiet_NaN();
+}
+inline Lanes libraryAfterburnerRatio(const LaneInputs&, Lanes, Lanes, Lanes) {
+    return std::numeric_limits<double>::quiet_NaN();
+}
+inline Lanes equilibriumNozzleVelocity(const LaneInputs&, Lanes, Lanes, Lanes) {
+    return std::numeric_limits<double>::quiet_NaN();
+}
+inline Lanes stageGamma(const LaneInputs&, Lanes input, Lanes, Lanes, Lanes) { return input; }
+
+inline Lanes recuperatorDenominator(const RecuperatorProblem<Lanes>& p) { return p.denom; }
+inline Lanes recuperatorFuelRatio(const RecuperatorProblem<Lanes>&, Lanes, Lanes f_gas) { return f_gas; }
+
+// Emission indices stay on libm per lane: they are not part of any cycle.
+inline void emissionIndices(const Lanes& Tt3, const Lanes& Pt3, const Lanes& Tt4, Lanes& ei_nox, Lanes& ei_co) {
+    for (size_t j = 0; j < kLanes; ++j) emissionIndices(Tt3.v[j], Pt3.v[j], Tt4.v[j], ei_nox.v[j], ei_co.v[j]);
+}
+
+// A Cycle over a block in groups of kLanes; a short last group repeats its
+// final point, so every point sees the same arithmetic wherever it falls.
+template<class Cycle, bool Emit>
+inline void laneBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    const bool emit = Emit && (mask & kEmissionOutputs);
+    EngineInputs tail[kLanes];
+    for (size_t first = 0; first < n; first += kLanes) {
+        const size_t m = std::min(kLanes, n - first);
+        const EngineInputs* group = in + first;
+        if (m < kLanes) {
+            for (size_t j = 0; j < kLanes; ++j) tail[j] = in[first + std::min(j, m - 1)];
+            group = tail;
+        }
+        const LaneInputs p(group);
+        FlowState<Lanes> s{};
+        Cycle::run(s, p);
+        if constexpr (Emit) if (emit) Emissions::run(s, p);
+        Lanes value[OUT_COUNT];
+        s.columns(value);
+        for (int c = 0; c < OUT_COUNT; ++c)
+            if (mask & outputBit(c))
+                for (size_t j = 0; j < m; ++j) out[c][first + j] = value[c].v[j];
+    }
+}
+
+// One instance per ISA level. flatten inlines the whole cycle under the
+// target, and fp-contract=off keeps a * b + c two roundings on FMA hardware.
+// The vectorizer's cost model is the -O3 one; -O2 would keep most lane
+// loops scalar.
+template<class Cycle, bool Emit>
+__attribute__((flatten, optimize("fp-contract=off", "vect-cost-model=dynamic")))
+void laneBatchSse2(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    laneBatch<Cycle, Emit>(in, n, out, mask);
+}
+
+#if defined(__x86_64__)
+template<class Cycle, bool Emit>
+__attribute__((target("avx2"), flatten, optimize("fp-contract=off", "vect-cost-model=dynamic")))
+void laneBatchAvx2(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    laneBatch<Cycle, Emit>(in, n, out, mask);
+}
+
+template<class Cycle, bool Emit>
+__attribute__((target("avx512f"), flatten, optimize("fp-contract=off", "vect-cost-model=dynamic")))
+void laneBatchAvx512(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    laneBatch<Cycle, Emit>(in, n, out, mask);
+}
+#else
+template<class Cycle, bool Emit>
+void laneBatchAvx2(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    laneBatchSse2<Cycle, Emit>(in, n, out, mask);
+}
+
+template<class Cycle, bool Emit>
+void laneBatchAvx512(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    laneBatchSse2<Cycle, Emit>(in, n, out, mask);
+}
+#endif
+
+// ==========================================================
+// Batch Cycle Kernels
+// ==========================================================
+// A StageGraph evaluated over a block of points and written straight into
+// output columns. There is no member state and no debug output, so a block
+// can run on any worker and the guards are selects rather than branches.
+const size_t kBatchSize = 128;
+
+// `mask` selects the output columns to write; out[c] may be null for the rest.
+using BatchKernel = void (*)(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask);
+
+// Emit adds the Emissions group; without it the stage is not instantiated.
+// It is also skipped at run time when neither emission column is selected.
+template<class Cycle, bool Emit>
+void cycleBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    const bool emit = Emit && (mask & kEmissionOutputs);
+    for (size_t i = 0; i < n; ++i) {
+        FlowState<double> s{};
+        Cycle::run(s, in[i]);
+        if constexpr (Emit) if (emit) Emissions::run(s, in[i]);
+        s.store(out, i, mask);
+    }
+}
+
+// cycleBatch at the scalar level (unless --reproducible), otherwise the lane
+// kernel for the level; points on a library fuel then run again one at a
+// time through cycleBatch.
+template<class Cycle, bool Emit>
+void cycleBatchAt(IsaLevel isa, const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    switch (isa) {
+    case ISA_SCALAR:
+        if (!g_reproducible) {
+            cycleBatch<Cycle, Emit>(in, n, out, mask);
+            return;
+        }
+        laneBatchSse2<Cycle, Emit>(in, n, out, mask);
+        break;
+    case ISA_SSE2: laneBatchSse2<Cycle, Emit>(in, n, out, mask); break;
+    case ISA_AVX2: laneBatchAvx2<Cycle, Emit>(in, n, out, mask); break;
+    case ISA_AVX512: laneBatchAvx512<Cycle, Emit>(in, n, out, mask); break;
+    case kIsaCount: break;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (!usesFuelLibrary(in[i])) continue;
+        double* row[OUT_COUNT];
+        for (int c = 0; c < OUT_COUNT; ++c) row[c] = out[c] ? out[c] + i : nullptr;
+        cycleBatch<Cycle, Emit>(in + i, 1, row, mask);
+    }
+}
+
+inline bool hasIsaLevels(EngineType engine) {
+    return engine == ENGINE_TURBOJET || engine == ENGINE_TURBOFAN || engine == ENGINE_TWO_SPOOL ||
+           engine == ENGINE_TURBOPROP || engine == ENGINE_TURBOSHAFT || engine == ENGINE_ICR ||
+           engine == ENGINE_VARIABLE;
+}
+
+// A fixed ISA level, for validating the levels side by side.
+template<class Cycle, bool Emit, IsaLevel Isa>
+void cycleBatchIsa(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    cycleBatchAt<Cycle, Emit>(Isa, in, n, out, mask);
+}
+
+template<bool Emit>
+void turbojetBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    cycleBatchAt<TurbojetCycle, Emit>(g_isa, in, n, out, mask);
+}
+
+template<bool Emit>
+void turbofanBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    cycleBatchAt<TurbofanCycle, Emit>(g_isa, in, n, out, mask);
+}
+
+template<bool Emit>
+void twoSpoolBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    cycleBatchAt<TwoSpoolCycle, Emit>(g_isa, in, n, out, mask);
+}
+
+template<bool Emit>
+void turbopropBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    cycleBatchAt<TurbopropCycle, Emit>(g_isa, in, n, out, mask);
+}
+
+template<bool Emit>
+void turboshaftBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    cycleBatchAt<TurboshaftCycle, Emit>(g_isa, in, n, out, mask);
+}
+
+template<bool Emit>
+void icrTurbofanBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    cycleBatchAt<IcrTurbofanCycle, Emit>(g_isa, in, n, out, mask);
+}
+
+// The points idx[0..n) (at most kBatchSize) gathered into a contiguous block,
+// run through cycleBatchAt() at the current ISA level, and scattered back.
+template<class Cycle, bool Emit>
+void cycleBatchIndexed(const EngineInputs* in, const uint32_t* idx, size_t n, double* const out[OUT_COUNT],
+                       OutputMask mask) {
+    if (n == 0) return;
+    EngineInputs block[kBatchSize];
+    double storage[OUT_COUNT * kBatchSize];
+    double* cols[OUT_COUNT];
+    for (size_t k = 0; k < n; ++k) block[k] = in[idx[k]];
+    for (int c = 0; c < OUT_COUNT; ++c) cols[c] = (mask & outputBit(c)) ? storage + c * kBatchSize : nullptr;
+    cycleBatchAt<Cycle, Emit>(g_isa, block, n, cols, mask);
+    for (int c = 0; c < OUT_COUNT; ++c)
+        if (cols[c])
+            for (size_t k = 0; k < n; ++k) out[c][idx[k]] = cols[c][k];
+}
+
+// Mixed-mode blocks are grouped by a stable counting sort on the mode, each
+// group is gathered and runs its own StageGraph on the lane kernel with no
+// per-point branch, and the results scatter back to input order.
+template<bool Emit>
+void variableCycleBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    uint32_t idx[kBatchSize];
+    for (size_t first = 0; first < n; first += kBatchSize) {
+        const size_t m = std::min(kBatchSize, n - first);
+        uint8_t mode[kBatchSize];
+        size_t start[VC_MODE_COUNT + 1] = {};
+        for (size_t j = 0; j < m; ++j) {
+            mode[j] = static_cast<uint8_t>(variableCycleMode(in[first + j].vc_mode));
+            ++start[mode[j] + 1];
+        }
+        for (int g = 0; g < VC_MODE_COUNT; ++g) start[g + 1] += start[g];
+        size_t fill[VC_MODE_COUNT];
+        std::copy(start, start + VC_MODE_COUNT, fill);
+        for (size_t j = 0; j < m; ++j) idx[fill[mode[j]]++] = static_cast<uint32_t>(first + j);
+        cycleBatchIndexed<VcJetCycle, Emit>(in, idx + start[VC_JET], start[VC_JET + 1] - start[VC_JET], out, mask);
+        cycleBatchIndexed<TurbofanCycle, Emit>(in, idx + start[VC_FAN], start[VC_FAN + 1] - start[VC_FAN], out,
+                                               mask);
+        cycleBatchIndexed<VcThreeStreamCycle, Emit>(in, idx + start[VC_THREE_STREAM],
+                                                    start[VC_THREE_STREAM + 1] - start[VC_THREE_STREAM], out, mask);
+    }
+}
+
+// ==========================================================
+// Runtime Cycle Programs
+// ==========================================================
+// A cycle description file lists components in flow order, e.g.
+//
+//     cycle turbofan_mixed
+//     reference fan              # optional: --validate compares with Turbofan
+//     inlet
+//     fan         pi=pi_f eta=eta_f
+//     compressor  pi=pi_c_fan eta=eta_c
+//     combustor
+//     turbine
+//     mixer
+//     afterburner
+//     nozzle
+//     performance mixed
+//
+// The loader compiles it into a flat list of register ops that mirror the
+// component library equations one for one. Each op runs across a whole
+// kBatchSize block of lanes, so dispatch is paid once per block and the
+// per-op loops vectorize.
+enum CycleOpCode {
+    OP_INPUT, OP_CONST, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MAX, OP_SQRT, OP_SAFE_POW, OP_GUARD, OP_STORE
+};
+
+struct CycleOp {
+    CycleOpCode code;
+    int dst, a, b;
+    double value;                        // OP_CONST
+    double EngineInputs::* field;        // OP_INPUT
+};
+
+struct CycleProgram {
+    std::string name;
+    std::vector<CycleOp> ops;
+    int registers = 0;
+    int reference = -1;                  // EngineType it should reproduce, -1 if none
+    bool stored[OUT_COUNT] = {};
+
+    // Everything that decides the results: each op with the input it reads
+    // (by name), and which columns the program stores.
+    uint64_t signature() const {
+        uint64_t h = 0xCBF29CE484222325ull;
+        for (const CycleOp& op : ops) {
+            h = fnv1a(h, &op.code, sizeof(op.code));
+            h = fnv1a(h, &op.dst, sizeof(op.dst));
+            h = fnv1a(h, &op.a, sizeof(op.a));
+            h = fnv1a(h, &op.b, sizeof(op.b));
+            h = fnv1a(h, &op.value, sizeof(op.value));
+            if (op.code == OP_INPUT) {
+                const char* field = findInputField(op.field)->name;
+                h = fnv1a(h, field, std::strlen(field) + 1);
+            }
+        }
+        h = fnv1a(h, stored, sizeof(stored));
+        return h;
+    }
+};
+
+CycleProgram g_cycle_program;
+
+class CycleBuilder {
+public:
+    explicit CycleBuilder(CycleProgram& prog) : prog_(prog) {}
+
+    int input(double EngineInputs::* field) {
+        for (const auto& c : inputs_) if (c.first == field) return c.second;
+        int r = emit({OP_INPUT, prog_.registers, -1, -1, 0.0, field});
+        inputs_.push_back({field, r});
+        return r;
+    }
+
+    int constant(double v) {
+        for (const auto& c : constants_) if (c.first == v) return c.second;
+        int r = emit({OP_CONST, prog_.registers, -1, -1, v, nullptr});
+        constants_.push_back({v, r});
+        return r;
+    }
+
+    int add(int a, int b) { return binary(OP_ADD, a, b); }
+    int sub(int a, int b) { return binary(OP_SUB, a, b); }
+    int mul(int a, int b) { return binary(OP_MUL, a, b); }
+    int div(int a, int b) { return binary(OP_DIV, a, b); }
+    int max(int a, int b) { return binary(OP_MAX, a, b); }
+    int spow(int a, int b) { return binary(OP_SAFE_POW, a, b); }
+    int sqrt(int a) { return binary(OP_SQRT, a, -1); }
+    int guard(int a) { return binary(OP_GUARD, a, -1); }
+
+    void store(int column, int r) {
+        prog_.ops.push_back({OP_STORE, column, r, -1, 0.0, nullptr});
+        prog_.stored[column] = true;
+    }
+
+private:
+    int binary(CycleOpCode code, int a, int b) { return emit({code, prog_.registers, a, b, 0.0, nullptr}); }
+
+    int emit(CycleOp op) {
+        prog_.ops.push_back(op);
+        return prog_.registers++;
+    }
+
+    CycleProgram& prog_;
+    std::vector<std::pair<double EngineInputs::*, int>> inputs_;
+    std::vector<std::pair<double, int>> constants_;
+};
+
+// Registers holding the flow state between components (-1: not produced yet).
+struct FlowRegisters {
+    int V0 = -1, Tt = -1, Pt = -1, TtB = -1, PtB = -1, fComb = -1, fAb = -1;
+    int work = -1, lpWork = -1, mCore = -1, fuel = -1, mCool = -1, TtCool = -1;
+    int V9 = -1, T9 = -1, P9 = -1;
+    bool mixed = false, bled = false;
+};
+
+// Parameters of one description line: pi=<input>, eta=<input>, stream=core|bypass,
+// spool=hp|lp, or a bare word.
+struct CycleLine {
+    int number;
+    std::string component;
+    std::vector<std::pair<std::string, std::string>> params;
+
+    std::string get(const std::string& key, const std::string& fallback) const {
+        for (const auto& p : params) if (p.first == key) return p.second;
+        return fallback;
+    }
+};
+
+bool compileCycleLine(const CycleLine& line, CycleBuilder& b, FlowRegisters& s) {
+    using E = EngineInputs;
+    auto field = [&](const std::string& key, const char* fallback) -> double E::* {
+        const InputField* f = findInputField(line.get(key, fallback));
+        return f ? f->member : nullptr;
+    };
+    auto need = [&](bool ok, const char* what) {
+        if (!ok) std::cerr << "Error: cycle line " << line.number << ": " << line.component << " " << what << "\n";
+        return ok;
+    };
+    const int one = b.constant(1.0);
+    const int gA = b.input(&E::gamma_air), gG = b.input(&E::gamma_gas);
+    const int cpA = b.input(&E::cp_air), cpG = b.input(&E::cp_gas);
+    const std::string spool = line.get("spool", "hp");
+    if (!need(spool == "hp" || spool == "lp", "expects spool=hp|lp")) return false;
+
+    const std::string& c = line.component;
+    if (c == "inlet") {
+        int M0 = b.input(&E::M0), T0 = b.input(&E::T0);
+        s.V0 = b.mul(M0, b.sqrt(b.mul(b.mul(gA, b.input(&E::R_air)), T0)));
+        s.Tt = b.mul(T0, b.add(one, b.mul(b.mul(b.div(b.sub(gA, one), b.constant(2.0)), M0), M0)));
+        s.Pt = b.mul(b.mul(b.input(&E::P0), b.spow(b.div(s.Tt, T0), b.div(gA, b.sub(gA, one)))),
+                     b.input(&E::eta_inlet));
+        s.work = s.lpWork = s.mCool = s.fAb = b.constant(0.0);
+        s.mCore = one;
+        return true;
+    }
+    if (!need(s.Tt >= 0, "must follow inlet")) return false;
+    int& work = spool == "hp" ? s.work : s.lpWork;
+    if (c == "fan" || c == "compressor") {
+        bool fan = c == "fan";
+        double E::* pi = field("pi", fan ? "pi_f" : "pi_c_jet");
+        double E::* eta = field("eta", fan ? "eta_f" : "eta_c");
+        if (!need(pi && eta, "has an unknown pi= or eta= input")) return false;
+        int Pi = b.input(pi), TtIn = s.Tt;
+        s.Pt = b.mul(s.Pt, Pi);
+        int TtIsen = b.mul(TtIn, b.spow(Pi, b.div(b.sub(gA, one), gA)));
+        s.Tt = b.add(TtIn, b.div(b.sub(TtIsen, TtIn), b.input(eta)));
+        int w = b.mul(cpA, b.sub(s.Tt, TtIn));
+        if (fan) {
+            s.TtB = s.Tt;
+            s.PtB = s.Pt;
+            work = b.add(work, b.mul(b.add(one, b.input(&E::BPR)), w));
+        } else {
+            work = b.add(work, w);
+            b.store(OUT_T_T3, s.Tt);
+            b.store(OUT_P_T3, s.Pt);
+        }
+        return true;
+    }
+    if (c == "bleed") {
+        int cool = b.input(&E::bleed_cool);
+        s.mCool = cool;
+        s.TtCool = s.Tt;
+        s.mCore = b.sub(b.sub(s.mCore, cool), b.input(&E::bleed_cust));
+        s.bled = true;
+        return true;
+    }
+    if (c == "combustor") {
+        int Tt4 = b.input(&E::T_t4);
+        int denom = b.guard(b.sub(b.mul(b.input(&E::eta_b), b.input(&E::Q_HV)), b.mul(cpG, Tt4)));
+        s.fComb = b.div(b.sub(b.mul(cpG, Tt4), b.mul(cpA, s.Tt)), denom);
+        s.fuel = b.mul(s.mCore, s.fComb);
+        s.mCore = b.add(s.mCore, s.fuel);
+        s.Tt = Tt4;
+        s.Pt = b.mul(s.Pt, b.input(&E::pi_b));
+        return true;
+    }
+    if (c == "offtake") {
+        s.work = b.add(s.work, b.input(&E::W_offtake));
+        return true;
+    }
+    if (c == "cooling") {
+        if (!need(s.TtCool >= 0, "needs a bleed upstream")) return false;
+        int mOut = b.add(s.mCore, s.mCool);
+        s.Tt = b.add(s.Tt, b.div(b.mul(s.mCool, b.sub(b.mul(cpA, s.TtCool), b.mul(cpG, s.Tt))),
+                                 b.mul(mOut, cpG)));
+        s.mCore = mOut;
+        s.mCool = b.constant(0.0);
+        return true;
+    }
+    if (c == "turbine") {
+        if (!need(s.fComb >= 0, "needs a combustor upstream")) return false;
+        double E::* eta = field("eta", "eta_t");
+        if (!need(eta != nullptr, "has an unknown eta= input")) return false;
+        int TtIn = s.Tt;
+        s.Tt = b.sub(TtIn, b.div(work, b.mul(s.mCore, cpG)));
+        int TtIsen = b.sub(TtIn, b.div(b.sub(TtIn, s.Tt), b.input(eta)));
+        s.Pt = b.mul(s.Pt, b.spow(b.div(TtIsen, TtIn), b.div(gG, b.sub(gG, one))));
+        if (line.get("spool", "") != "hp") {
+            b.store(OUT_T_T5, s.Tt);
+            b.store(OUT_P_T5, s.Pt);
+        }
+        return true;
+    }
+    if (c == "mixer") {
+        if (!need(s.TtB >= 0 && s.fComb >= 0, "needs a fan and a combustor upstream")) return false;
+        int BPR = b.input(&E::BPR);
+        int m = s.mCore;
+        s.Tt = b.div(b.add(b.mul(b.mul(BPR, cpA), s.TtB), b.mul(b.mul(m, cpG), s.Tt)),
+                     b.mul(b.add(BPR, m), cpG));
+        s.Pt = b.mul(s.PtB, b.input(&E::pi_m));
+        s.mixed = true;
+        return true;
+    }
+    if (c == "duct") {
+        double E::* pi = field("pi", "pi_m");
+        std::string stream = line.get("stream", "core");
+        if (!need(pi && (stream == "core" || (stream == "bypass" && s.PtB >= 0)),
+                  "needs a known pi= and stream=core|bypass (bypass after a fan)")) return false;
+        int& Pt = stream == "core" ? s.Pt : s.PtB;
+        Pt = b.mul(Pt, b.input(pi));
+        return true;
+    }
+    if (c == "afterburner") {
+        int Tt7 = b.input(&E::T_t7);
+        int denom = b.guard(b.sub(b.mul(b.input(&E::eta_ab), b.input(&E::Q_HV)), b.mul(cpG, Tt7)));
+        s.fAb = b.div(b.mul(cpG, b.sub(Tt7, s.Tt)), denom);
+        s.Tt = Tt7;
+        s.Pt = b.mul(s.Pt, b.input(&E::pi_ab));
+        return true;
+    }
+    if (c == "nozzle") {
+        int P0 = b.input(&E::P0);
+        s.P9 = b.max(s.Pt, P0);
+        s.T9 = s.Tt;
+        int T9isen = b.mul(s.T9, b.spow(b.div(P0, s.P9), b.div(b.sub(gG, one), gG)));
+        int T9actual = b.sub(s.T9, b.mul(b.input(&E::eta_n), b.sub(s.T9, T9isen)));
+        s.V9 = b.sqrt(b.mul(b.mul(b.constant(2.0), cpG), b.sub(s.T9, T9actual)));
+        b.store(OUT_V9, s.V9);
+        b.store(OUT_T_T9, s.T9);
+        b.store(OUT_P_T9, s.P9);
+        return true;
+    }
+    if (c == "performance") {
+        if (!need(s.V9 >= 0 && s.fComb >= 0, "needs a combustor and a nozzle upstream")) return false;
+        bool mixed = line.get("mixed", "") == "mixed" || (s.mixed && line.get("core", "") != "core");
+        // Customer bleed only leaves the cycle if a bleed line took it.
+        auto lessCustomer = [&](int m) { return s.bled ? b.sub(m, b.input(&E::bleed_cust)) : m; };
+        int fTotal, ST;
+        if (mixed) {
+            int BPR = b.input(&E::BPR);
+            int mIn = b.add(one, BPR);
+            int mMixed = lessCustomer(b.add(b.add(one, BPR), s.fuel));
+            int mFab = b.mul(mMixed, s.fAb);
+            int Fnet = b.sub(b.mul(b.add(mMixed, mFab), s.V9), b.mul(mIn, s.V0));
+            ST = b.div(Fnet, mIn);
+            fTotal = b.div(b.add(s.fuel, mFab), mIn);
+        } else {
+            fTotal = b.add(s.fuel, b.mul(s.mCore, s.fAb));
+            ST = b.sub(b.mul(lessCustomer(b.add(one, fTotal)), s.V9), s.V0);
+        }
+        b.store(OUT_SPECIFIC_THRUST, ST);
+        b.store(OUT_TSFC, b.div(fTotal, b.max(b.constant(1e-9), ST)));
+        b.store(OUT_F_COMB, s.fComb);
+        b.store(OUT_F_AB, s.fAb);
+        b.store(OUT_F_TOTAL, fTotal);
+        b.store(OUT_V0, s.V0);
+        return true;
+    }
+    std::cerr << "Error: cycle line " << line.number << ": unknown component " << c << "\n";
+    return false;
+}
+
+bool loadCycleProgram(std::istream& in, CycleProgram& prog) {
+    prog = CycleProgram();
+    CycleBuilder b(prog);
+    FlowRegisters s;
+    bool performance = false;
+    std::string text;
+    for (int number = 1; std::getline(in, text); ++number) {
+        text = text.substr(0, text.find('#'));
+        std::stringstream ss(text);
+        CycleLine line{number, "", {}};
+        if (!(ss >> line.component)) continue;
+        for (std::string tok; ss >> tok;) {
+            size_t eq = tok.find('=');
+            if (eq == std::string::npos) line.params.push_back({tok, tok});
+            else line.params.push_back({tok.substr(0, eq), tok.substr(eq + 1)});
+        }
+        if (line.component == "cycle") {
+            prog.name = line.params.empty() ? "" : line.params[0].first;
+        } else if (line.component == "reference") {
+            std::string r = line.params.empty() ? "" : line.params[0].first;
+            prog.reference = r == "jet" ? ENGINE_TURBOJET : r == "fan" ? ENGINE_TURBOFAN
+                           : r == "fan2" ? ENGINE_TWO_SPOOL : -1;
+        } else {
+            if (!compileCycleLine(line, b, s)) return false;
+            performance = performance || line.component == "performance";
+        }
+    }
+    if (!performance) {
+        std::cerr << "Error: cycle description has no performance line.\n";
+        return false;
+    }
+    if (prog.name.empty()) prog.name = "cycle";
+    return true;
+}
+
+// Arithmetic of one op on one lane; shared by the evaluator and the kernel
+// generator's constant folding so both round identically.
+template<CycleOpCode Code>
+inline double cycleOp(double a, double b) {
+    switch (Code) {
+    case OP_ADD: return a + b;
+    case OP_SUB: return a - b;
+    case OP_MUL: return a * b;
+    case OP_DIV: return a / b;
+    case OP_MAX: return std::max(a, b);
+    case OP_SQRT: return std::sqrt(a);
+    case OP_SAFE_POW: return select_pow(a, b);
+    case OP_GUARD: return guardDenominator(a);
+    default: return a;
+    }
+}
+
+double foldCycleOp(CycleOpCode code, double a, double b) {
+    switch (code) {
+    case OP_ADD: return cycleOp<OP_ADD>(a, b);
+    case OP_SUB: return cycleOp<OP_SUB>(a, b);
+    case OP_MUL: return cycleOp<OP_MUL>(a, b);
+    case OP_DIV: return cycleOp<OP_DIV>(a, b);
+    case OP_MAX: return cycleOp<OP_MAX>(a, b);
+    case OP_SQRT: return cycleOp<OP_SQRT>(a, b);
+    case OP_SAFE_POW: return cycleOp<OP_SAFE_POW>(a, b);
+    case OP_GUARD: return cycleOp<OP_GUARD>(a, b);
+    default: return a;
+    }
+}
+
+template<CycleOpCode Code>
+inline void cycleOpLanes(double* d, const double* a, const double* b, size_t m) {
+    for (size_t j = 0; j < m; ++j) d[j] = cycleOp<Code>(a[j], b ? b[j] : 0.0);
+}
+
+// Ops whose result reaches a selected column; the evaluator skips the rest,
+// so stages that only feed unselected outputs cost nothing.
+std::vector<char> liveCycleOps(const CycleProgram& prog, OutputMask mask) {
+    std::vector<char> live(prog.ops.size(), 0), reg(static_cast<size_t>(prog.registers), 0);
+    for (size_t k = prog.ops.size(); k-- > 0;) {
+        const CycleOp& op = prog.ops[k];
+        if (op.code == OP_STORE) {
+            live[k] = (mask & outputBit(op.dst)) != 0;
+            if (live[k]) reg[op.a] = 1;
+            continue;
+        }
+        if (!reg[op.dst]) continue;
+        live[k] = 1;
+        if (op.a >= 0) reg[op.a] = 1;
+        if (op.b >= 0) reg[op.b] = 1;
+    }
+    return live;
+}
+
+void runCycleProgram(const CycleProgram& prog, const EngineInputs* in, size_t n,
+                     double* const out[OUT_COUNT], OutputMask mask) {
+    thread_local std::vector<double> regs;
+    thread_local const CycleProgram* liveProg = nullptr;
+    thread_local OutputMask liveMask = 0;
+    thread_local std::vector<char> live;
+    if (liveProg != &prog || liveMask != mask || live.size() != prog.ops.size()) {
+        live = liveCycleOps(prog, mask);
+        liveProg = &prog;
+        liveMask = mask;
+    }
+    regs.resize(static_cast<size_t>(prog.registers) * kBatchSize);
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (size_t first = 0; first < n; first += kBatchSize) {
+        const size_t m = std::min(kBatchSize, n - first);
+        const EngineInputs* lane = in + first;
+        for (size_t k = 0; k < prog.ops.size(); ++k) {
+            if (!live[k]) continue;
+            const CycleOp& op = prog.ops[k];
+            double* d = regs.data() + static_cast<size_t>(op.dst) * kBatchSize;
+            const double* a = op.a >= 0 ? regs.data() + static_cast<size_t>(op.a) * kBatchSize : nullptr;
+            const double* b = op.b >= 0 ? regs.data() + static_cast<size_t>(op.b) * kBatchSize : nullptr;
+            switch (op.code) {
+            case OP_INPUT: for (size_t j = 0; j < m; ++j) d[j] = lane[j].*(op.field); break;
+            case OP_CONST: for (size_t j = 0; j < m; ++j) d[j] = op.value; break;
+            case OP_ADD: cycleOpLanes<OP_ADD>(d, a, b, m); break;
+            case OP_SUB: cycleOpLanes<OP_SUB>(d, a, b, m); break;
+            case OP_MUL: cycleOpLanes<OP_MUL>(d, a, b, m); break;
+            case OP_DIV: cycleOpLanes<OP_DIV>(d, a, b, m); break;
+            case OP_MAX: cycleOpLanes<OP_MAX>(d, a, b, m); break;
+            case OP_SQRT: cycleOpLanes<OP_SQRT>(d, a, nullptr, m); break;
+            case OP_SAFE_POW: cycleOpLanes<OP_SAFE_POW>(d, a, b, m); break;
+            case OP_GUARD: cycleOpLanes<OP_GUARD>(d, a, nullptr, m); break;
+            case OP_STORE: {
+                double* col = out[op.dst] + first;
+                for (size_t j = 0; j < m; ++j) col[j] = a[j];
+                break;
+            }
+            }
+        }
+        for (int c = 0; c < OUT_COUNT; ++c)
+            if ((mask & outputBit(c)) && !prog.stored[c]) std::fill(out[c] + first, out[c] + first + m, nan);
+    }
+}
+
+void cycleProgramBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    runCycleProgram(g_cycle_program, in, n, out, mask);
+}
+
+
+// ==========================================================
+// Ahead-of-Time Cycle Kernels
+// ==========================================================
+// --emit-kernel writes the loaded cycle program as straight-line C++: inputs
+// named by --fold are baked in (and every op depending only on them is
+// evaluated here, with the same arithmetic as the evaluator), the rest are
+// read from SoA columns. Only the --outputs columns are written, and ops that
+// feed nothing else are not generated. Compile it as a shared object and load
+// it with --kernel for --sweep/--bench plugin.
+const int kKernelAbi = 2;
+
+// Body of a C++ string literal: quotes, backslashes and control characters
+// escaped, the control characters as three-digit octal.
+std::string cppStringBody(const std::string& text) {
+    std::ostringstream os;
+    for (unsigned char ch : text) {
+        if (ch == '"' || ch == '\\') os << '\\' << ch;
+        else if (ch < 0x20 || ch == 0x7f)
+            os << '\\' << std::oct << std::setw(3) << std::setfill('0') << int(ch) << std::dec;
+        else os << ch;
+    }
+    return os.str();
+}
+
+std::string cppDoubleLiteral(double v) {
+    if (std::isnan(v)) return "std::numeric_limits<double>::quiet_NaN()";
+    if (std::isinf(v)) return v > 0 ? "std::numeric_limits<double>::infinity()"
+                                    : "-std::numeric_limits<double>::infinity()";
+    std::ostringstream os;
+    os << std::hexfloat << v;
+    return os.str();
+}
+
+bool emitCycleKernel(const CycleProgram& prog, const EngineInputs& values,
+                     const std::vector<const InputField*>& folded, OutputMask outputs, std::ostream& os) {
+    auto isFolded = [&](const InputField* f) {
+        return std::find(folded.begin(), folded.end(), f) != folded.end();
+    };
+
+    // Registers are either known constants or named locals.
+    const size_t nreg = static_cast<size_t>(prog.registers);
+    std::vector<char> known(nreg, 0), live(nreg, 0);
+    std::vector<double> value(nreg, 0.0);
+    std::vector<const InputField*> columns;
+    for (const CycleOp& op : prog.ops) {
+        if (op.code == OP_STORE) continue;
+        if (op.code == OP_CONST) {
+            known[op.dst] = 1;
+            value[op.dst] = op.value;
+        } else if (op.code == OP_INPUT) {
+            const InputField* f = findInputField(op.field);
+            if (isFolded(f)) {
+                known[op.dst] = 1;
+                value[op.dst] = values.*(op.field);
+            }
+        } else if (known[op.a] && (op.b < 0 || known[op.b])) {
+            known[op.dst] = 1;
+            value[op.dst] = foldCycleOp(op.code, value[op.a], op.b >= 0 ? value[op.b] : 0.0);
+        }
+    }
+    for (auto it = prog.ops.rbegin(); it != prog.ops.rend(); ++it) {
+        const CycleOp& op = *it;
+        if (op.code == OP_STORE) {
+            if (outputs & outputBit(op.dst)) live[op.a] = 1;
+            continue;
+        }
+        if (!live[op.dst] || known[op.dst]) continue;
+        if (op.a >= 0) live[op.a] = 1;
+        if (op.b >= 0) live[op.b] = 1;
+        if (op.code == OP_INPUT) columns.push_back(findInputField(op.field));
+    }
+    std::reverse(columns.begin(), columns.end());
+    auto columnOf = [&](const InputField* f) {
+        return std::find(columns.begin(), columns.end(), f) - columns.begin();
+    };
+    auto ref = [&](int r) { return known[r] ? cppDoubleLiteral(value[r]) : "r" + std::to_string(r); };
+
+    const std::string name = cppStringBody(prog.name);
+    os << "// Generated by enginer --emit-kernel from cycle '" << name << "'. Do not edit.\n"
+       << "#include <algorithm>\n#include <cmath>\n#include <cstddef>\n#include <limits>\n\n"
+       << "namespace {\n"
+       << "inline double select_pow(double base, double exp) {\n"
+       << "    double r = std::pow(std::max(base, std::numeric_limits<double>::min()), exp);\n"
+       << "    return base > 0 ? r : 0.0;\n}\n"
+       << "inline double guardDenominator(double d) {\n"
+       << "    return d <= 0 ? std::numeric_limits<double>::epsilon() : d;\n}\n"
+       << "}\n\n";
+    os << "extern \"C\" const int enginer_kernel_abi = " << kKernelAbi << ";\n"
+       << "extern \"C\" const int enginer_kernel_outputs = " << OUT_COUNT << ";\n"
+       << "extern \"C\" const unsigned enginer_kernel_output_mask = 0x" << std::hex << outputs << std::dec << "u;\n"
+       << "extern \"C\" const char* const enginer_kernel_cycle = \"" << name << "\";\n"
+       << "extern \"C\" const unsigned long long enginer_kernel_signature = 0x"
+       << std::hex << prog.signature() << std::dec << "ull;\n"
+       << "extern \"C\" const int enginer_kernel_input_count = " << columns.size() << ";\n"
+       << "extern \"C\" const char* const enginer_kernel_inputs[] = {";
+    for (const InputField* f : columns) os << "\"" << f->name << "\", ";
+    os << "nullptr};\n"
+       << "extern \"C\" const int enginer_kernel_folded_count = " << folded.size() << ";\n"
+       << "extern \"C\" const char* const enginer_kernel_folded[] = {";
+    for (const InputField* f : folded) os << "\"" << f->name << "\", ";
+    os << "nullptr};\n"
+       << "extern \"C\" const double enginer_kernel_folded_values[] = {";
+    for (const InputField* f : folded) os << cppDoubleLiteral(values.*(f->member)) << ", ";
+    os << "0.0};\n\n";
+
+    os << "extern \"C\" void enginer_kernel(const double* const* in, std::size_t n, double* const* out) {\n"
+       << "    for (std::size_t i = 0; i < n; ++i) {\n";
+    for (const CycleOp& op : prog.ops) {
+        if (op.code == OP_STORE) {
+            if (outputs & outputBit(op.dst))
+                os << "        out[" << op.dst << "][i] = " << ref(op.a) << ";   // " << kOutputNames[op.dst] << "\n";
+            continue;
+        }
+        if (!live[op.dst] || known[op.dst]) continue;
+        os << "        const double r" << op.dst << " = ";
+        switch (op.code) {
+        case OP_INPUT: {
+            const InputField* f = findInputField(op.field);
+            os << "in[" << columnOf(f) << "][i];   // " << f->name;
+            break;
+        }
+        case OP_ADD: os << ref(op.a) << " + " << ref(op.b) << ";"; break;
+        case OP_SUB: os << ref(op.a) << " - " << ref(op.b) << ";"; break;
+        case OP_MUL: os << ref(op.a) << " * " << ref(op.b) << ";"; break;
+        case OP_DIV: os << ref(op.a) << " / " << ref(op.b) << ";"; break;
+        case OP_MAX: os << "std::max(" << ref(op.a) << ", " << ref(op.b) << ");"; break;
+        case OP_SQRT: os << "std::sqrt(" << ref(op.a) << ");"; break;
+        case OP_SAFE_POW: os << "select_pow(" << ref(op.a) << ", " << ref(op.b) << ");"; break;
+        case OP_GUARD: os << "guardDenominator(" << ref(op.a) << ");"; break;
+        default: break;
+        }
+        os << "\n";
+    }
+    for (int c = 0; c < OUT_COUNT; ++c)
+        if ((outputs & outputBit(c)) && !prog.stored[c])
+            os << "        out[" << c << "][i] = std::numeric_limits<double>::quiet_NaN();\n";
+    os << "    }\n}\n";
+    return static_cast<bool>(os);
+}
+
+using KernelEntry = void (*)(const double* const* in, size_t n, double* const* out);
+
+struct KernelPlugin {
+    void* handle = nullptr;
+    KernelEntry entry = nullptr;
+    std::string cycle;
+    uint64_t signature = 0;
+    OutputMask outputs = 0;              // columns the kernel writes
+    std::vector<const InputField*> inputs;
+    std::vector<std::pair<const InputField*, double>> folded;
+};
+
+KernelPlugin g_kernel_plugin;
+
+bool loadKernelPlugin(const std::string& path, KernelPlugin& plugin) {
+    std::string file = path.find('/') == std::string::npos ? "./" + path : path;
+    void* h = dlopen(file.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!h) { std::cerr << "Error: cannot load kernel " << path << ": " << dlerror() << "\n"; return false; }
+    auto sym = [&](const char* name) { return dlsym(h, name); };
+    const int* abi = static_cast<const int*>(sym("enginer_kernel_abi"));
+    const int* outputs = static_cast<const int*>(sym("enginer_kernel_outputs"));
+    if (!abi || *abi != kKernelAbi || !outputs || *outputs != OUT_COUNT) {
+        std::cerr << "Error: " << path << " was generated for a different enginer build.\n";
+        dlclose(h);
+        return false;
+    }
+    plugin.handle = h;
+    plugin.entry = reinterpret_cast<KernelEntry>(sym("enginer_kernel"));
+    plugin.cycle = *static_cast<const char* const*>(sym("enginer_kernel_cycle"));
+    plugin.signature = *static_cast<const unsigned long long*>(sym("enginer_kernel_signature"));
+    const unsigned* outputMask = static_cast<const unsigned*>(sym("enginer_kernel_output_mask"));
+    const char* const* inputs = static_cast<const char* const*>(sym("enginer_kernel_inputs"));
+    const char* const* folded = static_cast<const char* const*>(sym("enginer_kernel_folded"));
+    const double* values = static_cast<const double*>(sym("enginer_kernel_folded_values"));
+    if (!plugin.entry || !inputs || !folded || !values || !outputMask) {
+        std::cerr << "Error: " << path << " is missing kernel symbols.\n";
+        return false;
+    }
+    plugin.outputs = *outputMask;
+    for (; *inputs; ++inputs) plugin.inputs.push_back(findInputField(*inputs));
+    for (size_t i = 0; folded[i]; ++i) plugin.folded.push_back({findInputField(folded[i]), values[i]});
+    for (const InputField* f : plugin.inputs)
+        if (!f) { std::cerr << "Error: " << path << " reads an unknown input.\n"; return false; }
+    for (const auto& f : plugin.folded)
+        if (!f.first) { std::cerr << "Error: " << path << " folds an unknown input.\n"; return false; }
+    return true;
+}
+
+// The folded values are part of the kernel, so refuse inputs that differ from them.
+bool checkKernelFolds(const KernelPlugin& plugin, const EngineInputs& in,
+                      const std::vector<const InputField*>& varying) {
+    for (const auto& f : plugin.folded) {
+        if (std::find(varying.begin(), varying.end(), f.first) != varying.end()) {
+            std::cerr << "Error: kernel folds " << f.first->name << "; it cannot be swept.\n";
+            return false;
+        }
+        if (in.*(f.first->member) != f.second) {
+            std::cerr << "Error: kernel folds " << f.first->name << "=" << f.second
+                      << " but the inputs have " << in.*(f.first->member) << ".\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// The projection is part of the kernel too: it can only serve outputs it writes.
+bool checkKernelOutputs(const KernelPlugin& plugin, OutputMask outputs) {
+    for (int c = 0; c < OUT_COUNT; ++c)
+        if ((outputs & outputBit(c)) && !(plugin.outputs & outputBit(c))) {
+            std::cerr << "Error: kernel was generated without output " << kOutputNames[c]
+                      << "; regenerate it with --outputs.\n";
+            return false;
+        }
+    return true;
+}
+
+// Columns the kernel writes but the caller did not select go to scratch.
+void kernelPluginBatch(const EngineInputs* in, size_t n, double* const out[OUT_COUNT], OutputMask mask) {
+    const size_t ncol = g_kernel_plugin.inputs.size();
+    thread_local std::vector<double> soa;
+    thread_local std::vector<const double*> cols;
+    thread_local std::vector<double> scratch(kBatchSize);
+    soa.resize(ncol * kBatchSize);
+    cols.resize(ncol);
+    double* dst[OUT_COUNT];
+    for (size_t first = 0; first < n; first += kBatchSize) {
+        const size_t m = std::min(kBatchSize, n - first);
+        for (size_t k = 0; k < ncol; ++k) {
+            double EngineInputs::* member = g_kernel_plugin.inputs[k]->member;
+            double* col = soa.data() + k * kBatchSize;
+            for (size_t j = 0; j < m; ++j) col[j] = in[first + j].*member;
+            cols[k] = col;
+        }
+        for (int c = 0; c < OUT_COUNT; ++c)
+            dst[c] = (mask & outputBit(c)) ? out[c] + first
+                   : (g_kernel_plugin.outputs & outputBit(c)) ? scratch.data() : nullptr;
+        g_kernel_plugin.entry(cols.data(), m, dst);
+    }
+}
+
+template<bool Emit>
+BatchKernel cycleKernelFor(EngineType engine) {
+    switch (engine) {
+    case ENGINE_TURBOJET: return turbojetBatch<Emit>;
+    case ENGINE_TURBOFAN: return turbofanBatch<Emit>;
+    case ENGINE_TWO_SPOOL: return twoSpoolBatch<Emit>;
+    case ENGINE_TURBOPROP: return turbopropBatch<Emit>;
+    case ENGINE_TURBOSHAFT: return turboshaftBatch<Emit>;
+    case ENGINE_ICR: return icrTurbofanBatch<Emit>;
+    case ENGINE_VARIABLE: return variableCycleBatch<Emit>;
+    case ENGINE_PROGRAM: return cycleProgramBatch;
+    case ENGINE_PLUGIN: return kernelPluginBatch;
+    }
+    return turbojetBatch<Emit>;
+}
+
+// Cycle programs and plugins leave the emission columns NaN.
+BatchKernel batchKernelFor(EngineType engine) {
+    return g_emissions ? cycleKernelFor<true>(engine) : cycleKernelFor<false>(engine);
+}
+
+// ==========================================================
+// Parameter Sweeps
+// ==========================================================
+
+struct SweepAxis {
+    const InputField* field;
+    double lo, hi;
+    uint64_t count;   // grid points along this axis (unused for Monte Carlo)
+};
+
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Counter-based uniform in [0,1): the sample for a point depends only on
+// (seed, point, axis), so any chunk can be regenerated on resume.
+inline double counterUniform(uint64_t seed, uint64_t index, uint64_t stream) {
+    uint64_t h = splitmix64(seed ^ splitmix64(index * 0x9E3779B97F4A7C15ull + stream));
+    return static_cast<double>(h >> 11) * 0x1.0p-53;
+}
+
+struct SweepSpec {
+    EngineType engine = ENGINE_TURBOJET;
+    EngineInputs base{};
+    std::vector<SweepAxis> axes;
+    bool monteCarlo = false;
+    uint64_t samples = 0;
+    uint64_t seed = 1;
+    uint64_t chunkSize = 4096;
+    OutputMask outputs = kAllOutputs;
+
+    uint64_t pointCount() const {
+        if (monteCarlo) return samples;
+        uint64_t n = 1;
+        for (const SweepAxis& a : axes) n *= a.count;
+        return n;
+    }
+
+    uint64_t chunkCount() const { return (pointCount() + chunkSize - 1) / chunkSize; }
+
+    // Grid points are laid out with the last axis varying fastest.
+    EngineInputs pointInputs(uint64_t index) const {
+        EngineInputs in = base;
+        if (monteCarlo) {
+            for (size_t a = 0; a < axes.size(); ++a)
+                in.*(axes[a].field->member) =
+                    axes[a].lo + (axes[a].hi - axes[a].lo) * counterUniform(seed, index, a);
+            return in;
+        }
+        uint64_t rem = index;
+        for (size_t a = axes.size(); a-- > 0;) {
+            uint64_t k = rem % axes[a].count;
+            rem /= axes[a].count;
+            double t = axes[a].count > 1 ? static_cast<double>(k) / (axes[a].count - 1) : 0.0;
+            in.*(axes[a].field->member) = axes[a].lo + (axes[a].hi - axes[a].lo) * t;
+        }
+        return in;
+    }
+
+    // Identifies the sweep so --resume refuses to mix results from a different spec.
+    // Outside --reproducible the bytes also depend on the ISA level and on
+    // --scalar (`scalar`), so those are part of the spec too.
+    uint64_t signature(bool scalar) const {
+        uint64_t h = 0xCBF29CE484222325ull;
+        h = fnv1a(h, &engine, sizeof(engine));
+        h = fnv1a(h, &base, sizeof(base));
+        for (const SweepAxis& a : axes) {
+            h = fnv1a(h, a.field->name, std::strlen(a.field->name));
+            h = fnv1a(h, &a.lo, sizeof(a.lo));
+            h = fnv1a(h, &a.hi, sizeof(a.hi));
+            h = fnv1a(h, &a.count, sizeof(a.count));
+        }
+        h = fnv1a(h, &monteCarlo, sizeof(monteCarlo));
+        h = fnv1a(h, &samples, sizeof(samples));
+        h = fnv1a(h, &seed, sizeof(seed));
+        h = fnv1a(h, &chunkSize, sizeof(chunkSize));
+        h = fnv1a(h, &outputs, sizeof(outputs));
+        h = fnv1a(h, &g_equilibrium_signature, sizeof(g_equilibrium_signature));
+        h = fnv1a(h, &g_emissions, sizeof(g_emissions));
+        h = fnv1a(h, &g_reproducible, sizeof(g_reproducible));
+        if (!g_reproducible) {
+            h = fnv1a(h, &g_isa, sizeof(g_isa));
+            h = fnv1a(h, &scalar, sizeof(scalar));
+        }
+        if (engine == ENGINE_PROGRAM || engine == ENGINE_PLUGIN) {
+            uint64_t program = engine == ENGINE_PROGRAM ? g_cycle_program.signature()
+                                                        : g_kernel_plugin.signature;
+            h = fnv1a(h, &program, sizeof(program));
+        }
+        return h;
+    }
+};
+
+void evaluateSweepPoint(EngineType engine, const EngineInputs& in, double out[OUT_COUNT]) {
+    applyGlobalInputs(in);
+    if (engine == ENGINE_TURBOJET) {
+        Turbojet jet; jet.runFullAnalysis(); jet.collectOutputs(out);
+    } else if (engine == ENGINE_TWO_SPOOL) {
+        TwoSpoolTurbofan fan; fan.runFullAnalysis(); fan.collectOutputs(out);
+    } else if (engine == ENGINE_TURBOPROP || engine == ENGINE_TURBOSHAFT) {
+        Turboprop prop(engine == ENGINE_TURBOPROP); prop.runFullAnalysis(); prop.collectOutputs(out);
+    } else if (engine == ENGINE_ICR) {
+        IcrTurbofan fan; fan.runFullAnalysis(); fan.collectOutputs(out);
+    } else if (engine == ENGINE_VARIABLE) {
+        VariableCycleEngine vce; vce.runFullAnalysis(); vce.collectOutputs(out);
+    } else {
+        Turbofan fan; fan.runFullAnalysis(); fan.collectOutputs(out);
+    }
+}
+
+// ==========================================================
+// Streaming Reducers
+// ==========================================================
+// --reduce folds every batch into small per-thread partials while the sweep
+// runs. Three kinds exist: argmin/argmax (optionally one per value of a grid
+// axis), top/bottom k, and fixed-bin histograms. The partials are merged
+// once at the end. Memory does not grow with the point count, and without
+// --out or --csv no results are stored at all. Ties go to the lower point
+// index, so the merged result does not depend on the thread count.
+//
+// mean:COL sums in floating point, so its last bits follow the merge order.
+// Each batch is summed pairwise and batches fold into a per-chunk partial in
+// point order. Chunks then fold in the order threads finish them, or with
+// --reproducible, in a fixed pairwise tree over the chunk index once the
+// sweep is done: the same bits for any thread count.
+enum ReducerKind { REDUCE_MIN, REDUCE_MAX, REDUCE_TOP, REDUCE_BOTTOM, REDUCE_HIST, REDUCE_MEAN };
+
+struct ReducerSpec {
+    std::string text;                // as given, for the report
+    ReducerKind kind = REDUCE_MIN;
+    int column = 0;
+    std::string byName;              // min/max: one result per value of this grid axis
+    uint64_t byStride = 1, byCount = 1;
+    size_t k = 1;                    // top/bottom
+    double lo = 0.0, hi = 1.0;       // hist
+    size_t bins = 0;
+
+    bool prefersLow() const { return kind == REDUCE_MIN || kind == REDUCE_BOTTOM; }
+};
+
+struct ReducerCandidate {
+    double value;
+    uint64_t index;                  // UINT64_MAX: empty slot
+};
+
+// Count, mean and sum of squared deviations of the finite values folded in.
+struct Moments {
+    uint64_t n = 0;
+    double mean = 0.0, m2 = 0.0;
+};
+
+// Chan, Golub and LeVeque's update for two disjoint sets.
+inline Moments mergeMoments(const Moments& a, const Moments& b) {
+    if (a.n == 0) return b;
+    if (b.n == 0) return a;
+    Moments r;
+    r.n = a.n + b.n;
+    const double delta = b.mean - a.mean;
+    const double share = static_cast<double>(b.n) / static_cast<double>(r.n);
+    r.mean = a.mean + delta * share;
+    r.m2 = a.m2 + b.m2 + delta * delta * static_cast<double>(a.n) * share;
+    return r;
+}
+
+// Fixed-order pairwise sum; the error grows with log n rather than n.
+inline double pairwiseSum(const double* x, size_t n) {
+    if (n <= 8) {
+        double s = 0.0;
+        for (size_t i = 0; i < n; ++i) s += x[i];
+        return s;
+    }
+    const size_t half = n / 2;
+    return pairwiseSum(x, half) + pairwiseSum(x + half, n - half);
+}
+
+struct ChunkMoments {
+    uint64_t chunk;
+    Moments m;
+};
+
+// One thread's state for one reducer.
+struct ReducerPartial {
+    std::vector<ReducerCandidate> best;  // min/max: one per bucket; top/bottom: heap with the worst on top
+    std::vector<uint64_t> counts;        // hist: bins, then underflow and overflow
+    uint64_t points = 0, nonFinite = 0;
+    Moments moments;                     // mean: chunks folded so far
+    Moments chunk;                       // mean: the chunk being evaluated
+    std::vector<ChunkMoments> chunks;    // mean with --reproducible: every chunk, merged at the end
+};
+
+inline bool ranksBefore(const ReducerSpec& r, const ReducerCandidate& a, const ReducerCandidate& b) {
+    if (b.index == UINT64_MAX) return a.index != UINT64_MAX;
+    if (a.value != b.value) return r.prefersLow() ? a.value < b.value : a.value > b.value;
+    return a.index < b.index;
+}
+
+OutputMask reducerOutputs(const std::vector<ReducerSpec>& reducers) {
+    OutputMask mask = 0;
+    for (const ReducerSpec& r : reducers) mask |= outputBit(r.column);
+    return mask;
+}
+
+// min|max:COL[@AXIS], top|bottom:K:COL, hist:COL:LO:HI:BINS, mean:COL
+bool parseReducer(const std::string& text, ReducerSpec& r) {
+    std::vector<std::string> f;
+    std::stringstream ss(text);
+    for (std::string tok; std::getline(ss, tok, ':');) f.push_back(tok);
+    r.text = text;
+    auto column = [&](std::string name) {
+        size_t at = name.find('@');
+        if (at != std::string::npos) {
+            r.byName = name.substr(at + 1);
+            name = name.substr(0, at);
+        }
+        r.column = findOutputColumn(name);
+        return r.column >= 0;
+    };
+    bool ok = false;
+    if (f.size() == 2 && (f[0] == "min" || f[0] == "max")) {
+        r.kind = f[0] == "min" ? REDUCE_MIN : REDUCE_MAX;
+        ok = column(f[1]);
+    } else if (f.size() == 3 && (f[0] == "top" || f[0] == "bottom")) {
+        r.kind = f[0] == "top" ? REDUCE_TOP : REDUCE_BOTTOM;
+        r.k = std::strtoull(f[1].c_str(), nullptr, 10);
+        ok = r.k > 0 && column(f[2]) && r.byName.empty();
+    } else if (f.size() == 5 && f[0] == "hist") {
+        r.kind = REDUCE_HIST;
+        r.lo = std::atof(f[2].c_str());
+        r.hi = std::atof(f[3].c_str());
+        r.bins = static_cast<size_t>(std::max(0, std::atoi(f[4].c_str())));
+        ok = column(f[1]) && r.byName.empty() && r.bins > 0 && r.hi > r.lo;
+    } else if (f.size() == 2 && f[0] == "mean") {
+        r.kind = REDUCE_MEAN;
+        ok = column(f[1]) && r.byName.empty();
+    }
+    if (!ok)
+        std::cerr << "Error: bad --reduce " << text
+                  << " (min|max:COL[@AXIS], top|bottom:K:COL, hist:COL:LO:HI:BINS, mean:COL)\n";
+    return ok;
+}
+
+// Resolves @AXIS against the sweep: the bucket of a point is its grid index on that axis.
+bool bindReducers(std::vector<ReducerSpec>& reducers, const SweepSpec& spec) {
+    for (ReducerSpec& r : reducers) {
+        if (r.byName.empty()) continue;
+        size_t a = 0;
+        while (a < spec.axes.size() && r.byName != spec.axes[a].field->name) ++a;
+        if (a == spec.axes.size() || spec.monteCarlo) {
+            std::cerr << "Error: --reduce " << r.text << " needs " << r.byName << " as a grid --axis.\n";
+            return false;
+        }
+        r.byStride = 1;
+        for (size_t b = a + 1; b < spec.axes.size(); ++b) r.byStride *= spec.axes[b].count;
+        r.byCount = spec.axes[a].count;
+    }
+    return true;
+}
+
+std::vector<ReducerPartial> startReducers(const std::vector<ReducerSpec>& reducers) {
+    std::vector<ReducerPartial> partials(reducers.size());
+    for (size_t i = 0; i < reducers.size(); ++i) {
+        const ReducerSpec& r = reducers[i];
+        if (r.kind == REDUCE_MIN || r.kind == REDUCE_MAX)
+            partials[i].best.assign(r.byCount, {std::numeric_limits<double>::quiet_NaN(), UINT64_MAX});
+        if (r.kind == REDUCE_HIST) partials[i].counts.assign(r.bins + 2, 0);
+    }
+    return partials;
+}
+
+void offerCandidate(const ReducerSpec& r, std::vector<ReducerCandidate>& heap, const ReducerCandidate& c) {
+    auto before = [&](const ReducerCandidate& a, const ReducerCandidate& b) { return ranksBefore(r, a, b); };
+    if (heap.size() < r.k) {
+        heap.push_back(c);
+        std::push_heap(heap.begin(), heap.end(), before);
+    } else if (before(c, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), before);
+        heap.back() = c;
+        std::push_heap(heap.begin(), heap.end(), before);
+    }
+}
+
+// Folds points first..first+n-1 of column `col` into the partial.
+void reduceBatch(const ReducerSpec& r, ReducerPartial& p, uint64_t first, size_t n, const double* col) {
+    p.points += n;
+    switch (r.kind) {
+    case REDUCE_MIN:
+    case REDUCE_MAX:
+        for (size_t j = 0; j < n; ++j) {
+            if (!std::isfinite(col[j])) { ++p.nonFinite; continue; }
+            const ReducerCandidate c{col[j], first + j};
+            ReducerCandidate& b = p.best[(c.index / r.byStride) % r.byCount];
+            if (ranksBefore(r, c, b)) b = c;
+        }
+        break;
+    case REDUCE_TOP:
+    case REDUCE_BOTTOM:
+        for (size_t j = 0; j < n; ++j) {
+            if (!std::isfinite(col[j])) { ++p.nonFinite; continue; }
+            offerCandidate(r, p.best, {col[j], first + j});
+        }
+        break;
+    case REDUCE_HIST: {
+        const double scale = r.bins / (r.hi - r.lo);
+        for (size_t j = 0; j < n; ++j) {
+            if (!std::isfinite(col[j])) { ++p.nonFinite; continue; }
+            const double t = (col[j] - r.lo) * scale;
+            ++p.counts[t < 0.0 ? r.bins : t >= r.bins ? r.bins + 1 : static_cast<size_t>(t)];
+        }
+        break;
+    }
+    case REDUCE_MEAN: {
+        // Two passes over the batch: pairwise mean, then pairwise squared deviations.
+        thread_local std::vector<double> finite;
+        finite.clear();
+        for (size_t j = 0; j < n; ++j) {
+            if (std::isfinite(col[j])) finite.push_back(col[j]);
+            else ++p.nonFinite;
+        }
+        if (finite.empty()) break;
+        Moments m;
+        m.n = finite.size();
+        m.mean = pairwiseSum(finite.data(), finite.size()) / static_cast<double>(m.n);
+        for (double& v : finite) v = (v - m.mean) * (v - m.mean);
+        m.m2 = pairwiseSum(finite.data(), finite.size());
+        p.chunk = mergeMoments(p.chunk, m);
+        break;
+    }
+    }
+}
+
+// Ends a chunk: mean partials fold it in now, or keep it for the chunk-index
+// tree under --reproducible.
+void closeReducerChunk(const ReducerSpec& r, ReducerPartial& p, uint64_t chunk) {
+    if (r.kind != REDUCE_MEAN) return;
+    if (g_reproducible) p.chunks.push_back({chunk, p.chunk});
+    else p.moments = mergeMoments(p.moments, p.chunk);
+    p.chunk = Moments();
+}
+
+Moments mergeChunkRange(const std::vector<ChunkMoments>& chunks, size_t lo, size_t hi) {
+    if (hi - lo == 1) return chunks[lo].m;
+    const size_t mid = lo + (hi - lo) / 2;
+    return mergeMoments(mergeChunkRange(chunks, lo, mid), mergeChunkRange(chunks, mid, hi));
+}
+
+void mergeReducer(const ReducerSpec& r, ReducerPartial& into, const ReducerPartial& from) {
+    into.points += from.points;
+    into.nonFinite += from.nonFinite;
+    if (r.kind == REDUCE_MIN || r.kind == REDUCE_MAX) {
+        for (size_t b = 0; b < into.best.size(); ++b)
+            if (ranksBefore(r, from.best[b], into.best[b])) into.best[b] = from.best[b];
+    } else if (r.kind == REDUCE_HIST) {
+        for (size_t b = 0; b < into.counts.size(); ++b) into.counts[b] += from.counts[b];
+    } else if (r.kind == REDUCE_MEAN) {
+        into.moments = mergeMoments(into.moments, from.moments);
+        into.chunks.insert(into.chunks.end(), from.chunks.begin(), from.chunks.end());
+    } else {
+        for (const ReducerCandidate& c : from.best) offerCandidate(r, into.best, c);
+    }
+}
+
+// One CSV block per reducer, headed by a '#' summary line.
+void printReducer(std::ostream& os, const ReducerSpec& r, ReducerPartial p, const SweepSpec& spec) {
+    os << "# " << r.text << ": " << p.points << " points, " << p.nonFinite << " non-finite\n"
+       << std::setprecision(10);
+    if (r.kind == REDUCE_HIST) {
+        os << "lo,hi,count\n";
+        const double width = (r.hi - r.lo) / r.bins;
+        for (size_t b = 0; b < r.bins; ++b)
+            os << r.lo + width * b << "," << r.lo + width * (b + 1) << "," << p.counts[b] << "\n";
+        os << "-inf," << r.lo << "," << p.counts[r.bins] << "\n"
+           << r.hi << ",inf," << p.counts[r.bins + 1] << "\n\n";
+        return;
+    }
+    if (r.kind == REDUCE_MEAN) {
+        Moments m = p.moments;
+        if (!p.chunks.empty()) {
+            std::sort(p.chunks.begin(), p.chunks.end(),
+                      [](const ChunkMoments& a, const ChunkMoments& b) { return a.chunk < b.chunk; });
+            m = mergeChunkRange(p.chunks, 0, p.chunks.size());
+        }
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        os << std::setprecision(17) << "count,mean,stddev\n" << m.n << "," << (m.n ? m.mean : nan) << ","
+           << (m.n > 1 ? std::sqrt(m.m2 / static_cast<double>(m.n - 1)) : nan) << "\n\n";
+        return;
+    }
+    if (r.kind == REDUCE_TOP || r.kind == REDUCE_BOTTOM)
+        std::sort(p.best.begin(), p.best.end(),
+                  [&](const ReducerCandidate& a, const ReducerCandidate& b) { return ranksBefore(r, a, b); });
+    os << "index";
+    for (const SweepAxis& a : spec.axes) os << "," << a.field->name;
+    os << "," << kOutputNames[r.column] << "\n";
+    for (const ReducerCandidate& c : p.best) {
+        if (c.index == UINT64_MAX) continue;
+        EngineInputs in = spec.pointInputs(c.index);
+        os << c.index;
+        for (const SweepAxis& a : spec.axes) os << "," << in.*(a.field->member);
+        os << "," << c.value << "\n";
+    }
+    os << "\n";
+}
+
+// ==========================================================
+// Sweep Result Storage & Checkpoints
+// ==========================================================
+// Result file: fixed header followed by one column of `points` doubles per
+// selected output, in column order. Every point has a precomputed offset, so
+// chunks can be written in any order and a resumed run only fills the holes.
+struct SweepFileHeader {
+    char magic[8];
+    uint64_t signature;
+    uint64_t points;
+    uint64_t columns;
+    uint64_t outputs;               // OutputMask of the stored columns
+    uint64_t reserved[3];
+};
+const char kSweepMagic[8] = {'E', 'N', 'G', 'S', 'W', 'P', '0', '1'};
+const char kCheckpointMagic[8] = {'E', 'N', 'G', 'C', 'K', 'P', '0', '1'};
+
+struct SweepResults {
+    int fd = -1;
+    void* map = nullptr;
+    size_t mapBytes = 0;
+    uint64_t points = 0;
+    OutputMask outputs = kAllOutputs;
+    int slot[OUT_COUNT] = {};       // position of each stored column, -1 if not stored
+
+    void layout(OutputMask mask) {
+        outputs = mask;
+        int n = 0;
+        for (int c = 0; c < OUT_COUNT; ++c) slot[c] = (mask & outputBit(c)) ? n++ : -1;
+    }
+
+    // Null for a column outside the projection.
+    double* column(int c) const {
+        if (slot[c] < 0) return nullptr;
+        char* data = static_cast<char*>(map) + sizeof(SweepFileHeader);
+        return reinterpret_cast<double*>(data) + static_cast<size_t>(slot[c]) * points;
+    }
+};
+
+// A new or renamed file only survives a crash once its directory entry is
+// synced too.
+bool syncParentDir(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// The selected word of a transparent huge page setting, e.g. "madvise" from
+// "always [madvise] never"; empty when the file cannot be read.
+std::string thpSetting(const char* name) {
+    std::ifstream f(std::string("/sys/kernel/mm/transparent_hugepage/") + name);
+    std::string word;
+    while (f >> word)
+        if (word.size() > 2 && word.front() == '[' && word.back() == ']') return word.substr(1, word.size() - 2);
+    return std::string();
+}
+
+// Maps the result file, or anonymous memory when path is empty: private for
+// threads, shared only when forked workers (`shared`) write into it, since
+// shmem gets huge pages only if shmem_enabled allows them.
+// `stored` is usually spec.outputs; a reduce-only sweep stores nothing.
+bool openSweepResults(const std::string& path, const SweepSpec& spec, OutputMask stored, uint64_t signature,
+                      bool resume, bool shared, bool hugePages, SweepResults& res) {
+    res.points = spec.pointCount();
+    res.layout(stored);
+    res.mapBytes = sizeof(SweepFileHeader) + res.points * outputCount(stored) * sizeof(double);
+    if (path.empty()) {
+        res.map = mmap(nullptr, res.mapBytes, PROT_READ | PROT_WRITE,
+                       (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_ANONYMOUS, -1, 0);
+        if (res.map == MAP_FAILED) return false;
+        if (!hugePages) return true;
+        // madvise succeeds even where the setting makes it a no-op.
+        const char* knob = shared ? "shmem_enabled" : "enabled";
+        std::string setting = thpSetting(knob);
+        if (madvise(res.map, res.mapBytes, MADV_HUGEPAGE) != 0)
+            std::cerr << "Warning: transparent huge pages unavailable for results.\n";
+        else if (setting == "never" || setting == "deny")
+            std::cerr << "Warning: transparent huge pages are off for results (" << knob << " is " << setting << ").\n";
+        return true;
+    }
+    if (hugePages)
+        std::cerr << "Warning: huge pages only apply to in-memory results (no --out).\n";
+
+    res.fd = open(path.c_str(), resume ? O_RDWR : (O_RDWR | O_CREAT | O_TRUNC), 0644);
+    if (res.fd < 0) {
+        std::cerr << "Error: cannot open result file " << path << "\n";
+        return false;
+    }
+    struct stat st;
+    if (fstat(res.fd, &st) != 0) {
+        std::cerr << "Error: cannot stat result file " << path << "\n";
+        return false;
+    }
+    if (resume && static_cast<size_t>(st.st_size) != res.mapBytes) {
+        std::cerr << "Error: result file " << path << " does not match this sweep.\n";
+        return false;
+    }
+    if (!resume && ftruncate(res.fd, static_cast<off_t>(res.mapBytes)) != 0) {
+        std::cerr << "Error: cannot size result file " << path << "\n";
+        return false;
+    }
+    res.map = mmap(nullptr, res.mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, res.fd, 0);
+    if (res.map == MAP_FAILED) {
+        std::cerr << "Error: cannot map result file " << path << "\n";
+        return false;
+    }
+
+    SweepFileHeader* hdr = static_cast<SweepFileHeader*>(res.map);
+    if (resume) {
+        if (std::memcmp(hdr->magic, kSweepMagic, 8) != 0 || hdr->signature != signature) {
+            std::cerr << "Error: result file " << path << " belongs to a different sweep.\n";
+            return false;
+        }
+    } else {
+        std::memset(hdr, 0, sizeof(*hdr));
+        std::memcpy(hdr->magic, kSweepMagic, 8);
+        hdr->signature = signature;
+        hdr->points = res.points;
+        hdr->columns = static_cast<uint64_t>(outputCount(stored));
+        hdr->outputs = stored;
+        if (msync(res.map, sizeof(*hdr), MS_SYNC) != 0 || fsync(res.fd) != 0 || !syncParentDir(path)) {
+            std::cerr << "Error: cannot sync result file " << path << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+void closeSweepResults(SweepResults& res) {
+    if (res.map && res.map != MAP_FAILED) munmap(res.map, res.mapBytes);
+    if (res.fd >= 0) close(res.fd);
+    res.map = nullptr;
+    res.fd = -1;
+}
+
+// Completed-chunk bitmap, kept next to the result file as <out>.ckpt.
+// It is only ever replaced by rename(), and only after the result pages it
+// vouches for have been synced, so a crash at any point leaves a bitmap
+// that under-reports rather than over-reports progress.
+//
+// The live flags sit in a shared anonymous mapping so forked shard workers
+// report progress to the launcher without any messages.
+struct SweepCheckpoint {
+    std::string path;
+    uint64_t signature = 0;
+    uint64_t chunks = 0;
+    std::atomic<uint8_t>* done = nullptr;
+
+    bool allocate(uint64_t n) {
+        chunks = n;
+        void* p = mmap(nullptr, std::max<uint64_t>(n, 1), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return false;
+        done = static_cast<std::atomic<uint8_t>*>(p);
+        return true;
+    }
+
+    void release() {
+        if (done) munmap(done, std::max<uint64_t>(chunks, 1));
+        done = nullptr;
+    }
+
+    bool isDone(uint64_t chunk) const { return done[chunk].load(std::memory_order_acquire) != 0; }
+    void mark(uint64_t chunk) { done[chunk].store(1, std::memory_order_release); }
+
+    uint64_t countDone() const {
+        uint64_t n = 0;
+        for (uint64_t c = 0; c < chunks; ++c) n += isDone(c);
+        return n;
+    }
+
+    std::vector<uint8_t> snapshot() const {
+        std::vector<uint8_t> bits((chunks + 7) / 8, 0);
+        for (uint64_t c = 0; c < chunks; ++c)
+            if (isDone(c)) bits[c / 8] |= static_cast<uint8_t>(1u << (c % 8));
+        return bits;
+    }
+
+    bool load() {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        char magic[8];
+        uint64_t sig = 0, n = 0;
+        in.read(magic, 8);
+        in.read(reinterpret_cast<char*>(&sig), sizeof(sig));
+        in.read(reinterpret_cast<char*>(&n), sizeof(n));
+        if (!in || std::memcmp(magic, kCheckpointMagic, 8) != 0 || sig != signature || n != chunks)
+            return false;
+        std::vector<uint8_t> bits((n + 7) / 8);
+        in.read(reinterpret_cast<char*>(bits.data()), static_cast<std::streamsize>(bits.size()));
+        if (!in) return false;
+        for (uint64_t c = 0; c < n; ++c)
+            if ((bits[c / 8] >> (c % 8)) & 1) mark(c);
+        return true;
+    }
+
+    bool save(const std::vector<uint8_t>& bits) const {
+        std::string tmp = path + ".tmp";
+        int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        bool ok = write(fd, kCheckpointMagic, 8) == 8 &&
+                  write(fd, &signature, sizeof(signature)) == sizeof(signature) &&
+                  write(fd, &chunks, sizeof(chunks)) == sizeof(chunks) &&
+                  write(fd, bits.data(), bits.size()) == static_cast<ssize_t>(bits.size()) &&
+                  fsync(fd) == 0;
+        close(fd);
+        return ok && std::rename(tmp.c_str(), path.c_str()) == 0 && syncParentDir(path);
+    }
+};
+
+// Makes every finished chunk durable, then records it in the bitmap. The
+// flags are read before msync, so each chunk they list is already in the
+// page cache when the sync starts.
+bool flushCheckpoint(const SweepResults& res, const SweepCheckpoint& ckpt) {
+    if (res.fd < 0) return true;
+    TraceScope trace("checkpoint");
+    std::vector<uint8_t> bits = ckpt.snapshot();
+    {
+        TraceScope sync("msync results");
+        if (msync(res.map, res.mapBytes, MS_SYNC) != 0) return false;
+    }
+    TraceScope write("write bitmap");
+    return ckpt.save(bits);
+}
+
+struct SweepOptions {
+    std::string outPath;            // empty: keep results in memory only
+    std::string csvPath;            // empty: CSV goes to stdout when there is no result file
+    bool resume = false;
+    bool scalar = false;            // evaluate through the Turbojet/Turbofan classes
+    double checkpointSeconds = 10.0;
+    int procs = 1;                  // forked shard workers
+    int maxRestarts = 3;            // per shard
+    int threads = 1;                // pinned worker threads
+    bool pinThreads = true;
+    bool hugePages = false;         // madvise(MADV_HUGEPAGE) on in-memory results
+    std::vector<ReducerSpec> reducers;
+
+    // Reducers alone need no stored results.
+    OutputMask storedOutputs(const SweepSpec& spec) const {
+        return reducers.empty() || !outPath.empty() || !csvPath.empty() ? spec.outputs : 0;
+    }
+};
+
+void writeSweepCsv(std::ostream& os, const SweepSpec& spec, const SweepResults& res) {
+    std::vector<const double*> cols;
+    for (const SweepAxis& a : spec.axes) os << a.field->name << ",";
+    for (int c = 0; c < OUT_COUNT; ++c) {
+        if (!res.column(c)) continue;
+        os << (cols.empty() ? "" : ",") << kOutputNames[c];
+        cols.push_back(res.column(c));
+    }
+    os << "\n" << std::setprecision(10);
+    for (uint64_t i = 0; i < res.points; ++i) {
+        EngineInputs in = spec.pointInputs(i);
+        for (const SweepAxis& a : spec.axes) os << in.*(a.field->member) << ",";
+        for (size_t k = 0; k < cols.size(); ++k) os << cols[k][i] << (k + 1 < cols.size() ? "," : "\n");
+    }
+}
+
+// `reduce` holds this thread's partials, one per opt.reducers entry. Reduced
+// columns that are not stored are computed into a per-thread scratch block.
+void evaluateSweepChunk(const SweepSpec& spec, const SweepOptions& opt,
+                        const SweepResults& res, uint64_t chunk, ReducerPartial* reduce = nullptr) {
+    TraceScope trace("chunk", "chunk", chunk);
+    uint64_t first = chunk * spec.chunkSize;
+    uint64_t last = std::min(first + spec.chunkSize, res.points);
+    BatchKernel kernel = batchKernelFor(spec.engine);
+    const OutputMask mask = res.outputs | reducerOutputs(opt.reducers);
+    thread_local std::vector<double> scratch;
+    scratch.resize(OUT_COUNT * kBatchSize);
+    EngineInputs block[kBatchSize];
+    double* cols[OUT_COUNT];
+    double out[OUT_COUNT];
+
+    for (uint64_t b = first; b < last; b += kBatchSize) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(kBatchSize, last - b));
+        TraceScope batch("batch", "points", n);
+        for (size_t j = 0; j < n; ++j) block[j] = spec.pointInputs(b + j);
+        for (int c = 0; c < OUT_COUNT; ++c)
+            cols[c] = res.column(c) ? res.column(c) + b
+                    : (mask & outputBit(c)) ? scratch.data() + c * kBatchSize : nullptr;
+        if (!opt.scalar) {
+            kernel(block, n, cols, mask);
+        } else {
+            for (size_t j = 0; j < n; ++j) {
+                evaluateSweepPoint(spec.engine, block[j], out);
+                for (int c = 0; c < OUT_COUNT; ++c)
+                    if (cols[c]) cols[c][j] = out[c];
+            }
+        }
+        for (size_t r = 0; reduce && r < opt.reducers.size(); ++r)
+            reduceBatch(opt.reducers[r], reduce[r], b, n, cols[opt.reducers[r].column]);
+    }
+    for (size_t r = 0; reduce && r < opt.reducers.size(); ++r) closeReducerChunk(opt.reducers[r], reduce[r], chunk);
+}
+
+// ==========================================================
+// Multi-Process Sharded Sweeps
+// ==========================================================
+// Each worker owns a contiguous chunk range and writes into the shared result
+// mapping at the chunks' fixed offsets, so there is nothing to merge. A worker
+// that dies (signal or non-zero exit) is forked again over the same range and
+// picks up from the first chunk it had not flagged done.
+struct SweepShard {
+    uint64_t firstChunk, lastChunk;
+    pid_t pid = -1;
+    int restarts = 0;
+};
+
+bool launchSweepShard(const SweepSpec& spec, const SweepOptions& opt, const SweepResults& res,
+                      SweepCheckpoint& ckpt, SweepShard& shard) {
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        resetTraceAfterFork();
+        traceThreadName("shard worker, chunks " + std::to_string(shard.firstChunk) + "-" +
+                        std::to_string(shard.lastChunk - 1));
+        for (uint64_t c = shard.firstChunk; c < shard.lastChunk; ++c) {
+            if (ckpt.isDone(c)) continue;
+            evaluateSweepChunk(spec, opt, res, c);
+            ckpt.mark(c);
+        }
+        writeTraceFragment();
+        _exit(0);
+    }
+    shard.pid = pid;
+    if (g_trace_enabled) g_trace_children.push_back(pid);
+    return true;
+}
+
+bool runSweepProcesses(const SweepSpec& spec, const SweepOptions& opt,
+                       const SweepResults& res, SweepCheckpoint& ckpt) {
+    using namespace std;
+    using Clock = chrono::steady_clock;
+    vector<SweepShard> shards(opt.procs);
+    int live = 0;
+    for (int w = 0; w < opt.procs; ++w) {
+        shards[w].firstChunk = ckpt.chunks * w / opt.procs;
+        shards[w].lastChunk = ckpt.chunks * (w + 1) / opt.procs;
+        if (shards[w].firstChunk == shards[w].lastChunk) continue;
+        if (!launchSweepShard(spec, opt, res, ckpt, shards[w])) {
+            cerr << "Error: fork failed for shard " << w << "\n";
+            return false;
+        }
+        ++live;
+    }
+
+    bool ok = true;
+    Clock::time_point lastCheckpoint = Clock::now();
+    while (live > 0) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid == 0) {
+            usleep(20000);
+            Clock::time_point now = Clock::now();
+            if (chrono::duration<double>(now - lastCheckpoint).count() >= opt.checkpointSeconds) {
+                if (!flushCheckpoint(res, ckpt)) cerr << "Warning: checkpoint write failed.\n";
+                lastCheckpoint = now;
+            }
+            continue;
+        }
+        if (pid < 0) break;
+
+        int w = 0;
+        while (w < opt.procs && shards[w].pid != pid) ++w;
+        if (w == opt.procs) continue;
+        --live;
+        shards[w].pid = -1;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+
+        SweepShard& s = shards[w];
+        cerr << "Warning: shard " << w << " (chunks " << s.firstChunk << "-" << s.lastChunk - 1 << ") ";
+        if (WIFSIGNALED(status)) cerr << "killed by signal " << WTERMSIG(status);
+        else cerr << "exited with status " << WEXITSTATUS(status);
+        if (s.restarts < opt.maxRestarts && launchSweepShard(spec, opt, res, ckpt, s)) {
+            ++s.restarts;
+            ++live;
+            cerr << "; restart " << s.restarts << " of " << opt.maxRestarts << "\n";
+        } else {
+            cerr << "; giving up\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// ==========================================================
+// NUMA Topology & Threaded Sweeps
+// ==========================================================
+// Worker threads are spread across NUMA nodes and pinned. Each worker owns a
+// contiguous chunk range whose result pages it touches first, so the kernel
+// places that slab on the worker's node; idle workers then steal chunks,
+// preferring workers on their own node.
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+std::vector<int> parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream ss(text);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        int lo = 0, hi = 0;
+        int got = sscanf(part.c_str(), "%d-%d", &lo, &hi);
+        if (got < 1) continue;
+        if (got == 1) hi = lo;
+        for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+    }
+    return cpus;
+}
+
+std::vector<NumaNode> discoverNumaTopology() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    std::vector<NumaNode> nodes;
+    if (DIR* dir = opendir("/sys/devices/system/node")) {
+        while (dirent* e = readdir(dir)) {
+            int id = 0;
+            if (sscanf(e->d_name, "node%d", &id) != 1) continue;
+            std::ifstream f(std::string("/sys/devices/system/node/") + e->d_name + "/cpulist");
+            std::string list;
+            std::getline(f, list);
+            NumaNode node{id, {}};
+            for (int c : parseCpuList(list))
+                if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) node.cpus.push_back(c);
+            if (!node.cpus.empty()) nodes.push_back(node);   // skip memory-only nodes
+        }
+        closedir(dir);
+    }
+    if (nodes.empty()) {
+        NumaNode node{0, {}};
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &allowed)) node.cpus.push_back(c);
+        nodes.push_back(node);
+    }
+    std::sort(nodes.begin(), nodes.end(),
+              [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    return nodes;
+}
+
+bool pinCurrentThread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+struct alignas(64) SweepWorker {
+    int cpu = -1;
+    int node = 0;
+    uint64_t firstChunk = 0, lastChunk = 0;
+    std::atomic<uint64_t> next{0};
+    uint64_t stolen = 0;
+};
+
+// Faults in this worker's share of every result column from the worker's own
+// thread. No page changes: a thief may already have stored a stolen chunk
+// there, and a resumed sweep keeps the chunks it already has. File pages are
+// read. In-memory pages take an atomic or of zero, since a read fault on
+// private memory only maps the zero page and leaves placement to whichever
+// thread stores first.
+void firstTouchSlab(const SweepSpec& spec, const SweepResults& res,
+                    uint64_t firstChunk, uint64_t lastChunk) {
+    uint64_t first = std::min(firstChunk * spec.chunkSize, res.points);
+    uint64_t last = std::min(lastChunk * spec.chunkSize, res.points);
+    if (first >= last) return;
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (int c = 0; c < OUT_COUNT; ++c) {
+        if (!res.column(c)) continue;
+        char* begin = reinterpret_cast<char*>(res.column(c) + first);
+        size_t bytes = (last - first) * sizeof(double);
+        if (res.fd < 0) {
+            for (size_t off = 0; off < bytes; off += page)
+                __atomic_fetch_or(reinterpret_cast<uint64_t*>(begin + off), 0, __ATOMIC_RELAXED);
+            continue;
+        }
+        volatile char sink = 0;
+        for (size_t off = 0; off < bytes; off += page) sink = sink + begin[off];
+    }
+}
+
+bool runSweepThreads(const SweepSpec& spec, const SweepOptions& opt, const SweepResults& res,
+                     SweepCheckpoint& ckpt, std::vector<std::vector<ReducerPartial>>& partials) {
+    using namespace std;
+    using Clock = chrono::steady_clock;
+    vector<NumaNode> nodes = discoverNumaTopology();
+    const int n = opt.threads;
+
+    // Worker w goes to node w % nodes, and workers are numbered so each
+    // node's chunk ranges are adjacent; same-node steals stay close.
+    vector<SweepWorker> workers(n);
+    vector<int> order;
+    for (size_t k = 0; k < nodes.size(); ++k)
+        for (int w = static_cast<int>(k); w < n; w += static_cast<int>(nodes.size())) order.push_back(w);
+    for (int slot = 0; slot < n; ++slot) {
+        SweepWorker& wk = workers[order[slot]];
+        const NumaNode& node = nodes[order[slot] % nodes.size()];
+        wk.node = node.id;
+        wk.cpu = opt.pinThreads ? node.cpus[(order[slot] / nodes.size()) % node.cpus.size()] : -1;
+        wk.firstChunk = ckpt.chunks * slot / n;
+        wk.lastChunk = ckpt.chunks * (slot + 1) / n;
+        wk.next.store(wk.firstChunk);
+    }
+
+    atomic<int> running(n);
+    auto claim = [&](SweepWorker& from) -> uint64_t {
+        for (;;) {
+            uint64_t c = from.next.fetch_add(1, memory_order_relaxed);
+            if (c >= from.lastChunk) return UINT64_MAX;
+            if (!ckpt.isDone(c)) return c;
+        }
+    };
+    auto body = [&](int self) {
+        SweepWorker& me = workers[self];
+        if (me.cpu >= 0) pinCurrentThread(me.cpu);
+        traceThreadName("sweep worker " + std::to_string(self) + " (node " + std::to_string(me.node) +
+                        (me.cpu >= 0 ? ", cpu " + std::to_string(me.cpu) : std::string()) + ")");
+        {
+            TraceScope touch("first touch");
+            firstTouchSlab(spec, res, me.firstChunk, me.lastChunk);
+        }
+        for (uint64_t c; (c = claim(me)) != UINT64_MAX;) {
+            evaluateSweepChunk(spec, opt, res, c, partials[self].data());
+            ckpt.mark(c);
+        }
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int v = 0; v < n; ++v) {
+                if (v == self || (workers[v].node == me.node) != (pass == 0)) continue;
+                for (uint64_t c; (c = claim(workers[v])) != UINT64_MAX;) {
+                    traceInstant("steal", "victim", static_cast<uint64_t>(v));
+                    evaluateSweepChunk(spec, opt, res, c, partials[self].data());
+                    ckpt.mark(c);
+                    ++me.stolen;
+                }
+            }
+        }
+        running.fetch_sub(1, memory_order_release);
+    };
+
+    vector<thread> threads;
+    for (int w = 0; w < n; ++w) threads.emplace_back(body, w);
+    Clock::time_point lastCheckpoint = Clock::now();
+    while (running.load(memory_order_acquire) > 0) {
+        this_thread::sleep_for(chrono::milliseconds(20));
+        Clock::time_point now = Clock::now();
+        if (chrono::duration<double>(now - lastCheckpoint).count() >= opt.checkpointSeconds) {
+            if (!flushCheckpoint(res, ckpt)) cerr << "Warning: checkpoint write failed.\n";
+            lastCheckpoint = now;
+        }
+    }
+    for (thread& t : threads) t.join();
+
+    uint64_t stolen = 0;
+    for (const SweepWorker& w : workers) stolen += w.stolen;
+    cerr << "Threads: " << n << " on " << nodes.size() << " NUMA node(s)"
+         << (opt.pinThreads ? ", pinned" : "") << ", " << stolen << " chunks stolen\n";
+    return true;
+}
+
+int runSweep(const SweepSpec& spec, const SweepOptions& opt) {
+    using namespace std;
+    using Clock = chrono::steady_clock;
+    if (opt.resume && opt.outPath.empty()) {
+        cerr << "Error: --resume needs the --out result file of the interrupted sweep.\n";
+        return 1;
+    }
+
+    SweepResults res;
+    if (!openSweepResults(opt.outPath, spec, opt.storedOutputs(spec), spec.signature(opt.scalar), opt.resume,
+                          opt.procs > 1, opt.hugePages, res)) {
+        closeSweepResults(res);
+        return 1;
+    }
+
+    SweepCheckpoint ckpt;
+    ckpt.path = opt.outPath + ".ckpt";
+    ckpt.signature = spec.signature(opt.scalar);
+    if (!ckpt.allocate(spec.chunkCount())) {
+        cerr << "Error: cannot allocate chunk flags.\n";
+        closeSweepResults(res);
+        return 1;
+    }
+    if (opt.resume && !ckpt.load()) {
+        cerr << "Error: no usable checkpoint at " << ckpt.path << "\n";
+        ckpt.release();
+        closeSweepResults(res);
+        return 1;
+    }
+    uint64_t resumedChunks = ckpt.countDone();
+
+    bool ok = true;
+    vector<vector<ReducerPartial>> partials(max(1, opt.threads), startReducers(opt.reducers));
+    Clock::time_point start = Clock::now();
+    if (opt.procs > 1) {
+        ok = runSweepProcesses(spec, opt, res, ckpt);
+    } else if (opt.threads > 1) {
+        ok = runSweepThreads(spec, opt, res, ckpt, partials);
+    } else {
+        Clock::time_point lastCheckpoint = start;
+        for (uint64_t chunk = 0; chunk < ckpt.chunks; ++chunk) {
+            if (ckpt.isDone(chunk)) continue;
+            evaluateSweepChunk(spec, opt, res, chunk, partials[0].data());
+            ckpt.mark(chunk);
+
+            Clock::time_point now = Clock::now();
+            if (chrono::duration<double>(now - lastCheckpoint).count() >= opt.checkpointSeconds) {
+                if (!flushCheckpoint(res, ckpt)) cerr << "Warning: checkpoint write failed.\n";
+                lastCheckpoint = now;
+            }
+        }
+    }
+    if (!flushCheckpoint(res, ckpt)) cerr << "Warning: checkpoint write failed.\n";
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    if (ok) {
+        TraceScope trace("write csv");
+        if (!opt.csvPath.empty()) {
+            ofstream csv(opt.csvPath);
+            writeSweepCsv(csv, spec, res);
+        } else if (opt.outPath.empty() && opt.reducers.empty()) {
+            writeSweepCsv(cout, spec, res);
+        }
+        for (size_t r = 0; r < opt.reducers.size(); ++r) {
+            for (size_t t = 1; t < partials.size(); ++t) mergeReducer(opt.reducers[r], partials[0][r], partials[t][r]);
+            printReducer(cout, opt.reducers[r], partials[0][r], spec);
+        }
+    }
+    cerr << "Sweep " << (ok ? "complete" : "incomplete") << ": " << res.points << " points in "
+         << ckpt.chunks << " chunks (" << resumedChunks << " resumed, " << ckpt.countDone()
+         << " done) in " << fixed << setprecision(3) << seconds << " s\n";
+    ckpt.release();
+    closeSweepResults(res);
+    return ok ? 0 : 1;
+}
+
+// ==========================================================
+// Sweep Queries
+// ==========================================================
+// --query runs a constrained design study written as one statement:
+//
+//     minimize TSFC on fan subject to specificThrust > 900
+//         over pi_c_fan in [10,40], BPR in [0.2,2], T_t4 = 1800
+//
+// The planner first probes how each queried output moves along each free
+// axis. Engines with Interval Bounds then get a branch-and-bound that needs
+// no monotonicity: each box is dropped on its guaranteed bounds. Otherwise,
+// if the objective and every constraint are monotone in every axis, each
+// box's best case sits at a known corner, and it runs an adaptive
+// branch-and-bound that bisects boxes and drops those whose best corner is
+// infeasible or cannot beat the incumbent; the probed signs are trusted, not
+// proven. Failing that, it takes a grid when the budget left after the probes
+// covers at least 16 points per axis, or a multi-start pattern search.
+// All strategies evaluate their points in blocks on the batch kernels,
+// spread over --threads.
+enum QueryStrategy { QUERY_AUTO, QUERY_GRID, QUERY_ADAPTIVE, QUERY_OPTIMIZER, QUERY_INTERVAL };
+
+const char* const kQueryStrategyNames[] = {"auto", "grid", "adaptive", "optimizer", "interval"};
+const int kQueryStrategyCount = sizeof(kQueryStrategyNames) / sizeof(kQueryStrategyNames[0]);
+
+struct QueryConstraint {
+    int column;
+    bool above;                      // column > bound, else column < bound
+    bool strict;                     // < or >: the bound itself is infeasible
+    double bound;
+
+    bool satisfiedBy(double v) const {
+        if (v == bound) return !strict;
+        return above ? v > bound : v < bound;
+    }
+    const char* op() const { return above ? (strict ? ">" : ">=") : (strict ? "<" : "<="); }
+};
+
+struct QueryAxis {
+    const InputField* field;
+    double lo, hi;
+};
+
+struct SweepQuery {
+    EngineType engine = ENGINE_TURBOJET;
+    int objective = OUT_TSFC;
+    bool maximize = false;
+    std::vector<QueryConstraint> constraints;
+    std::vector<QueryAxis> axes;
+    std::vector<std::pair<const InputField*, double>> fixed;
+    QueryStrategy strategy = QUERY_AUTO;
+    uint64_t budget = 1000000;       // point evaluations
+
+    // Value k of a point: 0 is the objective, 1.. the constraints.
+    size_t values() const { return 1 + constraints.size(); }
+    int column(size_t k) const { return k == 0 ? objective : constraints[k - 1].column; }
+    // Whether a larger value of k is better (objective) or helps feasibility.
+    bool wantsHigh(size_t k) const { return k == 0 ? maximize : constraints[k - 1].above; }
+
+    OutputMask outputs() const {
+        OutputMask mask = 0;
+        for (size_t k = 0; k < values(); ++k) mask |= outputBit(column(k));
+        return mask;
+    }
+};
+
+bool engineByName(const std::string& name, EngineType& engine) {
+    static const std::pair<const char*, EngineType> kNames[] = {
+        {"jet", ENGINE_TURBOJET}, {"fan", ENGINE_TURBOFAN}, {"fan2", ENGINE_TWO_SPOOL},
+        {"prop", ENGINE_TURBOPROP}, {"shaft", ENGINE_TURBOSHAFT}, {"icr", ENGINE_ICR},
+        {"vcycle", ENGINE_VARIABLE}, {"cycle", ENGINE_PROGRAM}, {"plugin", ENGINE_PLUGIN},
+    };
+    for (const auto& n : kNames)
+        if (name == n.first) { engine = n.second; return true; }
+    return false;
+}
+
+// Splits on whitespace; brackets, commas and comparison operators are tokens of their own.
+std::vector<std::string> tokenizeQuery(const std::string& text) {
+    std::vector<std::string> tokens;
+    std::string cur;
+    auto flush = [&] { if (!cur.empty()) tokens.push_back(cur); cur.clear(); };
+    for (size_t i = 0; i < text.size(); ++i) {
+        char ch = text[i];
+        if (std::isspace(static_cast<unsigned char>(ch))) {
+            flush();
+        } else if (ch == '[' || ch == ']' || ch == ',') {
+            flush();
+            tokens.push_back(std::string(1, ch));
+        } else if (ch == '<' || ch == '>' || ch == '=') {
+            flush();
+            if ((ch == '<' || ch == '>') && i + 1 < text.size() && text[i + 1] == '=') {
+                tokens.push_back(std::string(1, ch) + "=");
+                ++i;
+            } else {
+                tokens.push_back(std::string(1, ch));
+            }
+        } else {
+            cur += ch;
+        }
+    }
+    flush();
+    return tokens;
+}
+
+// goal [on ENGINE] [subject to COND {and COND}] over ITEM {, ITEM} [using STRATEGY] [budget N]
+//   goal := minimize|maximize OUTPUT      COND := OUTPUT <|<=|>|>= NUMBER
+//   ITEM := INPUT in [LO, HI] | INPUT = VALUE
+bool parseQuery(const std::string& text, SweepQuery& q) {
+    std::vector<std::string> t = tokenizeQuery(text);
+    size_t i = 0;
+    std::string error;
+    auto at = [&](const char* word) { return i < t.size() && t[i] == word; };
+    auto next = [&]() -> std::string { return i < t.size() ? t[i++] : std::string(); };
+    auto number = [&](double& v) {
+        std::string s = next();
+        char* end = nullptr;
+        v = std::strtod(s.c_str(), &end);
+        if (s.empty() || *end) error = "expected a number, got '" + s + "'";
+        return error.empty();
+    };
+    auto output = [&](int& c) {
+        std::string s = next();
+        c = findOutputColumn(s);
+        if (c < 0) error = "unknown output '" + s + "'";
+        return error.empty();
+    };
+
+    std::string goal = next();
+    if (goal != "minimize" && goal != "maximize") error = "a query starts with minimize or maximize";
+    q.maximize = goal == "maximize";
+    if (error.empty()) output(q.objective);
+    bool over = false;
+    while (error.empty() && i < t.size()) {
+        if (at("on")) {
+            ++i;
+            std::string name = next();
+            if (!engineByName(name, q.engine)) error = "unknown engine '" + name + "'";
+        } else if (at("subject")) {
+            ++i;
+            if (next() != "to") { error = "expected 'subject to'"; break; }
+            do {
+                QueryConstraint c{};
+                if (!output(c.column)) break;
+                std::string op = next();
+                if (op != "<" && op != "<=" && op != ">" && op != ">=") {
+                    error = "expected <, <=, > or >= after " + std::string(kOutputNames[c.column]);
+                    break;
+                }
+                c.above = op[0] == '>';
+                c.strict = op.size() == 1;
+                if (!number(c.bound)) break;
+                q.constraints.push_back(c);
+            } while (at("and") && ++i);
+        } else if (at("over")) {
+            ++i;
+            over = true;
+            do {
+                std::string name = next();
+                const InputField* f = findInputField(name);
+                if (!f) { error = "unknown input '" + name + "'"; break; }
+                if (at("=")) {
+                    ++i;
+                    double v;
+                    if (!number(v)) break;
+                    q.fixed.push_back({f, v});
+                    continue;
+                }
+                QueryAxis a{f, 0.0, 0.0};
+                if (next() != "in" || next() != "[" || !number(a.lo) || next() != "," || !number(a.hi) ||
+                    next() != "]") {
+                    if (error.empty()) error = "expected '" + name + " in [LO, HI]' or '" + name + " = VALUE'";
+                    break;
+                }
+                if (a.hi < a.lo) std::swap(a.lo, a.hi);
+                q.axes.push_back(a);
+            } while (error.empty() && at(",") && ++i);
+        } else if (at("using")) {
+            ++i;
+            std::string s = next();
+            int k = 0;
+            while (k < kQueryStrategyCount && s != kQueryStrategyNames[k]) ++k;
+            if (k == kQueryStrategyCount) error = "unknown strategy '" + s + "'";
+            else q.strategy = static_cast<QueryStrategy>(k);
+        } else if (at("budget")) {
+            ++i;
+            double v;
+            if (number(v)) q.budget = static_cast<uint64_t>(std::max(1.0, v));
+        } else {
+            error = "unexpected '" + t[i] + "'";
+        }
+    }
+    if (error.empty() && !over) error = "missing 'over' clause";
+    if (!error.empty()) {
+        std::cerr << "Error: --query: " << error << ".\n";
+        return false;
+    }
+    return true;
+}
+
+// Feasibility first: total relative constraint violation, then the objective,
+// then the lower point id, so results do not depend on the thread count.
+struct QueryScore {
+    double violation = std::numeric_limits<double>::infinity();
+    double objective = std::numeric_limits<double>::quiet_NaN();
+    uint64_t id = UINT64_MAX;
+};
+
+QueryScore scoreQueryPoint(const SweepQuery& q, const double* v, uint64_t id) {
+    QueryScore s;
+    s.id = id;
+    s.objective = v[0];
+    if (!std::isfinite(v[0])) return s;
+    s.violation = 0.0;
+    for (size_t k = 1; k < q.values(); ++k) {
+        const QueryConstraint& c = q.constraints[k - 1];
+        if (!std::isfinite(v[k])) { s.violation = std::numeric_limits<double>::infinity(); break; }
+        if (c.satisfiedBy(v[k])) continue;
+        // On a strict bound the gap is 0; it still counts, as the least violation there is.
+        double gap = std::max(c.above ? c.bound - v[k] : v[k] - c.bound, std::numeric_limits<double>::min());
+        s.violation += gap / (c.bound != 0.0 ? std::fabs(c.bound) : 1.0);
+    }
+    return s;
+}
+
+inline bool scoresBefore(const SweepQuery& q, const QueryScore& a, const QueryScore& b) {
+    if (a.violation != b.violation) return a.violation < b.violation;
+    if (a.objective != b.objective) return q.maximize ? a.objective > b.objective : a.objective < b.objective;
+    return a.id < b.id;
+}
+
+// One evaluated point: its axis coordinates and its queried values.
+struct QueryPoints {
+    std::vector<double> x;           // count * axes
+    std::vector<double> v;           // count * values
+    size_t valueCount() const { return v.size(); }
+};
+
+// Evaluates points on the batch kernel in kBatchSize blocks over `threads`
+// threads. point(i, x) writes the axis coordinates of point i into x.
+template<class PointFn>
+void evaluateQueryPoints(const SweepQuery& q, const EngineInputs& base, uint64_t count, int threads,
+                         PointFn point, QueryPoints& out) {
+    using namespace std;
+    const size_t na = q.axes.size(), nv = q.values();
+    out.x.assign(count * na, 0.0);
+    out.v.assign(count * nv, 0.0);
+    const BatchKernel kernel = batchKernelFor(q.engine);
+    const OutputMask mask = q.outputs();
+    atomic<uint64_t> nextBlock(0);
+    auto body = [&] {
+        EngineInputs block[kBatchSize];
+        vector<double> storage(OUT_COUNT * kBatchSize);
+        double* cols[OUT_COUNT];
+        for (int c = 0; c < OUT_COUNT; ++c) cols[c] = (mask & outputBit(c)) ? &storage[c * kBatchSize] : nullptr;
+        for (;;) {
+            uint64_t first = nextBlock.fetch_add(kBatchSize);
+            if (first >= count) break;
+            size_t n = static_cast<size_t>(min<uint64_t>(kBatchSize, count - first));
+            for (size_t j = 0; j < n; ++j) {
+                double* x = out.x.data() + (first + j) * na;
+                point(first + j, x);
+                block[j] = base;
+                for (size_t a = 0; a < na; ++a) block[j].*(q.axes[a].field->member) = x[a];
+            }
+            kernel(block, n, cols, mask);
+            for (size_t j = 0; j < n; ++j)
+                for (size_t k = 0; k < nv; ++k) out.v[(first + j) * nv + k] = cols[q.column(k)][j];
+        }
+    };
+    const int n = static_cast<int>(min<uint64_t>(max(1, threads), (count + kBatchSize - 1) / kBatchSize));
+    if (n <= 1) { body(); return; }
+    vector<thread> pool;
+    for (int w = 0; w < n; ++w) pool.emplace_back(body);
+    for (thread& th : pool) th.join();
+}
+
+struct QueryResult {
+    QueryScore best;
+    std::vector<double> x;           // coordinates of best
+    std::vector<double> v;           // values of best
+    uint64_t evaluations = 0;
+    uint64_t pruned = 0;             // boxes discarded by bounds
+    uint64_t bounded = 0;            // interval evaluations
+    double proven = std::numeric_limits<double>::quiet_NaN();   // no point beats this (interval strategy)
+};
+
+// Folds evaluated points into the incumbent. `id0` numbers them across rounds.
+void updateQueryResult(const SweepQuery& q, const QueryPoints& pts, uint64_t id0, QueryResult& r) {
+    const size_t na = q.axes.size(), nv = q.values();
+    for (size_t i = 0; i < pts.valueCount() / nv; ++i) {
+        QueryScore s = scoreQueryPoint(q, &pts.v[i * nv], id0 + i);
+        if (!scoresBefore(q, s, r.best)) continue;
+        r.best = s;
+        r.x.assign(pts.x.begin() + i * na, pts.x.begin() + (i + 1) * na);
+        r.v.assign(pts.v.begin() + i * nv, pts.v.begin() + (i + 1) * nv);
+    }
+    r.evaluations += pts.valueCount() / nv;
+}
+
+// Direction of each value along each axis on probe lines through the box:
+// +1 or -1 when every line agrees, 0 otherwise. sign[k * axes + a].
+std::vector<int> probeQueryMonotonicity(const SweepQuery& q, const EngineInputs& base, uint64_t seed, int threads,
+                                        QueryResult& r) {
+    const size_t na = q.axes.size(), nv = q.values();
+    const uint64_t lines = 8, steps = 9;
+    QueryPoints pts;
+    evaluateQueryPoints(q, base, na * lines * steps, threads, [&](uint64_t i, double* x) {
+        const uint64_t a = i / (lines * steps), line = i / steps % lines, step = i % steps;
+        for (size_t b = 0; b < na; ++b)
+            x[b] = q.axes[b].lo + (q.axes[b].hi - q.axes[b].lo) * counterUniform(seed, line, b);
+        x[a] = q.axes[a].lo + (q.axes[a].hi - q.axes[a].lo) * step / (steps - 1);
+    }, pts);
+    updateQueryResult(q, pts, 0, r);
+
+    std::vector<int> sign(nv * na, 0);
+    for (size_t k = 0; k < nv; ++k)
+        for (size_t a = 0; a < na; ++a) {
+            bool up = true, down = true;
+            for (uint64_t line = 0; line < lines; ++line)
+                for (uint64_t step = 1; step < steps; ++step) {
+                    const uint64_t i = (a * lines + line) * steps + step;
+                    double d = pts.v[i * nv + k] - pts.v[(i - 1) * nv + k];
+                    if (!std::isfinite(d)) up = down = false;
+                    up = up && d >= 0.0;
+                    down = down && d <= 0.0;
+                }
+            sign[k * na + a] = up ? 1 : down ? -1 : 0;
+        }
+    return sign;
+}
+
+// Spends what the probes left of the budget: the same number of points on
+// every axis, trimmed until the grid fits. An axis with one point takes its
+// centre.
+void runQueryGrid(const SweepQuery& q, const EngineInputs& base, int threads, QueryResult& r) {
+    const size_t na = q.axes.size();
+    const uint64_t room = q.budget > r.evaluations ? q.budget - r.evaluations : 0;
+    if (room == 0) return;
+    std::vector<uint64_t> per(na, std::max<uint64_t>(1, static_cast<uint64_t>(
+                                      std::floor(std::pow(static_cast<double>(room), 1.0 / std::max<size_t>(1, na))
+                                                 + 1e-9))));
+    auto product = [&] {
+        uint64_t n = 1;
+        for (uint64_t p : per) n = n > room / p ? room + 1 : n * p;
+        return n;
+    };
+    for (size_t a = 0; product() > room; a = (a + 1) % na) per[a] = std::max<uint64_t>(1, per[a] - 1);
+    const uint64_t count = product();
+    QueryPoints pts;
+    evaluateQueryPoints(q, base, count, threads, [&](uint64_t i, double* x) {
+        for (size_t a = na; a-- > 0;) {
+            const double t = per[a] == 1 ? 0.5 : static_cast<double>(i % per[a]) / (per[a] - 1);
+            x[a] = q.axes[a].lo + (q.axes[a].hi - q.axes[a].lo) * t;
+            i /= per[a];
+        }
+    }, pts);
+    updateQueryResult(q, pts, r.evaluations, r);
+}
+
+// Branch-and-bound on monotone bounds. Each round evaluates, for every open
+// box, its centre and the corner where each fully monotone value is at its
+// best; a box whose best corner breaks a constraint, or whose best objective
+// cannot beat a feasible incumbent, is dropped. Survivors are bisected along
+// their widest (relative) axis; when the next round would overrun the budget
+// the most promising boxes go first.
+void runQueryAdaptive(const SweepQuery& q, const EngineInputs& base, int threads, const std::vector<int>& sign,
+                      QueryResult& r) {
+    const size_t na = q.axes.size(), nv = q.values();
+    struct Box { std::vector<double> lo, hi; double promise; };
+    std::vector<size_t> bounded;     // values monotone in every axis
+    for (size_t k = 0; k < nv; ++k) {
+        bool all = true;
+        for (size_t a = 0; a < na; ++a) all = all && sign[k * na + a] != 0;
+        if (all) bounded.push_back(k);
+    }
+    const size_t perBox = 1 + bounded.size();
+    std::vector<Box> open(1);
+    for (const QueryAxis& a : q.axes) { open[0].lo.push_back(a.lo); open[0].hi.push_back(a.hi); }
+
+    while (!open.empty() && r.evaluations + open.size() * perBox <= q.budget) {
+        QueryPoints pts;
+        evaluateQueryPoints(q, base, open.size() * perBox, threads, [&](uint64_t i, double* x) {
+            const Box& b = open[i / perBox];
+            const size_t slot = i % perBox;
+            for (size_t a = 0; a < na; ++a) {
+                if (slot == 0) { x[a] = 0.5 * (b.lo[a] + b.hi[a]); continue; }
+                const size_t k = bounded[slot - 1];
+                x[a] = (sign[k * na + a] > 0) == q.wantsHigh(k) ? b.hi[a] : b.lo[a];
+            }
+        }, pts);
+        updateQueryResult(q, pts, r.evaluations, r);
+
+        std::vector<Box> next;
+        for (size_t bi = 0; bi < open.size(); ++bi) {
+            const double* v = &pts.v[bi * perBox * nv];
+            bool drop = false;
+            double promise = v[0];   // centre objective when the objective is not bounded
+            for (size_t s = 1; s < perBox && !drop; ++s) {
+                const size_t k = bounded[s - 1];
+                const double best = v[s * nv + k];
+                if (k == 0) {
+                    promise = best;
+                    drop = r.best.violation == 0.0 && std::isfinite(best) &&
+                           !(q.maximize ? best > r.best.objective : best < r.best.objective);
+                } else {
+                    const QueryConstraint& c = q.constraints[k - 1];
+                    drop = std::isfinite(best) && !c.satisfiedBy(best);
+                }
+            }
+            if (drop) { ++r.pruned; continue; }
+            const Box& b = open[bi];
+            size_t widest = 0;
+            double width = -1.0;
+            for (size_t a = 0; a < na; ++a) {
+                double w = (b.hi[a] - b.lo[a]) / std::max(q.axes[a].hi - q.axes[a].lo, 1e-300);
+                if (w > width) { width = w; widest = a; }
+            }
+            if (width < 1e-6) continue;
+            Box lo = b, hi = b;
+            lo.hi[widest] = hi.lo[widest] = 0.5 * (b.lo[widest] + b.hi[widest]);
+            lo.promise = hi.promise = std::isfinite(promise) ? (q.maximize ? -promise : promise)
+                                                             : std::numeric_limits<double>::infinity();
+            next.push_back(lo);
+            next.push_back(hi);
+        }
+        const size_t room = (q.budget - r.evaluations) / perBox;
+        if (next.size() > room) {
+            std::stable_sort(next.begin(), next.end(),
+                             [](const Box& a, const Box& b) { return a.promise < b.promise; });
+            next.resize(room);
+        }
+        open.swap(next);
+    }
+}
+
+// Best-first branch-and-bound on Interval Bounds. A box is bounded with one
+// interval evaluation and dropped when a constraint fails everywhere in it,
+// every point is NaN, or its best objective cannot beat a feasible
+// incumbent. Each round bisects the most promising boxes along their widest
+// (relative) axis, bounds the halves and evaluates the centres of the
+// survivors. When the probe found the objective monotone in every axis, the
+// box corner it points to is evaluated too; that only moves the incumbent,
+// never the bounds. Once no open box can beat the incumbent the search is
+// over, and `proven` is the best objective any point could still reach.
+void runQueryInterval(const SweepQuery& q, const EngineInputs& base, int threads, const std::vector<int>& sign,
+                      QueryResult& r) {
+    const size_t na = q.axes.size();
+    bool corner = true;
+    for (size_t a = 0; a < na; ++a) corner = corner && sign[a] != 0;
+    const size_t perBox = corner ? 2 : 1;
+    const size_t perRound = kBatchSize / 2;
+    struct Box { std::vector<double> lo, hi; double promise; };    // promise: best objective, negated to maximize
+    auto later = [](const Box& a, const Box& b) { return a.promise > b.promise; };
+    std::priority_queue<Box, std::vector<Box>, decltype(later)> open(later);
+    auto target = [&] { return r.best.violation != 0.0 ? kInf : q.maximize ? -r.best.objective : r.best.objective; };
+    double floor = kInf;             // best promise among boxes given up below the width limit
+
+    auto bound = [&](Box& b) {
+        EngineInputs lo = base, hi = base;
+        for (size_t a = 0; a < na; ++a) {
+            lo.*(q.axes[a].field->member) = b.lo[a];
+            hi.*(q.axes[a].field->member) = b.hi[a];
+        }
+        Interval v[OUT_COUNT];
+        boundCycle(q.engine, lo, hi, v);
+        ++r.bounded;
+        const Interval& obj = v[q.objective];
+        bool drop = obj.empty();
+        for (const QueryConstraint& c : q.constraints) {
+            const Interval& iv = v[c.column];
+            drop = drop || iv.empty() || !c.satisfiedBy(c.above ? iv.hi : iv.lo);
+        }
+        b.promise = q.maximize ? -obj.hi : obj.lo;
+        if (drop) ++r.pruned;
+        return !drop;
+    };
+    auto centres = [&](const std::vector<Box>& boxes) {
+        QueryPoints pts;
+        evaluateQueryPoints(q, base, boxes.size() * perBox, threads, [&](uint64_t i, double* x) {
+            const Box& b = boxes[i / perBox];
+            for (size_t a = 0; a < na; ++a) {
+                if (i % perBox == 0) x[a] = 0.5 * (b.lo[a] + b.hi[a]);
+                else x[a] = (sign[a] > 0) == q.maximize ? b.hi[a] : b.lo[a];
+            }
+        }, pts);
+        updateQueryResult(q, pts, r.evaluations, r);
+    };
+
+    Box root;
+    for (const QueryAxis& a : q.axes) { root.lo.push_back(a.lo); root.hi.push_back(a.hi); }
+    if (bound(root) && r.evaluations + perBox <= q.budget) {
+        centres({root});
+        open.push(root);
+    }
+    while (!open.empty() && open.top().promise < target()) {
+        std::vector<Box> halves;
+        while (!open.empty() && halves.size() < 2 * perRound && open.top().promise < target()) {
+            Box b = open.top();
+            open.pop();
+            size_t widest = 0;
+            double width = -1.0;
+            for (size_t a = 0; a < na; ++a) {
+                double w = (b.hi[a] - b.lo[a]) / std::max(q.axes[a].hi - q.axes[a].lo, 1e-300);
+                if (w > width) { width = w; widest = a; }
+            }
+            if (width < 1e-6) { floor = std::min(floor, b.promise); continue; }
+            Box lo = b, hi = b;
+            lo.hi[widest] = hi.lo[widest] = 0.5 * (b.lo[widest] + b.hi[widest]);
+            if (bound(lo)) halves.push_back(lo);
+            if (bound(hi)) halves.push_back(hi);
+        }
+        if (r.evaluations + halves.size() * perBox > q.budget) {
+            for (const Box& b : halves) floor = std::min(floor, b.promise);
+            break;
+        }
+        if (!halves.empty()) centres(halves);
+        for (const Box& b : halves)
+            if (b.promise < target()) open.push(b);
+            else ++r.pruned;
+    }
+    if (!open.empty()) floor = std::min(floor, open.top().promise);
+    floor = std::min(floor, target());
+    r.proven = q.maximize ? -floor : floor;
+}
+
+// Multi-start compass search: the best points of a random sample start a
+// poll of +-step along every axis; a start moves to its best improving poll
+// point or halves its step. All polls of a round run as one batch.
+void runQueryOptimizer(const SweepQuery& q, const EngineInputs& base, uint64_t seed, int threads, QueryResult& r) {
+    const size_t na = q.axes.size(), nv = q.values();
+    const uint64_t samples = std::max<uint64_t>(1, std::min<uint64_t>(q.budget / 4, 4096));
+    QueryPoints pts;
+    evaluateQueryPoints(q, base, samples, threads, [&](uint64_t i, double* x) {
+        for (size_t a = 0; a < na; ++a)
+            x[a] = q.axes[a].lo + (q.axes[a].hi - q.axes[a].lo) * counterUniform(seed ^ 0x5EA4C4ull, i, a);
+    }, pts);
+    const uint64_t id0 = r.evaluations;
+    updateQueryResult(q, pts, id0, r);
+
+    struct Start { std::vector<double> x, step; QueryScore score; };
+    std::vector<size_t> order(samples);
+    for (size_t i = 0; i < samples; ++i) order[i] = i;
+    std::vector<QueryScore> scores(samples);
+    for (size_t i = 0; i < samples; ++i) scores[i] = scoreQueryPoint(q, &pts.v[i * nv], id0 + i);
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return scoresBefore(q, scores[a], scores[b]); });
+    std::vector<Start> starts;
+    for (size_t s = 0; s < std::min<size_t>(8, samples); ++s) {
+        Start st;
+        st.x.assign(pts.x.begin() + order[s] * na, pts.x.begin() + (order[s] + 1) * na);
+        for (const QueryAxis& a : q.axes) st.step.push_back(0.25 * (a.hi - a.lo));
+        st.score = scores[order[s]];
+        starts.push_back(st);
+    }
+
+    const size_t polls = 2 * na;
+    while (na > 0 && r.evaluations + starts.size() * polls <= q.budget) {
+        std::vector<size_t> active;
+        for (size_t s = 0; s < starts.size(); ++s) {
+            bool moving = false;
+            for (size_t a = 0; a < na; ++a) moving = moving || starts[s].step[a] > 1e-6 * (q.axes[a].hi - q.axes[a].lo);
+            if (moving) active.push_back(s);
+        }
+        if (active.empty()) break;
+        evaluateQueryPoints(q, base, active.size() * polls, threads, [&](uint64_t i, double* x) {
+            const Start& st = starts[active[i / polls]];
+            const size_t a = i % polls / 2;
+            std::copy(st.x.begin(), st.x.end(), x);
+            x[a] += (i % 2 ? -1.0 : 1.0) * st.step[a];
+            x[a] = std::min(q.axes[a].hi, std::max(q.axes[a].lo, x[a]));
+        }, pts);
+        const uint64_t round = r.evaluations;
+        updateQueryResult(q, pts, round, r);
+        for (size_t j = 0; j < active.size(); ++j) {
+            Start& st = starts[active[j]];
+            size_t bestPoll = polls;
+            QueryScore best = st.score;
+            for (size_t p = 0; p < polls; ++p) {
+                QueryScore s = scoreQueryPoint(q, &pts.v[(j * polls + p) * nv], round + j * polls + p);
+                bool better = s.violation < best.violation ||
+                              (s.violation == best.violation &&
+                               (q.maximize ? s.objective > best.objective : s.objective < best.objective));
+                if (better) {
+                    best = s;
+                    bestPoll = p;
+                }
+            }
+            if (bestPoll == polls) {
+                for (double& step : st.step) step *= 0.5;
+                continue;
+            }
+            st.x.assign(pts.x.begin() + (j * polls + bestPoll) * na, pts.x.begin() + (j * polls + bestPoll + 1) * na);
+            st.score = best;
+        }
+    }
+}
+
+int runQuery(const SweepQuery& q, EngineInputs base, uint64_t seed, int threads) {
+    using namespace std;
+    for (const auto& f : q.fixed) base.*(f.first->member) = f.second;
+    const size_t na = q.axes.size(), nv = q.values();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    EngineInputs lo = base, hi = base;
+    for (const QueryAxis& a : q.axes) {
+        lo.*(a.field->member) = a.lo;
+        hi.*(a.field->member) = a.hi;
+    }
+    const bool bounded = hasIntervalBounds(q.engine) && !usesFuelLibrary(IntervalInputs(lo, hi));
+    if (q.strategy == QUERY_INTERVAL && !bounded) {
+        cerr << "Error: --query: interval bounds cover jet, fan and fan2 on fuel_type 0.\n";
+        return 1;
+    }
+
+    QueryResult r;
+    vector<int> sign = na ? probeQueryMonotonicity(q, base, seed, threads, r) : vector<int>();
+    bool monotone = true;
+    for (int s : sign) monotone = monotone && s != 0;
+    QueryStrategy strategy = na == 0 ? QUERY_GRID : q.strategy;
+    if (strategy == QUERY_AUTO) {
+        const uint64_t room = q.budget > r.evaluations ? q.budget - r.evaluations : 0;
+        const double perAxis = na ? pow(static_cast<double>(room), 1.0 / na) : 1.0;
+        strategy = bounded ? QUERY_INTERVAL : monotone ? QUERY_ADAPTIVE : perAxis >= 16.0 ? QUERY_GRID
+                                                                                           : QUERY_OPTIMIZER;
+    }
+
+    cout << "Plan: " << kQueryStrategyNames[strategy] << " over " << na << " axis(es), budget " << q.budget << "\n";
+    for (size_t k = 0; k < nv && na; ++k) {
+        cout << "  " << left << setw(16) << kOutputNames[q.column(k)] << right;
+        for (size_t a = 0; a < na; ++a) {
+            int s = sign[k * na + a];
+            cout << " " << (s > 0 ? "+" : s < 0 ? "-" : "?") << q.axes[a].field->name;
+        }
+        cout << "\n";
+    }
+
+    if (strategy == QUERY_GRID) runQueryGrid(q, base, threads, r);
+    else if (strategy == QUERY_ADAPTIVE) runQueryAdaptive(q, base, threads, sign, r);
+    else if (strategy == QUERY_INTERVAL) runQueryInterval(q, base, threads, sign, r);
+    else runQueryOptimizer(q, base, seed, threads, r);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << r.evaluations << " points evaluated, ";
+    if (r.bounded) cout << r.bounded << " boxes bounded, ";
+    cout << r.pruned << " boxes pruned, in " << fixed << setprecision(3) << seconds << " s\n"
+         << defaultfloat << setprecision(10);
+    if (r.x.size() != na || r.v.empty()) {
+        cout << "No point could be evaluated.\n";
+        return 1;
+    }
+    if (r.best.violation == 0.0 && !std::isnan(r.proven))
+        cout << "Proven: no feasible point has " << kOutputNames[q.objective] << (q.maximize ? " above " : " below ")
+             << r.proven << "\n";
+    cout << (r.best.violation == 0.0 ? "Best feasible point:\n" : "No feasible point found; least violating:\n");
+    for (size_t a = 0; a < na; ++a)
+        cout << "  " << left << setw(16) << q.axes[a].field->name << right << r.x[a] << "\n";
+    for (size_t k = 0; k < nv; ++k) {
+        cout << "  " << left << setw(16) << kOutputNames[q.column(k)] << right << r.v[k];
+        if (k > 0) cout << "   (" << q.constraints[k - 1].op() << " " << q.constraints[k - 1].bound << ")";
+        cout << "\n";
+    }
+    return r.best.violation == 0.0 ? 0 : 2;
+}
+
+// ==========================================================
+// Stage Profile Report
+// ==========================================================
+void printStageProfile(std::ostream& os) {
+    using namespace std;
+    lock_guard<mutex> guard(g_stage_counters_lock);
+    if (g_stage_counters.empty()) return;
+    int hw = g_stage_counters[0]->hwCounters;
+    if (hw == 0) os << "\nNote: hardware counters unavailable; reporting wall time only.\n";
+
+    // Per-thread rows first, then the sum over threads.
+    StageCounters total;
+    for (const StageCounters* sc : g_stage_counters)
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            total.calls[s] += sc->calls[s];
+            for (int k = 0; k < CTR_COUNT; ++k) total.totals[s][k] += sc->totals[s][k];
+        }
+    total.thread = -1;
+
+    vector<const StageCounters*> tables(g_stage_counters.begin(), g_stage_counters.end());
+    if (tables.size() > 1) tables.push_back(&total);
+    for (const StageCounters* sc : tables) {
+        os << "\n--- STAGE PROFILE (" << (sc->thread < 0 ? string("all threads")
+                                        : "thread " + to_string(sc->thread)) << ", per call) ---\n";
+        os << left << setw(22) << "Stage" << right << setw(12) << "calls";
+        for (int k = 0; k <= hw; ++k) os << setw(15) << kCounterNames[k];
+        if (hw >= 2) os << setw(8) << "IPC";
+        os << "\n" << fixed << setprecision(2);
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            if (sc->calls[s] == 0) continue;
+            double n = static_cast<double>(sc->calls[s]);
+            os << left << setw(22) << kStageNames[s] << right << setw(12) << sc->calls[s];
+            for (int k = 0; k <= hw; ++k) os << setw(15) << sc->totals[s][k] / n;
+            if (hw >= 2)
+                os << setw(8) << sc->totals[s][CTR_INSTRUCTIONS] / max(1.0, sc->totals[s][CTR_CYCLES]);
+            os << "\n";
+        }
+        os << "-----------------------------------\n";
+    }
+}
+
+void writeStageProfileJson(std::ostream& os) {
+    using namespace std;
+    lock_guard<mutex> guard(g_stage_counters_lock);
+    int hw = g_stage_counters.empty() ? 0 : g_stage_counters[0]->hwCounters;
+    os << "{\n  \"hardware_counters\": " << (hw > 0 ? "true" : "false") << ",\n  \"threads\": [";
+    os << setprecision(6);
+    for (size_t t = 0; t < g_stage_counters.size(); ++t) {
+        const StageCounters* sc = g_stage_counters[t];
+        os << (t ? "," : "") << "\n    {\"thread\": " << sc->thread << ", \"stages\": {";
+        bool first = true;
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            if (sc->calls[s] == 0) continue;
+            os << (first ? "" : ",") << "\n      \"" << kStageNames[s] << "\": {\"calls\": " << sc->calls[s];
+            for (int k = 0; k <= hw; ++k) os << ", \"" << kCounterNames[k] << "\": " << sc->totals[s][k];
+            os << "}";
+            first = false;
+        }
+        os << "\n    }}";
+    }
+    os << "\n  ]\n}\n";
+}
 
 // ==========================================================
-// GLOBAL VARIABLES
+// Benchmark
 // ==========================================================
+// Runs the current inputs in a tight loop for a fixed time per trial, on
+// 1, 2, 4, ... up to maxThreads pinned threads, through both the classes
+// (scalar) and the batch kernels. ns/point is core time per point, so it
+// stays flat under perfect scaling.
+struct BenchOptions {
+    int maxThreads = 0;          // 0: every allowed CPU
+    double seconds = 0.5;        // per trial
+    int trials = 3;
+    OutputMask outputs = kAllOutputs;   // batch kernels only
+};
 
-// Gas properties
-double g_gamma_air, g_gamma_gas;
-double g_cp_air, g_cp_gas;
-double g_R_air, g_Q_HV;
+struct BenchStats {
+    int threads = 0;
+    double nsPerPoint = 0.0;     // mean over trials
+    double stddevNs = 0.0;
+    double pointsPerSecPerCore = 0.0;
+};
 
-// Flight conditions
-double g_M0, g_T0, g_P0;
+// Points evaluated by one thread until the deadline; `sink` keeps the
+// results live so the loop cannot be optimized away. It is written once at
+// the end: the callers' sinks share cache lines, so adding to them in the
+// loop would false-share between threads.
+uint64_t benchmarkLoop(EngineType engine, bool batch, const EngineInputs& in, OutputMask outputs,
+                       std::chrono::steady_clock::time_point deadline, double& sink) {
+    uint64_t points = 0;
+    double acc = 0.0;
+    double out[OUT_COUNT];
+    if (!batch) {
+        applyGlobalInputs(in);
+        do {
+            for (int k = 0; k < 64; ++k) {
+                if (engine == ENGINE_TURBOJET) {
+                    Turbojet jet; jet.runFullAnalysis(); jet.collectOutputs(out);
+                } else if (engine == ENGINE_TWO_SPOOL) {
+                    TwoSpoolTurbofan fan; fan.runFullAnalysis(); fan.collectOutputs(out);
+                } else if (engine == ENGINE_TURBOPROP || engine == ENGINE_TURBOSHAFT) {
+                    Turboprop prop(engine == ENGINE_TURBOPROP); prop.runFullAnalysis(); prop.collectOutputs(out);
+                } else if (engine == ENGINE_ICR) {
+                    IcrTurbofan fan; fan.runFullAnalysis(); fan.collectOutputs(out);
+                } else if (engine == ENGINE_VARIABLE) {
+                    VariableCycleEngine vce; vce.runFullAnalysis(); vce.collectOutputs(out);
+                } else {
+                    Turbofan fan; fan.runFullAnalysis(); fan.collectOutputs(out);
+                }
+                acc += out[OUT_TSFC];
+            }
+            points += 64;
+        } while (std::chrono::steady_clock::now() < deadline);
+        sink = acc;
+        return points;
+    }
 
-// Efficiencies
-double g_eta_inlet, g_eta_c, g_eta_f, g_eta_b, g_eta_t, g_eta_ab, g_eta_n;
+    std::vector<EngineInputs> block(kBatchSize, in);
+    std::vector<double> storage(kBatchSize * OUT_COUNT);
+    double* cols[OUT_COUNT];
+    for (int c = 0; c < OUT_COUNT; ++c) cols[c] = storage.data() + c * kBatchSize;
+    BatchKernel kernel = batchKernelFor(engine);
+    int probe = 0;
+    while (!(outputs & outputBit(probe))) ++probe;
+    do {
+        for (int k = 0; k < 4; ++k) {
+            kernel(block.data(), kBatchSize, cols, outputs);
+            acc += cols[probe][k];
+        }
+        points += 4 * kBatchSize;
+    } while (std::chrono::steady_clock::now() < deadline);
+    sink = acc;
+    return points;
+}
 
-// Pressure ratios & limits
-double g_pi_b, g_pi_ab, g_pi_m, g_T_t4, g_T_t7;
+BenchStats benchmarkThreads(EngineType engine, bool batch, const EngineInputs& in,
+                            const std::vector<int>& cpus, int threads, const BenchOptions& opt) {
+    using namespace std;
+    vector<double> nsPerPoint;
+    for (int t = 0; t < opt.trials; ++t) {
+        vector<uint64_t> points(threads, 0);
+        vector<double> sinks(threads, 0.0);
+        atomic<int> ready(0);
+        atomic<bool> go(false);
+        chrono::steady_clock::time_point start, deadline;
+        vector<thread> pool;
+        for (int w = 0; w < threads; ++w) {
+            pool.emplace_back([&, w] {
+                pinCurrentThread(cpus[w % cpus.size()]);
+                ready.fetch_add(1);
+                while (!go.load(memory_order_acquire)) this_thread::yield();
+                points[w] = benchmarkLoop(engine, batch, in, opt.outputs, deadline, sinks[w]);
+            });
+        }
+        while (ready.load() < threads) this_thread::yield();
+        start = chrono::steady_clock::now();
+        deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(
+                               chrono::duration<double>(opt.seconds));
+        go.store(true, memory_order_release);
+        for (thread& th : pool) th.join();
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-// Engine-specific
-double g_pi_c_jet;
-double g_BPR, g_pi_f, g_pi_c_fan;
+        uint64_t total = 0;
+        for (uint64_t p : points) total += p;
+        nsPerPoint.push_back(elapsed * threads * 1e9 / max<uint64_t>(total, 1));
+    }
 
-// Flags
-bool g_inputs_are_set = false;
-bool g_debug_mode = false;
+    BenchStats st;
+    st.threads = threads;
+    for (double v : nsPerPoint) st.nsPerPoint += v;
+    st.nsPerPoint /= nsPerPoint.size();
+    for (double v : nsPerPoint) st.stddevNs += (v - st.nsPerPoint) * (v - st.nsPerPoint);
+    st.stddevNs = nsPerPoint.size() > 1 ? sqrt(st.stddevNs / (nsPerPoint.size() - 1)) : 0.0;
+    st.pointsPerSecPerCore = 1e9 / st.nsPerPoint;
+    return st;
+}
+
+void runBenchmark(EngineType engine, const EngineInputs& in, const BenchOptions& opt) {
+    using namespace std;
+    vector<int> cpus;
+    for (const NumaNode& node : discoverNumaTopology())
+        cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+    int maxThreads = opt.maxThreads > 0 ? opt.maxThreads : static_cast<int>(cpus.size());
+    vector<int> counts;
+    for (int n = 1; n < maxThreads; n *= 2) counts.push_back(n);
+    counts.push_back(maxThreads);
+
+    bool debug = g_debug_mode;
+    g_debug_mode = false;
+    for (int pass = hasClassPath(engine) ? 0 : 1; pass < 2; ++pass) {
+        bool batch = pass == 1;
+        cout << "\n--- BENCHMARK: " << (engine == ENGINE_TURBOJET ? "TURBOJET"
+                                       : engine == ENGINE_TURBOFAN ? "TURBOFAN"
+                                       : engine == ENGINE_TWO_SPOOL ? "TWO-SPOOL TURBOFAN"
+                                       : engine == ENGINE_TURBOPROP ? "TURBOPROP"
+                                       : engine == ENGINE_TURBOSHAFT ? "TURBOSHAFT"
+                                       : engine == ENGINE_ICR ? "INTERCOOLED RECUPERATED TURBOFAN"
+                                       : engine == ENGINE_VARIABLE ? "VARIABLE-CYCLE ENGINE"
+                                       : engine == ENGINE_PROGRAM ? "CYCLE " + g_cycle_program.name
+                                       : "KERNEL " + g_kernel_plugin.cycle)
+             << " (" << (batch ? "batch" : "scalar")
+             << (batch && hasIsaLevels(engine) ? string(", ") + kIsaNames[g_isa] : string())
+             << ", " << opt.trials << " x "
+             << opt.seconds << " s) ---\n";
+        cout << setw(8) << "Threads" << setw(12) << "ns/point" << setw(10) << "+/- %"
+             << setw(16) << "Mpts/s/core" << setw(14) << "Mpts/s" << setw(12) << "Scaling" << "\n";
+        double base = 0.0;
+        for (int n : counts) {
+            BenchStats st = benchmarkThreads(engine, batch, in, cpus, n, opt);
+            if (n == 1) base = st.pointsPerSecPerCore;
+            cout << fixed << setw(8) << n << setprecision(2) << setw(12) << st.nsPerPoint
+                 << setprecision(1) << setw(10) << 100.0 * st.stddevNs / st.nsPerPoint
+                 << setprecision(3) << setw(16) << st.pointsPerSecPerCore / 1e6
+                 << setw(14) << st.pointsPerSecPerCore * n / 1e6
+                 << setprecision(1) << setw(11) << 100.0 * st.pointsPerSecPerCore / base << "%\n";
+        }
+        cout << "-----------------------------------\n";
+    }
+    g_debug_mode = debug;
+}
 
 // ==========================================================
-// Utility Functions
+// Benchmark Regression Suite
 // ==========================================================
-inline double safe_pow(double base, double exp) {
-    if (base <= 0.0) return 0.0;
-    return std::pow(base, exp);
+// --bench-suite collects repeated samples (ns per point or per stage call)
+// for per-stage cost, full analysis, sweep throughput and the result sinks.
+// --bench-record appends them to a baseline file keyed by git commit and CPU
+// model; --bench-compare runs a one-sided Mann-Whitney U test of each
+// benchmark against the newest baseline recorded on the same CPU model.
+struct SuiteOptions {
+    int samples = 10;
+    double seconds = 0.2;           // per full-analysis sample
+    double alpha = 0.01;
+    double thresholdPct = 2.0;      // ignore significant but smaller shifts
+    std::string recordPath, comparePath;
+    std::string commit, baselineCommit;
+};
+
+struct SuiteResult {
+    std::string name;
+    std::vector<double> samples;    // ns per op, lower is better
+};
+
+std::string currentCpuModel() {
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line))
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            return colon == std::string::npos ? line : line.substr(line.find_first_not_of(' ', colon + 1));
+        }
+    return "unknown";
 }
 
-template<typename T>
-inline T clamp(T val, T minVal, T maxVal) {
-    return std::max(minVal, std::min(val, maxVal));
+std::string currentGitCommit() {
+    std::string commit;
+    if (FILE* p = popen("git rev-parse --short HEAD 2>/dev/null", "r")) {
+        char buf[64] = {};
+        if (fgets(buf, sizeof(buf), p)) commit = buf;
+        pclose(p);
+    }
+    while (!commit.empty() && (commit.back() == '\n' || commit.back() == ' ')) commit.pop_back();
+    return commit.empty() ? "unknown" : commit;
 }
 
-// ==========================================================
-// CLASS: Turbojet
-// ==========================================================
-class Turbojet {
-private:
-    double T_t0, P_t0, T_t2, P_t2, T_t3, P_t3, T_t4, P_t4;
-    double T_t5, P_t5, T_t7, P_t7, T_t9, P_t9;
-    double V0, V9;
-    double f_comb, f_ab, f_total;
-    double specificThrust, TSFC;
+double median(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t m = v.size() / 2;
+    return v.size() % 2 ? v[m] : 0.5 * (v[m - 1] + v[m]);
+}
 
-    void analyzeInlet() {
-        V0 = g_M0 * std::sqrt(g_gamma_air * g_R_air * g_T0);
-        T_t0 = g_T0 * (1.0 + (g_gamma_air - 1.0) / 2.0 * g_M0 * g_M0);
-        P_t0 = g_P0 * safe_pow(T_t0 / g_T0, g_gamma_air / (g_gamma_air - 1.0));
-        T_t2 = T_t0;
-        P_t2 = P_t0 * g_eta_inlet;
-        if (g_debug_mode)
-            std::cout << "[Inlet] T_t2=" << T_t2 << " P_t2=" << P_t2 << "\n";
+// P(current is not slower than baseline) under H0, one-sided, via the normal
+// approximation with tie correction. Small values mean "current is slower".
+double mannWhitneySlowerP(const std::vector<double>& baseline, const std::vector<double>& current) {
+    struct Obs { double v; int group; };
+    std::vector<Obs> all;
+    for (double v : baseline) all.push_back({v, 0});
+    for (double v : current) all.push_back({v, 1});
+    std::sort(all.begin(), all.end(), [](const Obs& a, const Obs& b) { return a.v < b.v; });
+
+    const double n1 = static_cast<double>(baseline.size()), n2 = static_cast<double>(current.size());
+    const double n = n1 + n2;
+    double rankSumCurrent = 0.0, tieTerm = 0.0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].v == all[i].v) ++j;
+        double rank = 0.5 * (i + 1 + j);           // average of ranks i+1..j
+        for (size_t k = i; k < j; ++k)
+            if (all[k].group == 1) rankSumCurrent += rank;
+        double t = static_cast<double>(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
     }
+    double u = rankSumCurrent - n2 * (n2 + 1) / 2;
+    double mean = n1 * n2 / 2;
+    double var = n1 * n2 / 12 * ((n + 1) - tieTerm / (n * (n - 1)));
+    if (var <= 0) return 1.0;
+    double z = (u - mean - 0.5) / std::sqrt(var);   // continuity correction
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+SweepSpec suiteSweepSpec(EngineType engine, const EngineInputs& in, uint64_t points) {
+    SweepSpec spec;
+    spec.engine = engine;
+    spec.base = in;
+    spec.monteCarlo = true;
+    spec.samples = points;
+    spec.axes.push_back({findInputField("T_t4"), in.T_t4 * 0.9, in.T_t4 * 1.1, 0});
+    spec.axes.push_back({findInputField("M0"), in.M0 * 0.9, in.M0 * 1.1, 0});
+    return spec;
+}
+
+// ns per point for one in-memory sweep, optionally followed by a sink.
+enum SuiteSink { SINK_NONE, SINK_RESULT_FILE, SINK_CSV };
 
-    double analyzeCompressor() {
-        P_t3 = P_t2 * g_pi_c_jet;
-        double T_t3_isen = T_t2 * safe_pow(g_pi_c_jet, (g_gamma_air - 1.0) / g_gamma_air);
-        T_t3 = T_t2 + (T_t3_isen - T_t2) / g_eta_c;
-        if (g_debug_mode)
-            std::cout << "[Compressor] T_t3=" << T_t3 << " P_t3=" << P_t3 << "\n";
-        return g_cp_air * (T_t3 - T_t2);
+double timeSuiteSweep(const SweepSpec& spec, SuiteSink sink) {
+    using Clock = std::chrono::steady_clock;
+    std::string tmp = "/tmp/enginer-suite-" + std::to_string(getpid());
+    SweepOptions opt;
+    SweepResults res;
+    SweepCheckpoint ckpt;
+    std::string outPath = sink == SINK_RESULT_FILE ? tmp + ".dat" : std::string();
+    if (!openSweepResults(outPath, spec, spec.outputs, spec.signature(false), false, false, false, res) ||
+        !ckpt.allocate(spec.chunkCount())) {
+        closeSweepResults(res);
+        return 0.0;
     }
+    ckpt.path = tmp + ".dat.ckpt";
+    ckpt.signature = spec.signature(false);
 
-    void analyzeCombustor() {
-        T_t4 = g_T_t4;
-        double denom = (g_eta_b * g_Q_HV - g_cp_gas * T_t4);
-        if (denom <= 0) denom = std::numeric_limits<double>::epsilon();
-        f_comb = (g_cp_gas * T_t4 - g_cp_air * T_t3) / denom;
-        P_t4 = P_t3 * g_pi_b;
-        if (g_debug_mode)
-            std::cout << "[Combustor] f_comb=" << f_comb << " P_t4=" << P_t4 << "\n";
+    Clock::time_point start = Clock::now();
+    if (sink != SINK_CSV) {
+        for (uint64_t c = 0; c < ckpt.chunks; ++c) {
+            evaluateSweepChunk(spec, opt, res, c);
+            ckpt.mark(c);
+        }
+        flushCheckpoint(res, ckpt);
+    } else {
+        for (uint64_t c = 0; c < ckpt.chunks; ++c) evaluateSweepChunk(spec, opt, res, c);
+        start = Clock::now();                      // time the sink alone
+        std::ofstream csv(tmp + ".csv");
+        writeSweepCsv(csv, spec, res);
     }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / res.points;
 
-    void analyzeTurbine(double work_compressor) {
-        double m_ratio = 1.0 + f_comb;
-        T_t5 = T_t4 - (work_compressor / (m_ratio * g_cp_gas));
-        double T_t5_isen = T_t4 - (T_t4 - T_t5) / g_eta_t;
-        P_t5 = P_t4 * safe_pow(T_t5_isen / T_t4, g_gamma_gas / (g_gamma_gas - 1.0));
-        if (g_debug_mode)
-            std::cout << "[Turbine] T_t5=" << T_t5 << " P_t5=" << P_t5 << "\n";
+    ckpt.release();
+    closeSweepResults(res);
+    std::remove((tmp + ".dat").c_str());
+    std::remove((tmp + ".dat.ckpt").c_str());
+    std::remove((tmp + ".csv").c_str());
+    return ns;
+}
+
+std::vector<SuiteResult> runBenchmarkSuite(const EngineInputs& in, const SuiteOptions& opt) {
+    using namespace std;
+    const EngineType engines[2] = {ENGINE_TURBOJET, ENGINE_TURBOFAN};
+    const char* const engineNames[2] = {"turbojet", "turbofan"};
+    vector<SuiteResult> results;
+    auto result = [&](const string& name) -> SuiteResult& {
+        for (SuiteResult& r : results) if (r.name == name) return r;
+        results.push_back({name, {}});
+        return results.back();
+    };
+
+    bool debug = g_debug_mode, profile = g_profile_stages;
+    g_debug_mode = false;
+    double sink = 0.0;
+    for (int s = 0; s < opt.samples; ++s) {
+        for (int e = 0; e < 2; ++e) {
+            const string prefix = engineNames[e];
+            for (int batch = 0; batch < 2; ++batch) {
+                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                uint64_t points = benchmarkLoop(engines[e], batch == 1, in, kAllOutputs,
+                    start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                chrono::duration<double>(opt.seconds)), sink);
+                double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+                result("full/" + prefix + (batch ? "/batch" : "/scalar")).samples.push_back(ns / points);
+            }
+
+            // Per-stage: difference of this thread's stage totals over a fixed run.
+            g_profile_stages = true;
+            StageCounters& sc = threadStageCounters();
+            StageCounters before = sc;
+            benchmarkLoop(engines[e], false, in, kAllOutputs, chrono::steady_clock::now() +
+                          chrono::duration_cast<chrono::steady_clock::duration>(
+                              chrono::duration<double>(opt.seconds / 4)), sink);
+            g_profile_stages = profile;
+            for (int st = 0; st < STAGE_COUNT; ++st) {
+                uint64_t calls = sc.calls[st] - before.calls[st];
+                if (calls == 0) continue;
+                result("stage/" + prefix + "/" + kStageNames[st]).samples.push_back(
+                    (sc.totals[st][CTR_NS] - before.totals[st][CTR_NS]) / calls);
+            }
+
+            SweepSpec spec = suiteSweepSpec(engines[e], in, 1 << 16);
+            result("sweep/" + prefix).samples.push_back(timeSuiteSweep(spec, SINK_NONE));
+            result("sink/" + prefix + "/result-file").samples.push_back(timeSuiteSweep(spec, SINK_RESULT_FILE));
+            result("sink/" + prefix + "/csv").samples.push_back(
+                timeSuiteSweep(suiteSweepSpec(engines[e], in, 1 << 14), SINK_CSV));
+        }
     }
+    g_debug_mode = debug;
+    volatile double keep = sink;                  // keep the benchmark results live
+    (void)keep;
+    return results;
+}
 
-    void analyzeAfterburner() {
-        T_t7 = g_T_t7;
-        double denom = (g_eta_ab * g_Q_HV - g_cp_gas * T_t7);
-        if (denom <= 0) denom = std::numeric_limits<double>::epsilon();
-        f_ab = (g_cp_gas * (T_t7 - T_t5)) / denom;
-        P_t7 = P_t5 * g_pi_ab;
-        if (g_debug_mode)
-            std::cout << "[Afterburner] f_ab=" << f_ab << " P_t7=" << P_t7 << "\n";
+bool recordSuiteResults(const std::string& path, const std::string& commit, const std::string& cpu,
+                        const std::vector<SuiteResult>& results) {
+    std::ofstream os(path, std::ios::app);
+    os << std::setprecision(6);
+    for (const SuiteResult& r : results) {
+        os << commit << "\t" << cpu << "\t" << r.name << "\t";
+        for (size_t i = 0; i < r.samples.size(); ++i) os << (i ? " " : "") << r.samples[i];
+        os << "\n";
     }
+    return static_cast<bool>(os);
+}
 
-    void analyzeNozzle() {
-        P_t9 = std::max(P_t7, g_P0);
-        T_t9 = T_t7;
-        double T9_isen = T_t9 * safe_pow(g_P0 / P_t9, (g_gamma_gas - 1.0) / g_gamma_gas);
-        double T9_actual = T_t9 - g_eta_n * (T_t9 - T9_isen);
-        V9 = std::sqrt(2.0 * g_cp_gas * (T_t9 - T9_actual));
-        if (g_debug_mode)
-            std::cout << "[Nozzle] V9=" << V9 << "\n";
-    }
-
-    void calculatePerformance() {
-        f_total = f_comb + (1.0 + f_comb) * f_ab;
-        double m_exit = 1.0 + f_total;
-        specificThrust = (m_exit * V9) - V0;
-        TSFC = f_total / std::max(1e-9, specificThrust);
+// Baseline samples for this CPU model: the given commit, or the newest one recorded.
+std::vector<SuiteResult> loadSuiteBaseline(const std::string& path, const std::string& cpu,
+                                           std::string& commit) {
+    std::ifstream in(path);
+    std::string line;
+    std::vector<std::pair<std::string, SuiteResult>> rows;
+    std::string newest;
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        std::string c, model, name, values;
+        if (!std::getline(ss, c, '\t') || !std::getline(ss, model, '\t') ||
+            !std::getline(ss, name, '\t') || !std::getline(ss, values))
+            continue;
+        if (model != cpu) continue;
+        SuiteResult r{name, {}};
+        std::stringstream vs(values);
+        for (double v; vs >> v;) r.samples.push_back(v);
+        rows.push_back({c, r});
+        newest = c;
     }
+    if (commit.empty()) commit = newest;
+    std::vector<SuiteResult> baseline;
+    for (const auto& row : rows) {
+        if (row.first != commit) continue;
+        bool replaced = false;
+        for (SuiteResult& b : baseline)
+            if (b.name == row.second.name) { b = row.second; replaced = true; }
+        if (!replaced) baseline.push_back(row.second);
+    }
+    return baseline;
+}
 
-public:
-    void runFullAnalysis() {
-        analyzeInlet();
-        double work_c = analyzeCompressor();
-        analyzeCombustor();
-        analyzeTurbine(work_c);
-        analyzeAfterburner();
-        analyzeNozzle();
-        calculatePerformance();
+// Prints the comparison and returns the number of flagged regressions.
+int compareSuiteResults(const std::vector<SuiteResult>& baseline, const std::vector<SuiteResult>& current,
+                        const SuiteOptions& opt, std::ostream& os) {
+    using namespace std;
+    int regressions = 0;
+    os << left << setw(42) << "Benchmark" << right << setw(12) << "base ns" << setw(12) << "now ns"
+       << setw(10) << "delta" << setw(10) << "p" << "\n";
+    for (const SuiteResult& cur : current) {
+        const SuiteResult* base = nullptr;
+        for (const SuiteResult& b : baseline) if (b.name == cur.name) base = &b;
+        os << left << setw(42) << cur.name << right << fixed << setprecision(2);
+        if (!base || base->samples.size() < 2 || cur.samples.size() < 2) {
+            os << setw(12) << "-" << setw(12) << median(cur.samples) << "   (no baseline)\n";
+            continue;
+        }
+        double mb = median(base->samples), mc = median(cur.samples);
+        double delta = 100.0 * (mc - mb) / mb;
+        double p = mannWhitneySlowerP(base->samples, cur.samples);
+        bool slower = p < opt.alpha && delta >= opt.thresholdPct;
+        regressions += slower;
+        os << setw(12) << mb << setw(12) << mc << setw(9) << showpos << delta << "%" << noshowpos
+           << setprecision(4) << setw(10) << p << (slower ? "  SLOWER" : "") << "\n";
     }
+    return regressions;
+}
 
-    void displayResults() const {
-        using namespace std;
-        cout << "\n--- TURBOJET PERFORMANCE ---\n";
-        cout << fixed << setprecision(4);
-        cout << "V0: " << V0 << " m/s\n";
-        cout << "V9: " << V9 << " m/s\n";
-        cout << "f_comb: " << f_comb << "  f_ab: " << f_ab << "  f_total: " << f_total << "\n";
-        cout << "Specific Thrust: " << specificThrust << " N/(kg/s)\n";
-        cout << "TSFC: " << TSFC * 1e6 << " mg/s/N\n";
-        cout << "-----------------------------------\n";
+int runRegressionSuite(const EngineInputs& in, SuiteOptions opt) {
+    using namespace std;
+    string cpu = currentCpuModel();
+    if (opt.commit.empty()) opt.commit = currentGitCommit();
+    cerr << "Benchmark suite: commit " << opt.commit << ", CPU " << cpu << ", "
+         << opt.samples << " samples\n";
+    vector<SuiteResult> current = runBenchmarkSuite(in, opt);
+
+    int rc = 0;
+    if (!opt.comparePath.empty()) {
+        string baseCommit = opt.baselineCommit;
+        vector<SuiteResult> baseline = loadSuiteBaseline(opt.comparePath, cpu, baseCommit);
+        if (baseline.empty()) {
+            cerr << "Warning: no baseline for this CPU in " << opt.comparePath << "\n";
+        } else {
+            cout << "\n--- REGRESSION CHECK vs " << baseCommit << " (alpha " << opt.alpha
+                 << ", threshold " << opt.thresholdPct << "%) ---\n";
+            int regressions = compareSuiteResults(baseline, current, opt, cout);
+            cout << "-----------------------------------\n"
+                 << regressions << " significant slowdown(s)\n";
+            if (regressions > 0) rc = 2;
+        }
+    } else {
+        vector<SuiteResult> none;
+        compareSuiteResults(none, current, opt, cout);
     }
-}; // ✅ Properly close Turbojet class here
+    if (!opt.recordPath.empty() && !recordSuiteResults(opt.recordPath, opt.commit, cpu, current)) {
+        cerr << "Error: cannot append to " << opt.recordPath << "\n";
+        return 1;
+    }
+    return rc;
+}
 
 // ==========================================================
-// CLASS: Turbofan
+// Validation Reference
 // ==========================================================
-class Turbofan {
+// --validate's oracle: every class engine written out once more as plain
+// double station arithmetic, the way the original engine classes were,
+// with no FlowState, StageGraph or component in between. Guards follow the
+// kernels' contracts (pow of a base <= 0 is 0, a burner denominator <= 0
+// is epsilon, the nozzle never expands below P0, TSFC divides by at least
+// 1e-9), and each expression keeps the kernels' order of operations, so the
+// scalar level matches to the bit wherever the two implementations agree.
+// The fuel library, recuperator loop, power split search and emission
+// correlation are called as they are: they feed the cycle, they are not the
+// composition under test.
+class ReferenceEngine {
+public:
+    explicit ReferenceEngine(const EngineInputs& in) : p(in), library(fuelIndex(in.fuel_type) != 0) {}
+
+    void run(EngineType engine, double out[OUT_COUNT]) {
+        const VariableCycleMode mode = variableCycleMode(p.vc_mode);
+        analyzeInlet();
+        switch (engine) {
+        case ENGINE_TURBOJET: runCore({{&EngineInputs::pi_c_jet, &EngineInputs::eta_c}}); break;
+        case ENGINE_TURBOFAN: runFan(false); break;
+        case ENGINE_TWO_SPOOL: runTwoSpool(); break;
+        case ENGINE_TURBOPROP:
+        case ENGINE_TURBOSHAFT: runShaft(engine == ENGINE_TURBOPROP); break;
+        case ENGINE_ICR: runFan(true); break;
+        default:
+            if (mode == VC_JET)
+                runCore({{&EngineInputs::pi_f, &EngineInputs::eta_f}, {&EngineInputs::pi_c_fan, &EngineInputs::eta_c}});
+            else runFan(false, mode == VC_THREE_STREAM);
+            break;
+        }
+        emissionIndices(T_burner, P_burner, p.T_t4, EI_NOx, EI_CO);
+        out[OUT_SPECIFIC_THRUST] = specificThrust;
+        out[OUT_TSFC] = TSFC;
+        out[OUT_F_COMB] = f_comb;
+        out[OUT_F_AB] = f_ab;
+        out[OUT_F_TOTAL] = f_total;
+        out[OUT_V0] = V0;
+        out[OUT_V9] = V9;
+        out[OUT_T_T3] = T_t3; out[OUT_P_T3] = P_t3;
+        out[OUT_T_T5] = T_t5; out[OUT_P_T5] = P_t5;
+        out[OUT_T_T9] = T_t9; out[OUT_P_T9] = P_t9;
+        out[OUT_SHAFT_POWER] = shaftPower;
+        out[OUT_PSFC] = PSFC;
+        out[OUT_PT_SPLIT] = split;
+        out[OUT_EI_NOX] = EI_NOx;
+        out[OUT_EI_CO] = EI_CO;
+    }
+
 private:
-    double T_t0, P_t0, T_t2, P_t2;
-    double T_t13, P_t13, T_t25, P_t25, T_t3, P_t3, T_t4, P_t4;
-    double T_t5, P_t5, T_t6, P_t6, T_t7, P_t7, T_t9, P_t9;
+    struct CompressorInputs {
+        double EngineInputs::* pi;
+        double EngineInputs::* eta;
+    };
 
-    double V0, V9;
-    double f_comb, f_ab, f_overall;
-    double specificThrust, TSFC;
+    const EngineInputs& p;
+    const bool library;
+    double Tt = 0, Pt = 0;                          // core stream
+    double V0 = 0, T_t2 = 0, T_t13 = 0, P_t13 = 0, T_t3 = 0, P_t3 = 0;
+    double T_t5 = 0, P_t5 = 0, T_t9 = 0, P_t9 = 0, V9 = 0, V9s = 0;
+    double T_burner = 0, P_burner = 0;
+    double work = 0;                                // shaft work per unit core air
+    double m_core = 1.0, m_fuel = 0, m_bypass = 0;  // m_bypass: air mixed into the hot stream
+    double q_rec = 0;
+    double f_comb = 0, f_ab = 0, f_total = 0, specificThrust = 0, TSFC = 0;
+    double shaftPower = std::numeric_limits<double>::quiet_NaN();
+    double PSFC = std::numeric_limits<double>::quiet_NaN(), split = std::numeric_limits<double>::quiet_NaN();
+    double EI_NOx = 0, EI_CO = 0;
+
+    static double guardedPow(double base, double exp) { return base > 0.0 ? std::pow(base, exp) : 0.0; }
+    static double guarded(double denom) { return denom <= 0 ? std::numeric_limits<double>::epsilon() : denom; }
+
+    double gammaOf(double input, double T, double P, double far) const {
+        return library ? fuelFor(p.fuel_type).gammaOf(T, P, far) : input;
+    }
+
+    double coreFar() const { return m_fuel / (m_core + m_bypass - m_fuel); }
 
     void analyzeInlet() {
-        V0 = g_M0 * sqrt(g_gamma_air * g_R_air * g_T0);
-        T_t0 = g_T0 * (1.0 + (g_gamma_air - 1.0) / 2.0 * g_M0 * g_M0);
-        P_t0 = g_P0 * pow(T_t0 / g_T0, g_gamma_air / (g_gamma_air - 1.0));
-        T_t2 = T_t0;
-        P_t2 = P_t0 * g_eta_inlet;
+        V0 = p.M0 * std::sqrt(p.gamma_air * p.R_air * p.T0);
+        Tt = p.T0 * (1.0 + (p.gamma_air - 1.0) / 2.0 * p.M0 * p.M0);
+        Pt = p.P0 * guardedPow(Tt / p.T0, p.gamma_air / (p.gamma_air - 1.0)) * p.eta_inlet;
+        T_t2 = Tt;
+    }
+
+    // Specific work of compressing the core stream by pi at efficiency eta.
+    double compress(double pi, double eta) {
+        const double T_in = Tt, g = gammaOf(p.gamma_air, T_in, Pt, 0.0);
+        Pt = Pt * pi;
+        const double T_isen = T_in * guardedPow(pi, (g - 1.0) / g);
+        Tt = T_in + (T_isen - T_in) / eta;
+        return p.cp_air * (Tt - T_in);
     }
 
     double analyzeFan() {
-        P_t13 = P_t2 * g_pi_f;
-        P_t25 = P_t13;
-        double T_t13_isen = T_t2 * pow(g_pi_f, (g_gamma_air - 1.0) / g_gamma_air);
-        T_t13 = T_t2 + (T_t13_isen - T_t2) / g_eta_f;
-        T_t25 = T_t13;
-        return g_cp_air * (T_t13 - T_t2);
+        const double w = (1.0 + p.BPR) * compress(p.pi_f, p.eta_f);
+        T_t13 = Tt;
+        P_t13 = Pt;
+        return w;
     }
 
-    double analyzeCompressor() {
-        P_t3 = P_t25 * g_pi_c_fan;
-        double T_t3_isen = T_t25 * pow(g_pi_c_fan, (g_gamma_air - 1.0) / g_gamma_air);
-        T_t3 = T_t25 + (T_t3_isen - T_t25) / g_eta_c;
-        return g_cp_air * (T_t3 - T_t25);
+    void analyzeCompressor(CompressorInputs c) {
+        work = work + compress(p.*c.pi, p.*c.eta);
+        T_t3 = Tt;
+        P_t3 = Pt;
     }
 
+    // Cooling and customer bleed at compressor exit.
+    void takeBleed() { m_core = m_core - p.bleed_cool - p.bleed_cust; }
+
     void analyzeCombustor() {
-        T_t4 = g_T_t4;
-        f_comb = (g_cp_gas * T_t4 - g_cp_air * T_t3) / (g_eta_b * g_Q_HV - g_cp_gas * T_t4);
-        P_t4 = P_t3 * g_pi_b;
+        T_burner = Tt;
+        P_burner = Pt;
+        f_comb = library ? fuelFor(p.fuel_type).burnerRatio(p.cp_air * Tt, 0.0, p.T_t4, Pt * p.pi_b, p.eta_b)
+                         : (p.cp_gas * p.T_t4 - p.cp_air * Tt) / guarded(p.eta_b * p.Q_HV - p.cp_gas * p.T_t4);
+        m_fuel = m_core * f_comb;
+        m_core = m_core + m_fuel;
+        Tt = p.T_t4;
+        Pt = Pt * p.pi_b;
+    }
+
+    // Cooling air from compressor exit rejoins at constant pressure.
+    void returnCooling() {
+        const double m_out = m_core + p.bleed_cool;
+        Tt = Tt + p.bleed_cool * (p.cp_air * T_t3 - p.cp_gas * Tt) / (m_out * p.cp_gas);
+        m_core = m_out;
     }
 
-    void analyzeTurbine(double work_fan, double work_compressor) {
-        double work_total_shaft = (1.0 + g_BPR) * work_fan + work_compressor;
-        double m_flow_turbine = 1.0 + f_comb;
-        T_t5 = T_t4 - work_total_shaft / (m_flow_turbine * g_cp_gas);
-        double T_t5_isen = T_t4 - (T_t4 - T_t5) / g_eta_t;
-        P_t5 = P_t4 * pow(T_t5_isen / T_t4, g_gamma_gas / (g_gamma_gas - 1.0));
+    void analyzeTurbine(double w, double eta) {
+        const double T_in = Tt;
+        Tt = T_in - (w / (m_core * p.cp_gas));
+        const double T_isen = T_in - (T_in - Tt) / eta;
+        const double g = gammaOf(p.gamma_gas, 0.5 * (T_in + Tt), Pt, m_fuel / (m_core - m_fuel));
+        Pt = Pt * guardedPow(T_isen / T_in, g / (g - 1.0));
     }
 
     void analyzeMixer() {
-        double m_bypass = g_BPR;
-        double m_core_exit = 1.0 + f_comb;
-        double m_mixed = m_bypass + m_core_exit;
-        T_t6 = (m_bypass * g_cp_air * T_t13 + m_core_exit * g_cp_gas * T_t5)
-             / (m_mixed * g_cp_gas);
-        P_t6 = P_t13 * g_pi_m;
+        Tt = (p.BPR * p.cp_air * T_t13 + m_core * p.cp_gas * Tt) / ((p.BPR + m_core) * p.cp_gas);
+        Pt = P_t13 * p.pi_m;
+        m_bypass = p.BPR;
     }
 
     void analyzeAfterburner() {
-        T_t7 = g_T_t7;
-        f_ab = (g_cp_gas * (T_t7 - T_t6)) / (g_eta_ab * g_Q_HV - g_cp_gas * T_t7);
-        P_t7 = P_t6 * g_pi_ab;
+        f_ab = library ? fuelFor(p.fuel_type).afterburnerRatio(Tt, Pt, coreFar(), p.T_t7, Pt * p.pi_ab, p.eta_ab)
+                       : (p.cp_gas * (p.T_t7 - Tt)) / guarded(p.eta_ab * p.Q_HV - p.cp_gas * p.T_t7);
+        Tt = p.T_t7;
+        Pt = Pt * p.pi_ab;
     }
 
     void analyzeNozzle() {
-        P_t9 = P_t7;
-        T_t9 = T_t7;
-        double T_9_isen = T_t9 * pow(g_P0 / P_t9, (g_gamma_gas - 1.0) / g_gamma_gas);
-        double T_9_actual = T_t9 - g_eta_n * (T_t9 - T_9_isen);
-        V9 = sqrt(2.0 * g_cp_gas * (T_t9 - T_9_actual));
+        P_t9 = std::max(Pt, p.P0);
+        T_t9 = Tt;
+        const double far_in = coreFar(), far = far_in + f_ab * (1.0 + far_in);
+        if (const EquilibriumTable* eq = equilibriumFor(p.fuel_type)) {
+            V9 = eq->nozzleVelocity(T_t9, P_t9, p.P0, far, p.eta_n);
+        } else {
+            const double g = gammaOf(p.gamma_gas, T_t9, P_t9, far);
+            const double T9_isen = T_t9 * guardedPow(p.P0 / P_t9, (g - 1.0) / g);
+            const double T9 = T_t9 - p.eta_n * (T_t9 - T9_isen);
+            V9 = std::sqrt(2.0 * p.cp_gas * (T_t9 - T9));
+        }
+    }
+
+    // Core-air thrust for a jet; per unit of core plus bypass air for a mixed fan.
+    void calculatePerformance(bool mixed) {
+        if (mixed) {
+            const double m_inlet = 1.0 + p.BPR;
+            const double m_mixed = 1.0 + p.BPR + m_fuel - p.bleed_cust;
+            const double m_f_ab = m_mixed * f_ab;
+            specificThrust = (((m_mixed + m_f_ab) * V9) - (m_inlet * V0)) / m_inlet;
+            f_total = (m_fuel + m_f_ab) / m_inlet;
+        } else {
+            f_total = m_fuel + m_core * f_ab;
+            specificThrust = ((1.0 + f_total - p.bleed_cust) * V9) - V0;
+        }
+        TSFC = f_total / std::max(1e-9, specificThrust);
+    }
+
+    // Single-spool core: compressors, bleed, burner, turbine paying them and
+    // the offtake, afterburner and nozzle.
+    void runCore(std::initializer_list<CompressorInputs> compressors) {
+        for (CompressorInputs c : compressors) analyzeCompressor(c);
+        takeBleed();
+        analyzeCombustor();
+        work = work + p.W_offtake;
+        returnCooling();
+        analyzeTurbine(work, p.eta_t);
+        T_t5 = Tt;
+        P_t5 = Pt;
+        analyzeAfterburner();
+        analyzeNozzle();
+        calculatePerformance(false);
     }
 
-    void calculatePerformance() {
-        double m_core = 1.0;
-        double m_bypass = g_BPR;
-        double m_inlet_total = m_core + m_bypass;
-        double m_f_comb = m_core * f_comb;
-        double m_mixed = m_core + m_bypass + m_f_comb;
-        double m_f_ab = m_mixed * f_ab;
-        double m_fuel_total = m_f_comb + m_f_ab;
-        double m_exit = m_mixed + m_f_ab;
+    // Mixed turbofan on one shaft, with the intercooled recuperated core
+    // (ICR) or the variable-cycle third stream.
+    void runFan(bool icr, bool thirdStream = false) {
+        if (thirdStream) analyzeThirdStream();
+        work = work + analyzeFan();
+        if (icr) {
+            Tt = Tt - p.eps_ic * (Tt - T_t2);
+            Pt = Pt * p.pi_ic;
+        }
+        analyzeCompressor({&EngineInputs::pi_c_fan, &EngineInputs::eta_c});
+        takeBleed();
+        if (icr) {
+            analyzeCombustorRecuperated();
+        } else {
+            analyzeCombustor();
+        }
+        work = work + p.W_offtake;
+        returnCooling();
+        analyzeTurbine(work, p.eta_t);
+        T_t5 = Tt;
+        P_t5 = Pt;
+        if (icr) {
+            Tt = Tt - q_rec / (m_core * p.cp_gas);
+            Pt = Pt * p.pi_rec;
+        }
+        analyzeMixer();
+        analyzeAfterburner();
+        analyzeNozzle();
+        calculatePerformance(true);
+        if (thirdStream) {
+            const double m_streams = 1.0 + p.BPR, m_inlet = m_streams + p.BPR3;
+            specificThrust = (specificThrust * m_streams + p.BPR3 * (V9s - V0)) / m_inlet;
+            f_total = f_total * m_streams / m_inlet;
+            TSFC = f_total / std::max(1e-9, specificThrust);
+        }
+    }
 
-        double F_net = (m_exit * V9) - (m_inlet_total * V0);
-        specificThrust = F_net / m_inlet_total;
-        f_overall = m_fuel_total / m_inlet_total;
-        TSFC = f_overall / specificThrust;
+    // Fan tip compression to pi_f3 and its own cold nozzle.
+    void analyzeThirdStream() {
+        const double ex = (p.gamma_air - 1.0) / p.gamma_air;
+        const double Pt3 = Pt * p.pi_f3;
+        const double Tt3 = Tt + (Tt * guardedPow(p.pi_f3, ex) - Tt) / p.eta_f;
+        work = work + p.BPR3 * (p.cp_air * (Tt3 - Tt));
+        const double T9_isen = Tt3 * guardedPow(p.P0 / std::max(Pt3, p.P0), ex);
+        const double T9 = Tt3 - p.eta_n * (Tt3 - T9_isen);
+        V9s = std::sqrt(2.0 * p.cp_air * (Tt3 - T9));
     }
 
-public:
-    void runFullAnalysis() {
-        analyzeInlet();
-        double Wf = analyzeFan();
-        double Wc = analyzeCompressor();
+    // Recuperator cold side between bleed and burner, on the turbine exit
+    // temperature the recuperator loop solves for.
+    void analyzeCombustorRecuperated() {
+        const RecuperatorProblem<double> prob = {Tt, p.T_t4, p.cp_air, p.cp_gas,
+                                         guarded(p.eta_b * p.Q_HV - p.cp_gas * p.T_t4), m_core, p.bleed_cool,
+                                         work + p.W_offtake, p.eps_rec, library ? &fuelFor(p.fuel_type) : nullptr,
+                                         p.eta_b, Pt * p.pi_rec * p.pi_b};
+        const double Tt35 = recuperatorOutlet(prob, recuperatedTurbineExit(prob));
+        q_rec = m_core * (p.cp_air * (Tt35 - Tt));
+        Tt = Tt35;
+        Pt = Pt * p.pi_rec;
+        analyzeCombustor();
+    }
+
+    // Fan on the LP spool; cooling air rejoins between the HP and LP turbines.
+    void runTwoSpool() {
+        const double w_fan = analyzeFan();
+        analyzeCompressor({&EngineInputs::pi_c_fan, &EngineInputs::eta_c});
+        takeBleed();
         analyzeCombustor();
-        analyzeTurbine(Wf, Wc);
+        work = work + p.W_offtake;
+        analyzeTurbine(work, p.eta_t_hp);
+        returnCooling();
+        analyzeTurbine(w_fan, p.eta_t_lp);
+        T_t5 = Tt;
+        P_t5 = Pt;
         analyzeMixer();
         analyzeAfterburner();
         analyzeNozzle();
-        calculatePerformance();
+        calculatePerformance(true);
     }
 
-    void displayResults() const {
-        using namespace std;
-        cout << "\n--- TURBOFAN PERFORMANCE ---\n";
-        cout << fixed << setprecision(4);
-        cout << "V0: " << V0 << " m/s\n";
-        cout << "V9: " << V9 << " m/s\n";
-        cout << "f_comb: " << f_comb << "  f_ab: " << f_ab << "  f_total: " << f_overall << "\n";
-        cout << "Specific Thrust: " << specificThrust << " N/(kg/s)\n";
-        cout << "TSFC: " << TSFC * 1e6 << " mg/s/N\n";
-        cout << "-----------------------------------\n";
+    // Gas generator, then a free power turbine taking the split of the ideal
+    // expansion to ambient (searched for a turboprop), and the nozzle.
+    void runShaft(bool search) {
+        analyzeCompressor({&EngineInputs::pi_c_jet, &EngineInputs::eta_c});
+        takeBleed();
+        analyzeCombustor();
+        work = work + p.W_offtake;
+        returnCooling();
+        analyzeTurbine(work, p.eta_t);
+        const double g = gammaOf(p.gamma_gas, Tt, Pt, m_fuel / (m_core - m_fuel));
+        const double r = guardedPow(p.P0 / Pt, (g - 1.0) / g);
+        const double dh = std::max(0.0, p.cp_gas * (Tt - Tt * r));
+        split = p.pt_split;
+        if (search) {
+            split = searchPowerSplit(powerSplitProblem(Tt, r, dh, p.cp_gas, p.eta_pt, p.eta_n, p.eta_gear,
+                                                       p.eta_prop, m_core, 1.0 + m_fuel - p.bleed_cust, V0));
+        }
+        const double T_in = Tt, w_pt = split * p.eta_pt * dh;
+        Tt = T_in - w_pt / p.cp_gas;
+        const double T_isen = T_in - split * dh / p.cp_gas;
+        Pt = Pt * guardedPow(T_isen / T_in, g / (g - 1.0));
+        shaftPower = p.eta_gear * m_core * w_pt;
+        T_t5 = Tt;
+        P_t5 = Pt;
+        analyzeNozzle();
+        calculatePerformance(false);
+        PSFC = f_total / std::max(1e-9, shaftPower + specificThrust * V0 / p.eta_prop);
     }
 };
 
 // ==========================================================
-// Input Setup Function
+// Fast-Path Validation
 // ==========================================================
-void setAllGlobalInputs() {
+// Samples the input space (with a share of samples aimed at the guarded
+// corners: burner/afterburner denominators near zero, safe_pow clamping in
+// the turbine and nozzle, static conditions) and compares every registered
+// batch path with ReferenceEngine, not with the classes it is built from.
+// Samples are keyed by index, so any worst case can be regenerated from its
+// --set line.
+struct ValidationPath {
+    std::string name;
+    EngineType engine;
+    BatchKernel kernel;
+    bool fuelTables = true;          // false: compared on fuel_type 0 samples only
+    OutputMask outputs = kAllOutputs;    // columns the path writes; only these are compared
+};
+
+template<class Cycle>
+BatchKernel cycleKernelAt(IsaLevel isa) {
+    const BatchKernel kernels[kIsaCount] = {
+        cycleBatchIsa<Cycle, true, ISA_SCALAR>, cycleBatchIsa<Cycle, true, ISA_SSE2>,
+        cycleBatchIsa<Cycle, true, ISA_AVX2>, cycleBatchIsa<Cycle, true, ISA_AVX512>};
+    return kernels[isa];
+}
+
+std::vector<ValidationPath> validationPaths() {
+    std::vector<ValidationPath> paths = {
+        {"turbojetBatch", ENGINE_TURBOJET, turbojetBatch<true>},
+        {"turbofanBatch", ENGINE_TURBOFAN, turbofanBatch<true>},
+        {"twoSpoolBatch", ENGINE_TWO_SPOOL, twoSpoolBatch<true>},
+        {"turbopropBatch", ENGINE_TURBOPROP, turbopropBatch<true>},
+        {"turboshaftBatch", ENGINE_TURBOSHAFT, turboshaftBatch<true>},
+        {"icrTurbofanBatch", ENGINE_ICR, icrTurbofanBatch<true>},
+        {"variableCycleBatch", ENGINE_VARIABLE, variableCycleBatch<true>},
+    };
+    // The lane kernels also at the levels --isa did not pick.
+    for (int isa = 0; isa < kIsaCount; ++isa) {
+        if (isa == g_isa || !isaSupported(static_cast<IsaLevel>(isa))) continue;
+        const std::string level = std::string("@") + kIsaNames[isa];
+        const IsaLevel at = static_cast<IsaLevel>(isa);
+        paths.push_back({"turbojetBatch" + level, ENGINE_TURBOJET, cycleKernelAt<TurbojetCycle>(at)});
+        paths.push_back({"turbofanBatch" + level, ENGINE_TURBOFAN, cycleKernelAt<TurbofanCycle>(at)});
+        paths.push_back({"twoSpoolBatch" + level, ENGINE_TWO_SPOOL, cycleKernelAt<TwoSpoolCycle>(at)});
+        paths.push_back({"turbopropBatch" + level, ENGINE_TURBOPROP, cycleKernelAt<TurbopropCycle>(at)});
+        paths.push_back({"turboshaftBatch" + level, ENGINE_TURBOSHAFT, cycleKernelAt<TurboshaftCycle>(at)});
+        paths.push_back({"icrTurbofanBatch" + level, ENGINE_ICR, cycleKernelAt<IcrTurbofanCycle>(at)});
+    }
+    if (g_cycle_program.reference >= 0) {
+        OutputMask stored = 0;
+        for (int c = 0; c < OUT_COUNT; ++c)
+            if (g_cycle_program.stored[c]) stored |= outputBit(c);
+        paths.push_back({"cycleProgram", static_cast<EngineType>(g_cycle_program.reference), cycleProgramBatch,
+                         false, stored});
+    }
+    return paths;
+}
+
+struct InputRange {
+    const char* name;
+    double lo, hi;
+};
+
+const InputRange kValidationRanges[] = {
+    {"gamma_air", 1.30, 1.45}, {"gamma_gas", 1.25, 1.38},
+    {"cp_air", 950.0, 1100.0}, {"cp_gas", 1050.0, 1300.0},
+    {"R_air", 280.0, 295.0}, {"Q_HV", 3.0e7, 1.2e8},
+    {"M0", 0.0, 3.0}, {"T0", 200.0, 320.0}, {"P0", 5000.0, 105000.0},
+    {"eta_inlet", 0.85, 1.0}, {"eta_c", 0.75, 0.95}, {"eta_f", 0.75, 0.95},
+    {"eta_b", 0.9, 1.0}, {"eta_t", 0.8, 0.95}, {"eta_ab", 0.85, 1.0}, {"eta_n", 0.9, 1.0},
+    {"pi_b", 0.9, 1.0}, {"pi_ab", 0.9, 1.0}, {"pi_m", 0.9, 1.0},
+    {"T_t4", 1000.0, 2200.0}, {"T_t7", 1200.0, 2600.0},
+    {"pi_c_jet", 2.0, 50.0}, {"BPR", 0.0, 12.0}, {"pi_f", 1.1, 5.0}, {"pi_c_fan", 2.0, 40.0},
+    {"eta_t_hp", 0.8, 0.95}, {"eta_t_lp", 0.8, 0.95},
+    {"bleed_cool", 0.0, 0.2}, {"bleed_cust", 0.0, 0.05}, {"W_offtake", 0.0, 50000.0},
+    {"eta_pt", 0.8, 0.95}, {"eta_prop", 0.7, 0.9}, {"eta_gear", 0.95, 1.0}, {"pt_split", 0.0, 1.0},
+    {"eps_ic", 0.0, 0.9}, {"pi_ic", 0.9, 1.0}, {"eps_rec", 0.0, 0.9}, {"pi_rec", 0.9, 1.0},
+    {"vc_mode", 0.0, 2.0}, {"BPR3", 0.0, 1.0}, {"pi_f3", 1.1, 2.5},
+    {"fuel_type", 0.0, kFuelCount - 1.0},
+};
+
+enum ValidationRegion {
+    REGION_BURNER_DENOM, REGION_AB_DENOM, REGION_TURBINE_CLAMP, REGION_NOZZLE_CLAMP,
+    REGION_STATIC, REGION_NOMINAL
+};
+
+EngineInputs validationSample(uint64_t seed, uint64_t index) {
+    EngineInputs in{};
+    uint64_t stream = 0;
+    for (const InputRange& r : kValidationRanges)
+        in.*(findInputField(r.name)->member) = r.lo + (r.hi - r.lo) * counterUniform(seed, index, stream++);
+
+    // One sample in eight probes a guarded corner.
+    uint64_t pick = splitmix64(seed ^ (index * 0xD1B54A32D192ED03ull)) % 40;
+    double u = 2.0 * counterUniform(seed, index, stream++) - 1.0;
+    switch (pick < 5 ? static_cast<ValidationRegion>(pick) : REGION_NOMINAL) {
+    case REGION_BURNER_DENOM:
+        in.Q_HV = in.cp_gas * in.T_t4 / in.eta_b * (1.0 + 1e-3 * u);
+        break;
+    case REGION_AB_DENOM:
+        in.Q_HV = in.cp_gas * in.T_t7 / in.eta_ab * (1.0 + 1e-3 * u);
+        break;
+    case REGION_TURBINE_CLAMP:
+        in.eta_t = in.eta_t_hp = in.eta_t_lp = in.eta_pt = 0.05 + 0.25 * std::fabs(u);
+        in.pi_c_jet = 40.0 + 20.0 * std::fabs(u);
+        in.pi_c_fan = 30.0 + 20.0 * std::fabs(u);
+        break;
+    case REGION_NOZZLE_CLAMP:
+        in.pi_b = in.pi_ab = in.pi_m = 0.05 + 0.1 * std::fabs(u);
+        in.eta_inlet = 0.1;
+        break;
+    case REGION_STATIC:
+        in.M0 = 0.0;
+        break;
+    case REGION_NOMINAL:
+        break;
+    }
+    return in;
+}
+
+// Distance in units in the last place; doubles of opposite sign count the
+// steps through zero.
+inline uint64_t ulpDistance(double a, double b) {
+    int64_t ia, ib;
+    std::memcpy(&ia, &a, sizeof(a));
+    std::memcpy(&ib, &b, sizeof(b));
+    if (ia < 0) ia = std::numeric_limits<int64_t>::min() - ia;
+    if (ib < 0) ib = std::numeric_limits<int64_t>::min() - ib;
+    return ia > ib ? static_cast<uint64_t>(ia) - static_cast<uint64_t>(ib)
+                   : static_cast<uint64_t>(ib) - static_cast<uint64_t>(ia);
+}
+
+struct OutputError {
+    uint64_t compared = 0;
+    uint64_t nanMismatches = 0;      // exactly one side non-finite
+    uint64_t maxUlp = 0;
+    double sumUlp = 0.0;
+    double maxRel = 0.0;
+    double sumRel = 0.0;
+    uint64_t worstIndex = 0;
+    double worstRef = 0.0, worstValue = 0.0;
+
+    void add(double ref, double value, uint64_t index) {
+        bool refFinite = std::isfinite(ref), valueFinite = std::isfinite(value);
+        if (!refFinite || !valueFinite) {
+            bool same = (std::isnan(ref) && std::isnan(value)) || ref == value;
+            if (!same) {
+                if (nanMismatches++ == 0 && maxUlp == 0) {
+                    worstIndex = index; worstRef = ref; worstValue = value;
+                }
+            }
+            return;
+        }
+        ++compared;
+        uint64_t ulp = ulpDistance(ref, value);
+        double rel = std::fabs(value - ref) / std::max(std::fabs(ref), std::numeric_limits<double>::min());
+        sumUlp += static_cast<double>(ulp);
+        sumRel += rel;
+        maxRel = std::max(maxRel, rel);
+        if (ulp > maxUlp) {
+            maxUlp = ulp; worstIndex = index; worstRef = ref; worstValue = value;
+        }
+    }
+
+    void merge(const OutputError& o) {
+        bool haveWorst = maxUlp > 0 || nanMismatches > 0;
+        if (o.maxUlp > maxUlp || (!haveWorst && o.nanMismatches > 0)) {
+            maxUlp = o.maxUlp; worstIndex = o.worstIndex; worstRef = o.worstRef; worstValue = o.worstValue;
+        }
+        compared += o.compared;
+        nanMismatches += o.nanMismatches;
+        sumUlp += o.sumUlp;
+        sumRel += o.sumRel;
+        maxRel = std::max(maxRel, o.maxRel);
+    }
+};
+
+// Interval Bounds checked against the batch kernels: on one sample in eight, a
+// fuel_type 0 box of up to +-0.5% of each range around it, and random points
+// inside the box.
+struct BoundedPath {
+    EngineType engine;
+    BatchKernel kernel;
+};
+
+const BoundedPath kBoundedPaths[] = {
+    {ENGINE_TURBOJET, turbojetBatch<false>},
+    {ENGINE_TURBOFAN, turbofanBatch<false>},
+    {ENGINE_TWO_SPOOL, twoSpoolBatch<false>},
+};
+const int kBoundedPathCount = sizeof(kBoundedPaths) / sizeof(kBoundedPaths[0]);
+const size_t kBoxPoints = 4;
+const uint64_t kBoxStride = 8;
+
+// Adds the points outside their bounds to escapes[OUT_COUNT]. Every other
+// box varies only kSlopeAxes inputs, so the mean-value form is checked too.
+void checkIntervalBox(const BoundedPath& path, uint64_t seed, uint64_t index, uint64_t escapes[OUT_COUNT]) {
+    EngineInputs lo = validationSample(seed, index), hi = lo;
+    const size_t ranges = sizeof(kValidationRanges) / sizeof(kValidationRanges[0]);
+    const bool slopes = index / kBoxStride % 2 == 1;
+    const size_t first = static_cast<size_t>(counterUniform(seed ^ 0xB0C7ull, index, 0) * ranges);
+    uint64_t stream = 0;
+    for (const InputRange& r : kValidationRanges) {
+        const size_t k = stream;
+        double EngineInputs::* m = findInputField(r.name)->member;
+        double w = 0.005 * (r.hi - r.lo) * counterUniform(seed ^ 0xB0C5ull, index, stream++);
+        if (slopes && (k + ranges - first) % ranges >= kSlopeAxes) continue;
+        lo.*m -= w;
+        hi.*m += w;
+    }
+    lo.fuel_type = hi.fuel_type = 0.0;
+    Interval bound[OUT_COUNT];
+    boundCycle(path.engine, lo, hi, bound);
+
+    EngineInputs points[kBoxPoints];
+    double storage[OUT_COUNT][kBoxPoints];
+    double* cols[OUT_COUNT];
+    for (int c = 0; c < OUT_COUNT; ++c) cols[c] = storage[c];
+    for (size_t k = 0; k < kBoxPoints; ++k) {
+        points[k] = lo;
+        stream = 0;
+        for (const InputField& f : kInputFields)
+            points[k].*(f.member) += (hi.*(f.member) - lo.*(f.member)) *
+                                     counterUniform(seed ^ 0xB0C6ull, index * kBoxPoints + k, stream++);
+        points[k].fuel_type = 0.0;
+    }
+    path.kernel(points, kBoxPoints, cols, kAllOutputs);
+    for (int c = 0; c < OUT_COUNT; ++c)
+        for (size_t k = 0; k < kBoxPoints; ++k)
+            if (!bound[c].contains(storage[c][k])) ++escapes[c];
+}
+
+struct ValidationOptions {
+    uint64_t samples = 1000000;
+    uint64_t seed = 1;
+    int threads = 1;
+    std::string dumpPath;            // worst cases as reproducible --set lines
+};
+
+int runValidation(const ValidationOptions& opt) {
     using namespace std;
-    cout << "\n--- SET GLOBAL INPUTS ---\n";
-    cout << "gamma_air: "; cin >> g_gamma_air;
-    cout << "gamma_gas: "; cin >> g_gamma_gas;
-    cout << "cp_air (J/kg*K): "; cin >> g_cp_air;
-    cout << "cp_gas (J/kg*K): "; cin >> g_cp_gas;
-    cout << "R_air (J/kg*K): "; cin >> g_R_air;
-    cout << "Fuel Heating Value Q_HV (J/kg): "; cin >> g_Q_HV;
+    vector<ValidationPath> paths = validationPaths();
+    const size_t np = paths.size();
+    const int n = max(1, opt.threads);
+    vector<vector<OutputError>> perThread(n, vector<OutputError>(np * OUT_COUNT));
+    vector<vector<uint64_t>> escapes(n, vector<uint64_t>(kBoundedPathCount * OUT_COUNT, 0));
+    atomic<uint64_t> nextBlock(0);
+    vector<int> cpus;
+    for (const NumaNode& node : discoverNumaTopology())
+        cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
 
-    cout << "\nFlight Mach (M0): "; cin >> g_M0;
-    cout << "Ambient Temp (K): "; cin >> g_T0;
-    cout << "Ambient Pressure (Pa): "; cin >> g_P0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    auto body = [&](int self) {
+        if (n > 1) pinCurrentThread(cpus[self % cpus.size()]);
+        vector<OutputError>& errs = perThread[self];
+        EngineInputs block[kBatchSize];
+        double refCols[kClassEngineCount][OUT_COUNT][kBatchSize];
+        double pathStorage[OUT_COUNT][kBatchSize];
+        double* pathCols[OUT_COUNT];
+        for (int c = 0; c < OUT_COUNT; ++c) pathCols[c] = pathStorage[c];
+        double out[OUT_COUNT];
+        bool used[kClassEngineCount] = {};
+        for (const ValidationPath& path : paths) used[path.engine] = true;
 
-    cout << "\nEfficiencies (eta_inlet eta_c eta_f eta_b eta_t eta_ab eta_n):\n";
-    cin >> g_eta_inlet >> g_eta_c >> g_eta_f >> g_eta_b >> g_eta_t >> g_eta_ab >> g_eta_n;
+        for (;;) {
+            uint64_t first = nextBlock.fetch_add(kBatchSize);
+            if (first >= opt.samples) break;
+            size_t count = static_cast<size_t>(min<uint64_t>(kBatchSize, opt.samples - first));
+            for (size_t j = 0; j < count; ++j) block[j] = validationSample(opt.seed, first + j);
+            for (int e = 0; e < kClassEngineCount; ++e)
+                for (size_t j = 0; j < count && used[e]; ++j) {
+                    ReferenceEngine(block[j]).run(static_cast<EngineType>(e), out);
+                    for (int c = 0; c < OUT_COUNT; ++c) refCols[e][c][j] = out[c];
+                }
+            for (size_t p = 0; p < np; ++p) {
+                paths[p].kernel(block, count, pathCols, paths[p].outputs);
+                for (int c = 0; c < OUT_COUNT; ++c)
+                    for (size_t j = 0; j < count && (paths[p].outputs & outputBit(c)); ++j)
+                        if (paths[p].fuelTables || fuelIndex(block[j].fuel_type) == 0)
+                            errs[p * OUT_COUNT + c].add(refCols[paths[p].engine][c][j], pathCols[c][j], first + j);
+            }
+            for (int b = 0; b < kBoundedPathCount; ++b)
+                for (size_t j = 0; j < count; ++j)
+                    if ((first + j) % kBoxStride == 0)
+                        checkIntervalBox(kBoundedPaths[b], opt.seed, first + j, &escapes[self][b * OUT_COUNT]);
+        }
+    };
+    vector<thread> pool;
+    for (int w = 0; w < n; ++w) pool.emplace_back(body, w);
+    for (thread& t : pool) t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    cout << "\nPressure Ratios & Temps (pi_b pi_ab pi_m T_t4 T_t7):\n";
-    cin >> g_pi_b >> g_pi_ab >> g_pi_m >> g_T_t4 >> g_T_t7;
+    vector<OutputError> total(np * OUT_COUNT);
+    for (const vector<OutputError>& errs : perThread)
+        for (size_t k = 0; k < total.size(); ++k) total[k].merge(errs[k]);
 
-    cout << "\nEngine Specific (pi_c_jet BPR pi_f pi_c_fan):\n";
-    cin >> g_pi_c_jet >> g_BPR >> g_pi_f >> g_pi_c_fan;
+    cout << "\n--- VALIDATION: " << opt.samples << " samples, seed " << opt.seed << ", " << kIsaNames[g_isa] << ", "
+         << fixed << setprecision(2) << seconds << " s ---\n";
+    for (size_t p = 0; p < np; ++p) {
+        cout << "\n" << paths[p].name << " vs reference " << kClassNames[paths[p].engine] << "\n";
+        cout << left << setw(16) << "Output" << right << setw(21) << "max ULP" << setw(14) << "mean ULP"
+             << setw(14) << "max rel" << setw(14) << "mean rel" << setw(12) << "non-finite" << "\n";
+        for (int c = 0; c < OUT_COUNT; ++c) {
+            if (!(paths[p].outputs & outputBit(c))) continue;
+            const OutputError& e = total[p * OUT_COUNT + c];
+            double cmp = static_cast<double>(max<uint64_t>(e.compared, 1));
+            cout << left << setw(16) << kOutputNames[c] << right << setw(21) << e.maxUlp
+                 << scientific << setprecision(3) << setw(14) << e.sumUlp / cmp << setprecision(2)
+                 << setw(14) << e.maxRel << setw(14) << e.sumRel / cmp << fixed
+                 << setw(12) << e.nanMismatches << "\n";
+        }
+    }
 
-    g_inputs_are_set = true;
-    cout << "\nInputs successfully set!\n";
+    cout << "\nInterval bounds, " << (opt.samples + kBoxStride - 1) / kBoxStride << " boxes of " << kBoxPoints
+         << " points (outside bounds)\n";
+    for (int b = 0; b < kBoundedPathCount; ++b) {
+        uint64_t outside = 0;
+        ostringstream columns;
+        for (int c = 0; c < OUT_COUNT; ++c) {
+            uint64_t k = 0;
+            for (const vector<uint64_t>& e : escapes) k += e[b * OUT_COUNT + c];
+            if (k) columns << " " << kOutputNames[c] << "=" << k;
+            outside += k;
+        }
+        cout << left << setw(16) << kClassNames[kBoundedPaths[b].engine] << right << setw(21) << outside
+             << columns.str() << "\n";
+    }
+    cout << "-----------------------------------\n";
+
+    if (!opt.dumpPath.empty()) {
+        ofstream dump(opt.dumpPath);
+        dump << setprecision(17);
+        for (size_t p = 0; p < np; ++p)
+            for (int c = 0; c < OUT_COUNT; ++c) {
+                const OutputError& e = total[p * OUT_COUNT + c];
+                if (e.maxUlp == 0 && e.nanMismatches == 0) continue;
+                EngineInputs in = validationSample(opt.seed, e.worstIndex);
+                dump << "# " << paths[p].name << " " << kOutputNames[c] << ": sample " << e.worstIndex
+                     << ", reference " << e.worstRef << ", path " << e.worstValue
+                     << ", " << e.maxUlp << " ULP\n";
+                for (const InputField& f : kInputFields) dump << "--set " << f.name << "=" << in.*(f.member) << " ";
+                dump << "\n";
+            }
+    }
+    return 0;
+}
+
+// ==========================================================
+// Command Line
+// ==========================================================
+struct CommandLine {
+    std::string inputsPath;
+    bool sweep = false;
+    SweepSpec spec;
+    SweepOptions sweepOpt;
+    std::vector<std::pair<const InputField*, double>> overrides;
+    bool cycleLoaded = false;
+    bool kernelLoaded = false;
+    std::string emitKernelPath;
+    std::vector<const InputField*> folded;
+    std::string profileJsonPath;
+    bool bench = false;
+    std::vector<EngineType> benchEngines;
+    BenchOptions benchOpt;
+    bool suite = false;
+    SuiteOptions suiteOpt;
+    bool validate = false;
+    ValidationOptions validateOpt;
+    bool listFuels = false;
+    std::string genEquilibriumPath;
+    bool queried = false;
+    SweepQuery query;
+    bool bounds = false;
+};
+
+void reportStageProfile(const CommandLine& cl) {
+    if (!g_profile_stages) return;
+    printStageProfile(std::cout);
+    if (!cl.profileJsonPath.empty()) {
+        std::ofstream json(cl.profileJsonPath);
+        writeStageProfileJson(json);
+    }
+}
+
+void printUsage() {
+    std::cerr <<
+        "Usage: enginer [--inputs FILE] [--sweep ENGINE SWEEP OPTIONS]\n"
+        "  --inputs FILE              read inputs in setAllGlobalInputs() order\n"
+        "  --set NAME=VALUE           override one input\n"
+        "  --sweep ENGINE             jet|fan|fan2|prop|shaft|icr|vcycle|cycle|plugin instead of the menu\n"
+        "  --cycle FILE               cycle description for --sweep/--bench cycle\n"
+        "  --emit-kernel FILE         write the --cycle program as C++ kernel source\n"
+        "  --fold NAME[,NAME...]      inputs baked into the emitted kernel as constants\n"
+        "  --kernel FILE.so           compiled kernel for --sweep/--bench plugin\n"
+        "  --axis NAME=LO:HI[:N]      sweep axis (N grid points; range only for --mc)\n"
+        "  --mc SAMPLES               Monte Carlo over the axis ranges\n"
+        "  --seed N                   Monte Carlo seed (default 1)\n"
+        "  --chunk N                  points per chunk (default 4096)\n"
+        "  --out FILE                 result file; enables checkpoints (FILE.ckpt)\n"
+        "  --checkpoint-interval SEC  seconds between checkpoints (default 10)\n"
+        "  --resume                   skip chunks already recorded in FILE.ckpt\n"
+        "  --csv FILE                 write results as CSV\n"
+        "  --outputs NAME[,NAME...]   compute and store only these result columns (also --emit-kernel)\n"
+        "  --reduce SPEC              stream min|max:COL[@AXIS], top|bottom:K:COL, hist:COL:LO:HI:BINS\n"
+        "                             or mean:COL\n"
+        "  --query TEXT               run a constrained study, e.g. \"minimize TSFC on fan subject to\n"
+        "                             specificThrust > 900 over BPR in [0.2,2], T_t4 = 1800\"\n"
+        "  --scalar                   evaluate through the Turbojet/Turbofan classes\n"
+        "  --bounds                   print guaranteed output bounds over the axis box (jet|fan|fan2)\n"
+        "  --procs N                  fork N shard workers over a shared result mapping\n"
+        "  --max-restarts N           restarts allowed per failed shard (default 3)\n"
+        "  --threads N                worker threads, spread over NUMA nodes (0 = all CPUs)\n"
+        "  --no-pin                   do not pin worker threads to CPUs\n"
+        "  --huge-pages               use transparent huge pages for in-memory results\n"
+        "  --profile-stages           per-stage perf counters (sweeps use the class path)\n"
+        "  --profile-json FILE        also write the stage profile as JSON\n"
+        "  --trace FILE               write a Chrome/Perfetto trace of the sweep\n"
+        "  --bench ENGINE|both        benchmark the inputs on 1..--threads threads\n"
+        "  --bench-seconds SEC        time per benchmark trial (default 0.5)\n"
+        "  --bench-trials N           trials per thread count (default 3)\n"
+        "  --bench-suite              run the regression benchmark suite\n"
+        "  --suite-samples N          samples per suite benchmark (default 10)\n"
+        "  --bench-record FILE        append suite results to a baseline file\n"
+        "  --bench-compare FILE       test suite results against the newest baseline\n"
+        "  --bench-baseline COMMIT    compare against this baseline commit instead\n"
+        "  --bench-commit NAME        key to record results under (default: git HEAD)\n"
+        "  --bench-threshold PCT      smallest slowdown to flag (default 2)\n"
+        "  --validate N               compare batch paths with the reference on N samples\n"
+        "  --validate-dump FILE       write each worst case as reproducible --set lines\n"
+        "  --list-fuels               print the fuel library (indices for --set fuel_type=N)\n"
+        "  --gen-equilibrium FILE     solve equilibrium tables for the library fuels (--threads N)\n"
+        "  --equilibrium FILE         burner and nozzle use the equilibrium tables in FILE\n"
+        "  --emissions                add the EI_NOx/EI_CO emission index columns\n"
+        "  --isa LEVEL                scalar|sse2|avx2|avx512 jet/fan/fan2 kernels (default: widest the CPU runs)\n"
+        "  --reproducible             same result bits and --reduce aggregates for any --threads and --isa\n";
+}
+
+bool parseCommandLine(int argc, char* argv[], CommandLine& cl) {
+    using namespace std;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        auto value = [&](string& v) {
+            if (i + 1 >= argc) { cerr << "Error: " << arg << " needs a value.\n"; return false; }
+            v = argv[++i];
+            return true;
+        };
+        string v;
+        if (arg == "--inputs") {
+            if (!value(cl.inputsPath)) return false;
+        } else if (arg == "--cycle") {
+            if (!value(v)) return false;
+            ifstream in(v);
+            if (!in) { cerr << "Error: cannot open cycle description " << v << "\n"; return false; }
+            if (!loadCycleProgram(in, g_cycle_program)) return false;
+            cl.cycleLoaded = true;
+        } else if (arg == "--kernel") {
+            if (!value(v) || !loadKernelPlugin(v, g_kernel_plugin)) return false;
+            cl.kernelLoaded = true;
+        } else if (arg == "--emit-kernel") {
+            if (!value(cl.emitKernelPath)) return false;
+        } else if (arg == "--fold") {
+            if (!value(v)) return false;
+            stringstream names(v);
+            for (string name; getline(names, name, ',');) {
+                const InputField* f = findInputField(name);
+                if (!f) { cerr << "Error: unknown input in --fold " << name << "\n"; return false; }
+                cl.folded.push_back(f);
+            }
+        } else if (arg == "--outputs") {
+            if (!value(v)) return false;
+            stringstream names(v);
+            cl.spec.outputs = 0;
+            for (string name; getline(names, name, ',');) {
+                int c = findOutputColumn(name);
+                if (c < 0) { cerr << "Error: unknown output in --outputs " << name << "\n"; return false; }
+                cl.spec.outputs |= outputBit(c);
+            }
+            if (!cl.spec.outputs) { cerr << "Error: --outputs selects no columns.\n"; return false; }
+        } else if (arg == "--query") {
+            if (!value(v) || !parseQuery(v, cl.query)) return false;
+            cl.queried = true;
+        } else if (arg == "--reduce") {
+            ReducerSpec r;
+            if (!value(v) || !parseReducer(v, r)) return false;
+            cl.sweepOpt.reducers.push_back(r);
+        } else if (arg == "--set") {
+            if (!value(v)) return false;
+            size_t eq = v.find('=');
+            const InputField* f = eq == string::npos ? nullptr : findInputField(v.substr(0, eq));
+            if (!f) { cerr << "Error: unknown input in --set " << v << "\n"; return false; }
+            cl.overrides.push_back({f, atof(v.c_str() + eq + 1)});
+        } else if (arg == "--sweep") {
+            if (!value(v)) return false;
+            if (!engineByName(v, cl.spec.engine)) {
+                cerr << "Error: --sweep expects jet, fan, fan2, prop, shaft, icr, vcycle, cycle or plugin.\n";
+                return false;
+            }
+            cl.sweep = true;
+        } else if (arg == "--axis") {
+            if (!value(v)) return false;
+            SweepAxis a{};
+            size_t eq = v.find('=');
+            a.field = eq == string::npos ? nullptr : findInputField(v.substr(0, eq));
+            if (!a.field) { cerr << "Error: unknown input in --axis " << v << "\n"; return false; }
+            unsigned long long n = 1;
+            int got = sscanf(v.c_str() + eq + 1, "%lf:%lf:%llu", &a.lo, &a.hi, &n);
+            if (got < 2 || n == 0) { cerr << "Error: bad --axis " << v << "\n"; return false; }
+            a.count = n;
+            cl.spec.axes.push_back(a);
+        } else if (arg == "--mc") {
+            if (!value(v)) return false;
+            cl.spec.monteCarlo = true;
+            cl.spec.samples = strtoull(v.c_str(), nullptr, 10);
+        } else if (arg == "--seed") {
+            if (!value(v)) return false;
+            cl.spec.seed = strtoull(v.c_str(), nullptr, 10);
+        } else if (arg == "--chunk") {
+            if (!value(v)) return false;
+            cl.spec.chunkSize = std::max<uint64_t>(1, strtoull(v.c_str(), nullptr, 10));
+        } else if (arg == "--out") {
+            if (!value(cl.sweepOpt.outPath)) return false;
+        } else if (arg == "--checkpoint-interval") {
+            if (!value(v)) return false;
+            cl.sweepOpt.checkpointSeconds = atof(v.c_str());
+        } else if (arg == "--resume") {
+            cl.sweepOpt.resume = true;
+        } else if (arg == "--csv") {
+            if (!value(cl.sweepOpt.csvPath)) return false;
+        } else if (arg == "--scalar") {
+            cl.sweepOpt.scalar = true;
+        } else if (arg == "--bounds") {
+            cl.bounds = true;
+        } else if (arg == "--procs") {
+            if (!value(v)) return false;
+            cl.sweepOpt.procs = std::max(1, atoi(v.c_str()));
+        } else if (arg == "--max-restarts") {
+            if (!value(v)) return false;
+            cl.sweepOpt.maxRestarts = std::max(0, atoi(v.c_str()));
+        } else if (arg == "--threads") {
+            if (!value(v)) return false;
+            cl.sweepOpt.threads = atoi(v.c_str());
+            if (cl.sweepOpt.threads <= 0) {
+                size_t cpus = 0;
+                for (const NumaNode& node : discoverNumaTopology()) cpus += node.cpus.size();
+                cl.sweepOpt.threads = static_cast<int>(cpus);
+            }
+        } else if (arg == "--no-pin") {
+            cl.sweepOpt.pinThreads = false;
+        } else if (arg == "--huge-pages") {
+            cl.sweepOpt.hugePages = true;
+        } else if (arg == "--bench") {
+            if (!value(v)) return false;
+            if (v == "jet" || v == "both") cl.benchEngines.push_back(ENGINE_TURBOJET);
+            if (v == "fan" || v == "both") cl.benchEngines.push_back(ENGINE_TURBOFAN);
+            if (v == "fan2") cl.benchEngines.push_back(ENGINE_TWO_SPOOL);
+            if (v == "prop") cl.benchEngines.push_back(ENGINE_TURBOPROP);
+            if (v == "shaft") cl.benchEngines.push_back(ENGINE_TURBOSHAFT);
+            if (v == "icr") cl.benchEngines.push_back(ENGINE_ICR);
+            if (v == "vcycle") cl.benchEngines.push_back(ENGINE_VARIABLE);
+            if (v == "cycle") cl.benchEngines.push_back(ENGINE_PROGRAM);
+            if (v == "plugin") cl.benchEngines.push_back(ENGINE_PLUGIN);
+            if (cl.benchEngines.empty()) {
+                cerr << "Error: --bench expects jet, fan, fan2, prop, shaft, icr, vcycle, both, cycle or plugin.\n";
+                return false;
+            }
+            cl.bench = true;
+        } else if (arg == "--bench-seconds") {
+            if (!value(v)) return false;
+            cl.benchOpt.seconds = std::max(0.01, atof(v.c_str()));
+        } else if (arg == "--bench-trials") {
+            if (!value(v)) return false;
+            cl.benchOpt.trials = std::max(1, atoi(v.c_str()));
+        } else if (arg == "--bench-suite") {
+            cl.suite = true;
+        } else if (arg == "--suite-samples") {
+            if (!value(v)) return false;
+            cl.suiteOpt.samples = std::max(2, atoi(v.c_str()));
+        } else if (arg == "--bench-record") {
+            if (!value(cl.suiteOpt.recordPath)) return false;
+            cl.suite = true;
+        } else if (arg == "--bench-compare") {
+            if (!value(cl.suiteOpt.comparePath)) return false;
+            cl.suite = true;
+        } else if (arg == "--bench-baseline") {
+            if (!value(cl.suiteOpt.baselineCommit)) return false;
+        } else if (arg == "--bench-commit") {
+            if (!value(cl.suiteOpt.commit)) return false;
+        } else if (arg == "--bench-threshold") {
+            if (!value(v)) return false;
+            cl.suiteOpt.thresholdPct = atof(v.c_str());
+        } else if (arg == "--validate") {
+            if (!value(v)) return false;
+            cl.validate = true;
+            cl.validateOpt.samples = strtoull(v.c_str(), nullptr, 10);
+        } else if (arg == "--list-fuels") {
+            cl.listFuels = true;
+        } else if (arg == "--equilibrium") {
+            if (!value(v) || !loadEquilibriumTables(v)) return false;
+        } else if (arg == "--gen-equilibrium") {
+            if (!value(cl.genEquilibriumPath)) return false;
+        } else if (arg == "--validate-dump") {
+            if (!value(cl.validateOpt.dumpPath)) return false;
+        } else if (arg == "--trace") {
+            if (!value(g_trace_path)) return false;
+            g_trace_enabled = true;
+        } else if (arg == "--emissions") {
+            g_emissions = true;
+        } else if (arg == "--isa") {
+            if (!value(v)) return false;
+            int isa = isaIndex(v);
+            if (isa < 0) { cerr << "Error: unknown ISA level " << v << " (scalar|sse2|avx2|avx512)\n"; return false; }
+            if (!isaSupported(static_cast<IsaLevel>(isa))) {
+                cerr << "Error: this CPU does not run the " << v << " kernels\n";
+                return false;
+            }
+            g_isa = static_cast<IsaLevel>(isa);
+        } else if (arg == "--reproducible") {
+            g_reproducible = true;
+        } else if (arg == "--profile-stages") {
+            g_profile_stages = true;
+        } else if (arg == "--profile-json") {
+            if (!value(cl.profileJsonPath)) return false;
+            g_profile_stages = true;
+        } else {
+            cerr << "Error: unknown option " << arg << "\n";
+            printUsage();
+            return false;
+        }
+    }
+    return true;
 }
 
 // ==========================================================
 // MAIN PROGRAM
 // ==========================================================
-int main() {
+int main(int argc, char* argv[]) {
     using namespace std;
     int choice = 0;
 
+    CommandLine cl;
+    if (!parseCommandLine(argc, argv, cl)) return 1;
+    if (!cl.genEquilibriumPath.empty()) {
+        vector<EquilibriumTable> tables;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (!generateEquilibriumTables(tables, cl.sweepOpt.threads)) {
+            cerr << "Error: equilibrium solve did not converge.\n";
+            return 1;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (!writeEquilibriumTables(cl.genEquilibriumPath, tables)) {
+            cerr << "Error: cannot write " << cl.genEquilibriumPath << "\n";
+            return 1;
+        }
+        cout << "Wrote " << cl.genEquilibriumPath << ": " << (kFuelCount - 1) * EquilibriumTable::cells()
+             << " states in " << fixed << setprecision(2) << seconds << " s\n";
+        return 0;
+    }
+    if (cl.listFuels) {
+        printFuelLibrary(cout);
+        if (!g_equilibrium.empty()) printEquilibriumSummary(cout);
+        return 0;
+    }
+    if (!cl.inputsPath.empty()) {
+        ifstream in(cl.inputsPath);
+        if (!loadGlobalInputs(in)) {
+            cerr << "Error: cannot read inputs from " << cl.inputsPath << "\n";
+            return 1;
+        }
+    }
+    if (cl.queried) {
+        if (!g_inputs_are_set) { cerr << "Error: --query needs --inputs.\n"; return 1; }
+        EngineInputs base = captureGlobalInputs();
+        for (const auto& o : cl.overrides) base.*(o.first->member) = o.second;
+        for (const auto& f : cl.query.fixed) base.*(f.first->member) = f.second;
+        if (cl.query.engine == ENGINE_PROGRAM && !cl.cycleLoaded) {
+            cerr << "Error: a query on cycle needs --cycle FILE.\n";
+            return 1;
+        }
+        if (cl.query.engine == ENGINE_PLUGIN) {
+            if (!cl.kernelLoaded) { cerr << "Error: a query on plugin needs --kernel FILE.so.\n"; return 1; }
+            vector<const InputField*> free;
+            for (const QueryAxis& a : cl.query.axes) free.push_back(a.field);
+            if (!checkKernelFolds(g_kernel_plugin, base, free)) return 1;
+            if (!checkKernelOutputs(g_kernel_plugin, cl.query.outputs())) return 1;
+        }
+        if (!hasClassPath(cl.query.engine) && fuelIndex(base.fuel_type) != 0) {
+            cerr << "Error: cycle programs use the input gas model; fuel_type must be 0.\n";
+            return 1;
+        }
+        return runQuery(cl.query, base, cl.spec.seed, cl.sweepOpt.threads);
+    }
+    if (cl.sweep) {
+        if (!g_inputs_are_set) { cerr << "Error: sweeps need --inputs.\n"; return 1; }
+        if (cl.sweepOpt.procs > 1 && cl.sweepOpt.threads > 1) {
+            cerr << "Error: use either --procs or --threads, not both.\n";
+            return 1;
+        }
+        cl.spec.base = captureGlobalInputs();
+        for (const auto& o : cl.overrides) cl.spec.base.*(o.first->member) = o.second;
+        if (cl.spec.pointCount() == 0) { cerr << "Error: sweep has no points.\n"; return 1; }
+        if (cl.bounds) {
+            if (!hasIntervalBounds(cl.spec.engine)) { cerr << "Error: --bounds covers jet, fan and fan2.\n"; return 1; }
+            EngineInputs lo = cl.spec.base, hi = cl.spec.base;
+            for (const SweepAxis& a : cl.spec.axes) {
+                lo.*(a.field->member) = a.lo;
+                hi.*(a.field->member) = a.hi;
+            }
+            printCycleBounds(cl.spec.engine, lo, hi, cout);
+            return 0;
+        }
+        if (g_profile_stages && cl.sweepOpt.procs > 1) {
+            cerr << "Error: --profile-stages counts per process; use --threads.\n";
+            return 1;
+        }
+        if (cl.spec.engine == ENGINE_PROGRAM && !cl.cycleLoaded) {
+            cerr << "Error: --sweep cycle needs --cycle FILE.\n";
+            return 1;
+        }
+        if (cl.spec.engine == ENGINE_PLUGIN) {
+            if (!cl.kernelLoaded) { cerr << "Error: --sweep plugin needs --kernel FILE.so.\n"; return 1; }
+            vector<const InputField*> swept;
+            for (const SweepAxis& a : cl.spec.axes) swept.push_back(a.field);
+            if (!checkKernelFolds(g_kernel_plugin, cl.spec.base, swept)) return 1;
+            OutputMask needed = cl.sweepOpt.storedOutputs(cl.spec) | reducerOutputs(cl.sweepOpt.reducers);
+            if (!checkKernelOutputs(g_kernel_plugin, needed)) return 1;
+        }
+        if (!cl.sweepOpt.reducers.empty() && (cl.sweepOpt.procs > 1 || cl.sweepOpt.resume)) {
+            cerr << "Error: --reduce keeps its partials in-process; use --threads and no --resume.\n";
+            return 1;
+        }
+        if (!bindReducers(cl.sweepOpt.reducers, cl.spec)) return 1;
+        bool fuelTables = fuelIndex(cl.spec.base.fuel_type) != 0;
+        for (const SweepAxis& a : cl.spec.axes)
+            if (a.field->member == &EngineInputs::fuel_type && (fuelIndex(a.lo) != 0 || fuelIndex(a.hi) != 0))
+                fuelTables = true;
+        if (!hasClassPath(cl.spec.engine) && fuelTables) {
+            cerr << "Error: cycle programs use the input gas model; fuel_type must be 0.\n";
+            return 1;
+        }
+        if (!hasClassPath(cl.spec.engine) && (cl.sweepOpt.scalar || g_profile_stages)) {
+            cerr << "Error: cycle programs have no class path for --scalar or --profile-stages.\n";
+            return 1;
+        }
+        if (g_reproducible && (cl.sweepOpt.scalar || g_profile_stages)) {
+            cerr << "Error: --reproducible runs the batch kernels; drop --scalar and --profile-stages.\n";
+            return 1;
+        }
+        if (g_profile_stages) cl.sweepOpt.scalar = true;   // stages only exist in the classes
+        traceThreadName("main");
+        int rc = runSweep(cl.spec, cl.sweepOpt);
+        reportStageProfile(cl);
+        writeChromeTrace();
+        return rc;
+    }
+    if (!cl.overrides.empty()) {
+        EngineInputs in = captureGlobalInputs();
+        for (const auto& o : cl.overrides) in.*(o.first->member) = o.second;
+        applyGlobalInputs(in);
+    }
+    if (!cl.emitKernelPath.empty()) {
+        if (!cl.cycleLoaded) { cerr << "Error: --emit-kernel needs --cycle FILE.\n"; return 1; }
+        if (!cl.folded.empty() && !g_inputs_are_set) {
+            cerr << "Error: --fold takes its values from --inputs.\n";
+            return 1;
+        }
+        ofstream src(cl.emitKernelPath);
+        if (!src || !emitCycleKernel(g_cycle_program, captureGlobalInputs(), cl.folded, cl.spec.outputs, src)) {
+            cerr << "Error: cannot write " << cl.emitKernelPath << "\n";
+            return 1;
+        }
+        cout << "Wrote " << cl.emitKernelPath << "; build it with\n"
+             << "  g++ -std=c++17 -O3 -march=native -shared -fPIC " << cl.emitKernelPath << " -o kernel.so\n";
+        return 0;
+    }
+    if (cl.bench) {
+        if (!g_inputs_are_set) { cerr << "Error: --bench needs --inputs.\n"; return 1; }
+        if (cl.benchEngines[0] == ENGINE_PROGRAM && !cl.cycleLoaded) {
+            cerr << "Error: --bench cycle needs --cycle FILE.\n";
+            return 1;
+        }
+        if (cl.benchEngines[0] == ENGINE_PLUGIN) {
+            if (!cl.kernelLoaded) { cerr << "Error: --bench plugin needs --kernel FILE.so.\n"; return 1; }
+            if (!checkKernelFolds(g_kernel_plugin, captureGlobalInputs(), {})) return 1;
+            if (!checkKernelOutputs(g_kernel_plugin, cl.spec.outputs)) return 1;
+        }
+        if (!hasClassPath(cl.benchEngines[0]) && fuelIndex(captureGlobalInputs().fuel_type) != 0) {
+            cerr << "Error: cycle programs use the input gas model; fuel_type must be 0.\n";
+            return 1;
+        }
+        cl.benchOpt.maxThreads = cl.sweepOpt.threads > 1 ? cl.sweepOpt.threads : 0;
+        cl.benchOpt.outputs = cl.spec.outputs;
+        for (EngineType e : cl.benchEngines) runBenchmark(e, captureGlobalInputs(), cl.benchOpt);
+        return 0;
+    }
+    if (cl.validate) {
+        cl.validateOpt.seed = cl.spec.seed;
+        cl.validateOpt.threads = cl.sweepOpt.threads;
+        return runValidation(cl.validateOpt);
+    }
+    if (cl.suite) {
+        if (!g_inputs_are_set) { cerr << "Error: --bench-suite needs --inputs.\n"; return 1; }
+        return runRegressionSuite(captureGlobalInputs(), cl.suiteOpt);
+    }
+
     while (choice != 9) {
         cout << "\n========== Engine Performance Estimator ==========\n";
         cout << "1. Set All Global Inputs\n";
         cout << "2. Run Turbojet with Afterburner Analysis\n";
         cout << "3. Run Turbofan with Afterburner Analysis\n";
         cout << "4. Toggle Debug Mode (Currently: " << (g_debug_mode ? "ON" : "OFF") << ")\n";
+        cout << "5. Benchmark Current Configuration\n";
+        cout << "6. Set Extended Inputs (spools, bleeds, offtake, shaft engines)\n";
+        cout << "7. Run Two-Spool Turbofan Analysis\n";
+        cout << "8. Run Turboprop Analysis (optimal power split)\n";
         cout << "9. Exit\n";
         cout << "==================================================\n";
         cout << "Status: Inputs " << (g_inputs_are_set ? "ARE SET" : "ARE NOT SET") << endl;
@@ -323,6 +7319,22 @@ int main() {
             g_debug_mode = !g_debug_mode;
             cout << "Debug mode is now " << (g_debug_mode ? "ON" : "OFF") << endl;
             break;
+        case 5:
+            if (!g_inputs_are_set) { cout << "\nError: please set inputs first.\n"; break; }
+            runBenchmark(ENGINE_TURBOJET, captureGlobalInputs(), cl.benchOpt);
+            runBenchmark(ENGINE_TURBOFAN, captureGlobalInputs(), cl.benchOpt);
+            break;
+        case 6:
+            setExtendedInputs();
+            break;
+        case 7:
+            if (!g_inputs_are_set) { cout << "\nError: please set inputs first.\n"; break; }
+            { TwoSpoolTurbofan fan; fan.runFullAnalysis(); fan.displayResults(); }
+            break;
+        case 8:
+            if (!g_inputs_are_set) { cout << "\nError: please set inputs first.\n"; break; }
+            { Turboprop prop; prop.runFullAnalysis(); prop.displayResults(); }
+            break;
         case 9:
             cout << "Exiting program.\n";
             break;
@@ -331,5 +7343,6 @@ int main() {
         }
     }
 
+    reportStageProfile(cl);
     return 0;
 }